@@ -0,0 +1,153 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: batch.cpp
+*/
+
+// includes
+#include "include/batch.h"
+#include "include/gameboy.h"
+
+// create the pool (0 threads = one per hardware thread)
+Batch::Batch(int threadCount) : Machines(NULL), Cycles(0), Frames(0), Generation(0), Running(0), Quit(false), InstructionsRan(0)
+{
+	if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+	if (threadCount <= 0) threadCount = 1;
+
+	// one slice per worker
+	std::vector<Slice>(threadCount).swap(Slices);
+
+	// the calling thread is worker 0
+	for (int i = 1; i < threadCount; i++)
+	{
+		Threads.push_back(std::thread(&Batch::WorkerLoop, this, i));
+	}
+}
+
+// stop the pool
+Batch::~Batch()
+{
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Quit = true;
+	}
+
+	Start.notify_all();
+
+	for (size_t i = 0; i < Threads.size(); i++)
+	{
+		Threads[i].join();
+	}
+}
+
+// get the number of workers (including the calling thread)
+int Batch::GetThreadCount() const
+{
+	return (int)Slices.size();
+}
+
+// run every machine for the given number of frames, returns the number of instructions ran
+long Batch::RunFrames(GameBoy **machines, int count, int frames)
+{
+	return Run(machines, count, 0, frames);
+}
+
+// run every machine for the given number of cycles, returns the number of instructions ran
+long Batch::RunCycles(GameBoy **machines, int count, int cycles)
+{
+	return Run(machines, count, cycles, 0);
+}
+
+// run a batch on the pool
+long Batch::Run(GameBoy **machines, int count, int cycles, int frames)
+{
+	int threadCount = (int)Slices.size();
+
+	// split the machines evenly between the workers
+	for (int i = 0; i < threadCount; i++)
+	{
+		Slices[i].Next = (int)(((long)count * i) / threadCount);
+		Slices[i].End = (int)(((long)count * (i + 1)) / threadCount);
+	}
+
+	InstructionsRan = 0;
+
+	// wake the pool
+	{
+		std::lock_guard<std::mutex> lock(Lock);
+		Machines = machines;
+		Cycles = cycles;
+		Frames = frames;
+		Running = threadCount - 1;
+		Generation++;
+	}
+
+	Start.notify_all();
+
+	// the calling thread works too
+	long instructionsRan = DoWork(0);
+
+	// wait for the pool to finish
+	std::unique_lock<std::mutex> lock(Lock);
+	Done.wait(lock, [this] { return Running == 0; });
+
+	return instructionsRan + InstructionsRan;
+}
+
+// pool thread
+void Batch::WorkerLoop(int id)
+{
+	long generation = 0;
+
+	for (;;)
+	{
+		// wait for a new batch
+		{
+			std::unique_lock<std::mutex> lock(Lock);
+			Start.wait(lock, [&] { return Quit || Generation != generation; });
+			if (Quit) return;
+			generation = Generation;
+		}
+
+		InstructionsRan += DoWork(id);
+
+		// report that we're done
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Running -= 1;
+		}
+
+		Done.notify_one();
+	}
+}
+
+// run our own slice, then steal from the other workers' slices
+long Batch::DoWork(int id)
+{
+	int threadCount = (int)Slices.size();
+	long instructionsRan = 0;
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		Slice &slice = Slices[(id + i) % threadCount];
+
+		for (int index = slice.Next++; index < slice.End; index = slice.Next++)
+		{
+			GameBoy *machine = Machines[index];
+
+			if (Frames > 0)
+			{
+				for (int frame = 0; frame < Frames; frame++)
+				{
+					instructionsRan += machine->RunFrame();
+				}
+			}
+			else
+			{
+				instructionsRan += machine->RunCycles(Cycles);
+			}
+		}
+	}
+
+	return instructionsRan;
+}
@@ -9,11 +9,10 @@
 #include <cstdio>
 #include <cstring>
 #include "include/bios.h"
+#include "include/gameboy.h"
 #include "include/memory.h"
 #include "include/log.h"
-
-// The current bios name
-const char *Bios::biosFileName = NULL;
+#include "include/rom.h"
 
 // load the bios
 bool Bios::Load(const char *fileName)
@@ -30,14 +29,18 @@ bool Bios::Load(const char *fileName)
 		Log::Normal("loading bios '%s' successfully", fileName);
 		// the bios was loaded successfully
 		loadResult = true;
-		// read the bios into memory
-		fread(&Memory::Mem[0x00], 1, 0x100, gbBios);
+		Bios::State &bios = GameBoy::Current()->BiosState;
+		// read the bios
+		fread(bios.Data, 1, BIOS_SIZE, gbBios);
 		// set the bios filename
-		biosFileName = fileName;
+		bios.FileName = fileName;
+		// map the bios over the rom
+		bios.Mapped = true;
+		Map();
 	}
 
 	// close the bios
-	fclose(gbBios);
+	if (gbBios) fclose(gbBios);
 	
 	return loadResult;
 }
@@ -45,18 +48,33 @@ bool Bios::Load(const char *fileName)
 // reload the bios
 void Bios::Reload()
 {
-	if (biosFileName != NULL)
+	const char *fileName = GameBoy::Current()->BiosState.FileName;
+
+	if (fileName != NULL)
 	{
-		Load(biosFileName);
+		Load(fileName);
 	}
 }
 
-// remove the bios
+// remove the bios (the rom shows through again)
 void Bios::Remove()
 {
-	// remove the bios from memory (TODO: not complete)
-	for (int i = 0; i < 0x100; i ++)
+	Bios::State &bios = GameBoy::Current()->BiosState;
+
+	if (bios.Mapped)
+	{
+		bios.Mapped = false;
+		Rom::Map();
+	}
+}
+
+// map the bios over the first page of the rom
+void Bios::Map()
+{
+	Bios::State &bios = GameBoy::Current()->BiosState;
+
+	if (bios.Mapped)
 	{
-		Memory::Write(0x00 + i, 0x00);
+		Memory::MapRead(0x0000, BIOS_SIZE, bios.Data);
 	}
 }
@@ -7,12 +7,11 @@
 // includes
 #include <stdio.h>
 #include <stdlib.h>
-#include "imgui/imgui.h"
-#include "imgui/imgui_memory_editor.h"
-#include "imgui/imgui_custom_extensions.h"
 #include "include/bit.h"
 #include "include/cpu.h"
+#include "include/dynarec.h"
 #include "include/flags.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
 #include "include/lcd.h"
 #include "include/log.h"
@@ -20,74 +19,182 @@
 #include "include/ops.h"
 #include "include/timer.h"
 
-// initialize vars
-WORD Cpu::PC = 0x100;
-Cpu::Registers Cpu::SP = {};
-Cpu::Registers Cpu::AF = {};
-Cpu::Registers Cpu::BC = {};
-Cpu::Registers Cpu::DE = {};
-Cpu::Registers Cpu::HL = {};
-Cpu::Operations Cpu::Operation = {};
-int Cpu::Cycles = 0;
-// counter to enable pending interrupts
-static int interruptCounter = 0;
-// debug memory viewer
-static MemoryEditor memoryViewer;
+// the HALT opcode, and the cycles the cpu idles for at a time while halted
+#define OPCODE_HALT 0x76
+#define HALT_CYCLES 4
+
+// # Lazy Flags # //
+
+// work out the Z, N, H and C flags of the pending operation
+static BYTE PendingFlagsValue(const Cpu::State &state)
+{
+	BYTE val = state.Flags.Val;
+	BYTE val2 = state.Flags.Val2;
+	BYTE carryFlag = state.Flags.Carry;
+	BYTE result = state.Flags.Result;
+	BYTE flags = (result == 0) ? FLAG_MASK_Z : 0;
+
+	switch(state.Flags.Operation)
+	{
+		case PENDING_ALU + ALU_ADD:
+		{
+			if (((val & 0xF) + (val2 & 0xF)) > 0xF) flags |= FLAG_MASK_H;
+			if ((val + val2) > 0xFF) flags |= FLAG_MASK_C;
+		}
+		break;
+
+		case PENDING_ALU + ALU_ADC:
+		{
+			if (((val & 0xF) + carryFlag) > 0xF) flags |= FLAG_MASK_H;
+			if ((((val + carryFlag) & 0xF) + (val2 & 0xF)) > 0xF) flags |= FLAG_MASK_H;
+			if ((val + carryFlag + val2) > 0xFF) flags |= FLAG_MASK_C;
+		}
+		break;
+
+		case PENDING_ALU + ALU_SUB:
+		case PENDING_ALU + ALU_CP:
+		{
+			flags |= FLAG_MASK_N;
+			if ((val & 0xF) < (val2 & 0xF)) flags |= FLAG_MASK_H;
+			if (val < val2) flags |= FLAG_MASK_C;
+		}
+		break;
+
+		case PENDING_ALU + ALU_SBC:
+		{
+			flags |= FLAG_MASK_N;
+			if ((val & 0xF) < carryFlag) flags |= FLAG_MASK_H;
+			if (((val - carryFlag) & 0xF) < (val2 & 0xF)) flags |= FLAG_MASK_H;
+			if (val < carryFlag) flags |= FLAG_MASK_C;
+			if ((val - carryFlag) < val2) flags |= FLAG_MASK_C;
+		}
+		break;
+
+		case PENDING_ALU + ALU_AND: flags |= FLAG_MASK_H; break;
+		case PENDING_ALU + ALU_XOR: break;
+		case PENDING_ALU + ALU_OR: break;
+
+		// INC and DEC leave the carry flag alone
+		case PENDING_INC:
+		{
+			if ((result & 0xF) == 0) flags |= FLAG_MASK_H;
+			if (carryFlag) flags |= FLAG_MASK_C;
+		}
+		break;
+
+		case PENDING_DEC:
+		{
+			flags |= FLAG_MASK_N;
+			if ((result & 0xF) == 0xF) flags |= FLAG_MASK_H;
+			if (carryFlag) flags |= FLAG_MASK_C;
+		}
+		break;
+	}
+
+	return flags;
+}
+
+// write the flags of the pending operation (if any) to F
+static inline void MaterializeFlags(Cpu::State &state)
+{
+	if (state.Flags.Operation != PENDING_NONE)
+	{
+		state.AF.lo = ((state.AF.lo & 0x0F) | PendingFlagsValue(state));
+		state.Flags.Operation = PENDING_NONE;
+	}
+}
+
+// get the zero flag (every pending operation sets it from its result)
+static inline bool FlagZ(const Cpu::State &state)
+{
+	if (state.Flags.Operation != PENDING_NONE) return (state.Flags.Result == 0);
+
+	return (state.AF.lo & FLAG_MASK_Z);
+}
+
+// get the carry flag
+static inline BYTE FlagC(const Cpu::State &state)
+{
+	switch(state.Flags.Operation)
+	{
+		case PENDING_NONE: return (state.AF.lo & FLAG_MASK_C) ? 1 : 0;
+		case PENDING_INC:
+		case PENDING_DEC: return state.Flags.Carry;
+		case PENDING_ALU + ALU_AND:
+		case PENDING_ALU + ALU_XOR:
+		case PENDING_ALU + ALU_OR: return 0;
+		default: return (PendingFlagsValue(state) & FLAG_MASK_C) ? 1 : 0;
+	}
+}
+
+// set the pending flag operation
+static inline void SetPendingFlags(Cpu::State &state, BYTE operation, BYTE val, BYTE val2, BYTE carryFlag, BYTE result)
+{
+	state.Flags.Operation = operation;
+	state.Flags.Val = val;
+	state.Flags.Val2 = val2;
+	state.Flags.Carry = carryFlag;
+	state.Flags.Result = result;
+}
 
 // # Getters # //
 
 // PC
 WORD Cpu::Get::PC()
 {
-	return Cpu::PC;
+	return GameBoy::Current()->CpuState.PC;
 }
 
 // SP
 Cpu::Registers * Cpu::Get::SP()
 {
-	return &Cpu::SP;
+	return &GameBoy::Current()->CpuState.SP;
 }
 
 // AF
 Cpu::Registers * Cpu::Get::AF()
 {
-	return &Cpu::AF;
+	State &state = GameBoy::Current()->CpuState;
+	// F is about to be looked at (and maybe changed), so make it current
+	MaterializeFlags(state);
+
+	return &state.AF;
 }
 
 // BC
 Cpu::Registers * Cpu::Get::BC()
 {
-	return &Cpu::BC;
+	return &GameBoy::Current()->CpuState.BC;
 }
 
 // DE
 Cpu::Registers * Cpu::Get::DE()
 {
-	return &Cpu::DE;
+	return &GameBoy::Current()->CpuState.DE;
 }
 
 // HL
 Cpu::Registers * Cpu::Get::HL()
 {
-	return &Cpu::HL;
+	return &GameBoy::Current()->CpuState.HL;
 }
 
 // cycles
 int Cpu::Get::Cycles()
 {
-	return Cpu::Cycles;
+	return GameBoy::Current()->CpuState.Cycles;
 }
 
 // stop
 bool Cpu::Get::Stop()
 {
-	return Cpu::Operation.Stop;
+	return GameBoy::Current()->CpuState.Operation.Stop;
 }
 
 // halt
 bool Cpu::Get::Halt()
 {
-	return Cpu::Operation.Halt;
+	return GameBoy::Current()->CpuState.Operation.Halt;
 }
 
 // # Setters # //
@@ -95,63 +202,74 @@ bool Cpu::Get::Halt()
 // PC
 void Cpu::Set::PC(WORD val)
 {
-	Cpu::PC = val;
+	GameBoy::Current()->CpuState.PC = val;
 }
 
 // SP
 void Cpu::Set::SP(WORD val)
 {
-	Cpu::SP.reg = val;
+	GameBoy::Current()->CpuState.SP.reg = val;
 }
 
 // AF
 void Cpu::Set::AF(WORD val)
 {
-	Cpu::AF.reg = val;
+	State &state = GameBoy::Current()->CpuState;
+
+	state.AF.reg = val;
+	state.Flags.Operation = PENDING_NONE;
 }
 
 // BC
 void Cpu::Set::BC(WORD val)
 {
-	Cpu::BC.reg = val;
+	GameBoy::Current()->CpuState.BC.reg = val;
 }
 
 // DE
 void Cpu::Set::DE(WORD val)
 {
-	Cpu::DE.reg = val;
+	GameBoy::Current()->CpuState.DE.reg = val;
 }
 
 // HL
 void Cpu::Set::HL(WORD val)
 {
-	Cpu::HL.reg = val;
+	GameBoy::Current()->CpuState.HL.reg = val;
 }
 
 // cycles
 void Cpu::Set::Cycles(int val)
 {
-	Cpu::Cycles += val;
+	GameBoy::Current()->CpuState.Cycles += val;
 }
 
 // stop
 void Cpu::Set::Stop(bool val)
 {
-	Cpu::Operation.Stop = val;
+	GameBoy::Current()->CpuState.Operation.Stop = val;
 }
 
 // halt
 void Cpu::Set::Halt(bool val)
 {
-	Cpu::Operation.Halt = val;
+	GameBoy::Current()->CpuState.Operation.Halt = val;
 }
 
 
 // init cpu
 int Cpu::Init(bool usingBios)
 {
-	// setup the memory viewer
-	memoryViewer.Rows = 4;
+	// bind the registers of the current machine
+	State &state = GameBoy::Current()->CpuState;
+	WORD &PC = state.PC;
+	Registers &SP = state.SP;
+	Registers &AF = state.AF;
+	Registers &BC = state.BC;
+	Registers &DE = state.DE;
+	Registers &HL = state.HL;
+	Operations &Operation = state.Operation;
+	int &Cycles = state.Cycles;
 
 	// initialise certain vars to different values, if we're using the bios or not
 	if (usingBios)
@@ -177,12 +295,16 @@ int Cpu::Init(bool usingBios)
 		HL.reg = 0x014D;
 	}
 
+	// no pending flags
+	state.Flags.Operation = PENDING_NONE;
 	// reset cycles
 	Cycles = 0;
 	// reset operations
 	Operation.PendingInterruptEnabled = false;
 	Operation.Stop = false;
 	Operation.Halt = false;
+	// forget any idle loop
+	state.Loop = IdleLoop();
 	// init memory
 	Memory::Write(0xFF05, 0x00);
 	Memory::Write(0xFF06, 0x00);
@@ -226,732 +348,894 @@ int Cpu::Init(bool usingBios)
 	Memory::Write(0xFF4B, 0x00);
 	Memory::Write(0xFFFF, 0x00);
 	Interrupt::Request(Interrupt::IDS::VBLANK);
-	//Memory::Write(0xFF00, 0xFF);
 
 	return 0;
 }
 
-// execute Opcode
-void Cpu::ExecuteOpcode()
+// # Opcode Handlers # //
+
+// 8 bit operands, in the order they're encoded in the opcodes
+#define OPERAND_B 0
+#define OPERAND_C 1
+#define OPERAND_D 2
+#define OPERAND_E 3
+#define OPERAND_H 4
+#define OPERAND_L 5
+#define OPERAND_HL 6
+#define OPERAND_A 7
+
+// rotate/shift operations, in the order they're encoded in the extended opcodes
+#define ROTATE_RLC 0
+#define ROTATE_RRC 1
+#define ROTATE_RL 2
+#define ROTATE_RR 3
+#define SHIFT_SLA 4
+#define SHIFT_SRA 5
+#define SHIFT_SWAP 6
+#define SHIFT_SRL 7
+
+// an opcode handler (the opcode has already been fetched)
+typedef void (*Handler)(Cpu::State &state);
+
+// 8 bit registers
+template <int Operand> static inline BYTE &Register(Cpu::State &state);
+template <> inline BYTE &Register<OPERAND_B>(Cpu::State &state) { return state.BC.hi; }
+template <> inline BYTE &Register<OPERAND_C>(Cpu::State &state) { return state.BC.lo; }
+template <> inline BYTE &Register<OPERAND_D>(Cpu::State &state) { return state.DE.hi; }
+template <> inline BYTE &Register<OPERAND_E>(Cpu::State &state) { return state.DE.lo; }
+template <> inline BYTE &Register<OPERAND_H>(Cpu::State &state) { return state.HL.hi; }
+template <> inline BYTE &Register<OPERAND_L>(Cpu::State &state) { return state.HL.lo; }
+template <> inline BYTE &Register<OPERAND_A>(Cpu::State &state) { return state.AF.hi; }
+
+// 8 bit operand (a register)
+template <int Operand> struct Operand8
 {
-	BYTE Opcode = Memory::ReadByte(PC);
+	static inline BYTE Read(Cpu::State &state) { return Register<Operand>(state); }
+	static inline void Write(Cpu::State &state, BYTE val) { Register<Operand>(state) = val; }
+};
 
-	//Log::ToFile(PC, Opcode, Flags::Get::Z(), Flags::Get::N(), Flags::Get::H(), Flags::Get::C());
-	//Log::ExecutedOpcode(Opcode);
+// 8 bit operand (memory at HL)
+template <> struct Operand8<OPERAND_HL>
+{
+	static inline BYTE Read(Cpu::State &state) { return Memory::ReadByte(state.HL.reg); }
+	static inline void Write(Cpu::State &state, BYTE val) { Memory::Write(state.HL.reg, val); }
+};
+
+// # Eight Bit Handlers # //
+
+// LD r,r'
+template <int Destination, int Source> static inline void Load(Cpu::State &state)
+{
+	Operand8<Destination>::Write(state, Operand8<Source>::Read(state));
+	state.Cycles += (Destination == OPERAND_HL || Source == OPERAND_HL) ? 8 : 4;
+}
+
+// LD r,d8
+template <int Destination> static inline void LoadImmediate(Cpu::State &state)
+{
+	Operand8<Destination>::Write(state, (BYTE)state.Operand);
+	state.PC += 1;
+	state.Cycles += 8;
+}
+
+// INC r
+template <int Operand> static inline void Inc(Cpu::State &state)
+{
+	BYTE result = (Operand8<Operand>::Read(state) + 1);
+
+	SetPendingFlags(state, PENDING_INC, 0, 0, FlagC(state), result);
+	Operand8<Operand>::Write(state, result);
+	state.Cycles += (Operand == OPERAND_HL) ? 12 : 4;
+}
+
+// DEC r
+template <int Operand> static inline void Dec(Cpu::State &state)
+{
+	BYTE result = (Operand8<Operand>::Read(state) - 1);
+
+	SetPendingFlags(state, PENDING_DEC, 0, 0, FlagC(state), result);
+	Operand8<Operand>::Write(state, result);
+	state.Cycles += (Operand == OPERAND_HL) ? 12 : 4;
+}
+
+// ADD/ADC/SUB/SBC/AND/XOR/OR/CP A,val (the flags are worked out when they're needed)
+template <int Operation> static inline void Alu(Cpu::State &state, BYTE val2)
+{
+	BYTE val = state.AF.hi;
+	BYTE carryFlag = (Operation == ALU_ADC || Operation == ALU_SBC) ? FlagC(state) : 0;
+	BYTE result = 0;
+
+	switch(Operation)
+	{
+		case ALU_ADD: result = (val + val2); break;
+		case ALU_ADC: result = (val + carryFlag + val2); break;
+		case ALU_SUB: case ALU_CP: result = (val - val2); break;
+		case ALU_SBC: result = (val - carryFlag - val2); break;
+		case ALU_AND: result = (val & val2); break;
+		case ALU_XOR: result = (val ^ val2); break;
+		case ALU_OR: result = (val | val2); break;
+	}
+
+	SetPendingFlags(state, PENDING_ALU + Operation, val, val2, carryFlag, result);
+	if (Operation != ALU_CP) state.AF.hi = result;
+}
+
+// ALU A,r
+template <int Operation, int Operand> static inline void AluRegister(Cpu::State &state)
+{
+	Alu<Operation>(state, Operand8<Operand>::Read(state));
+	state.Cycles += (Operand == OPERAND_HL) ? 8 : 4;
+}
+
+// ALU A,d8
+template <int Operation> static inline void AluImmediate(Cpu::State &state)
+{
+	Alu<Operation>(state, (BYTE)state.Operand);
+	state.PC += 1;
+	state.Cycles += 8;
+}
+
+// rotate/shift a value (RLCA, RRCA, RLA and RRA never set the zero flag)
+template <int Operation, bool CheckForZero> static inline BYTE RotateShift(Cpu::State &state, BYTE val)
+{
+	BYTE carryFlag = FlagC(state);
+	BYTE result = 0;
+	BYTE flags = 0;
+
+	switch(Operation)
+	{
+		case ROTATE_RLC: result = ((val << 1) | (val >> 7)); if (val & 0x80) flags |= FLAG_MASK_C; break;
+		case ROTATE_RRC: result = ((val >> 1) | (val << 7)); if (val & 0x01) flags |= FLAG_MASK_C; break;
+		case ROTATE_RL: result = ((val << 1) | carryFlag); if (val & 0x80) flags |= FLAG_MASK_C; break;
+		case ROTATE_RR: result = ((val >> 1) | (carryFlag << 7)); if (val & 0x01) flags |= FLAG_MASK_C; break;
+		case SHIFT_SLA: result = (val << 1); if (val & 0x80) flags |= FLAG_MASK_C; break;
+		case SHIFT_SRA: result = (val >> 1); if (val & 0x01) flags |= FLAG_MASK_C; break;
+		case SHIFT_SWAP: result = ((val >> 4) | (val << 4)); break;
+		case SHIFT_SRL: result = (val >> 1); if (val & 0x01) flags |= FLAG_MASK_C; break;
+	}
+
+	if (CheckForZero && result == 0) flags |= FLAG_MASK_Z;
+
+	// SRA keeps the MSB
+	if (Operation == SHIFT_SRA) result |= (val & 0x80);
+
+	state.AF.lo = ((state.AF.lo & 0x0F) | flags);
+	state.Flags.Operation = PENDING_NONE;
+
+	return result;
+}
+
+// # Extended Handlers # //
+
+// RLC/RRC/RL/RR/SLA/SRA/SWAP/SRL r
+template <int Operation, int Operand> static inline void RotateShiftRegister(Cpu::State &state)
+{
+	Operand8<Operand>::Write(state, RotateShift<Operation, true>(state, Operand8<Operand>::Read(state)));
+	state.Cycles += (Operand == OPERAND_HL) ? 16 : 8;
+}
+
+// BIT b,r
+template <int Bit, int Operand> static inline void Test(Cpu::State &state)
+{
+	MaterializeFlags(state);
+
+	BYTE &F = state.AF.lo;
+
+	F &= ~(FLAG_MASK_Z | FLAG_MASK_N);
+	F |= FLAG_MASK_H;
+
+	if (!(Operand8<Operand>::Read(state) & (1 << Bit))) F |= FLAG_MASK_Z;
+
+	state.Cycles += (Operand == OPERAND_HL) ? 16 : 8;
+}
+
+// RES b,r
+template <int Bit, int Operand> static inline void Reset(Cpu::State &state)
+{
+	Operand8<Operand>::Write(state, Operand8<Operand>::Read(state) & ~(1 << Bit));
+	state.Cycles += (Operand == OPERAND_HL) ? 16 : 8;
+}
+
+// SET b,r
+template <int Bit, int Operand> static inline void Set(Cpu::State &state)
+{
+	Operand8<Operand>::Write(state, Operand8<Operand>::Read(state) | (1 << Bit));
+	state.Cycles += (Operand == OPERAND_HL) ? 16 : 8;
+}
+
+// # Sixteen Bit Handlers # //
+
+// ADD HL,rr
+static inline void AddHL(Cpu::State &state, WORD val2)
+{
+	MaterializeFlags(state);
+
+	WORD val = state.HL.reg;
+	BYTE &F = state.AF.lo;
+
+	F &= ~(FLAG_MASK_N | FLAG_MASK_H | FLAG_MASK_C);
+
+	if (((val & 0xFFF) + (val2 & 0xFFF)) > 0xFFF) F |= FLAG_MASK_H;
+	if ((val + val2) > 0xFFFF) F |= FLAG_MASK_C;
+
+	state.HL.reg = (val + val2);
+	state.Cycles += 8;
+}
+
+// push a word onto the stack
+static inline void Push(Cpu::State &state, WORD data)
+{
+	state.SP.reg -= 1;
+	Memory::Write(state.SP.reg, (data >> 8));
+	state.SP.reg -= 1;
+	Memory::Write(state.SP.reg, (data & 0xFF));
+}
+
+// pop a word from the stack
+static inline WORD Pop(Cpu::State &state)
+{
+	WORD data = Memory::ReadWord(state.SP.reg);
+	state.SP.reg += 2;
+
+	return data;
+}
+
+// # Flow Handlers # //
+
+// JR cc,r8
+static inline void JumpRelative(Cpu::State &state, bool condition)
+{
+	if (condition)
+	{
+		state.PC += (SIGNED_BYTE)state.Operand;
+		// add the correct extra cycles as the action took place
+		state.Cycles += 4;
+	}
+
+	state.PC += 1;
+	state.Cycles += 8;
+}
 
-	if (!Operation.Stop && !Operation.Halt)
+// JP cc,a16
+static inline void Jump(Cpu::State &state, bool condition, int cycles)
+{
+	state.Cycles += cycles;
+
+	if (condition)
 	{
-		PC += 1;
+		state.PC = state.Operand;
+		// add the correct extra cycles as the action took place
+		state.Cycles += 4;
+		return;
 	}
 
-	switch(Opcode)
+	state.PC += 2;
+}
+
+// CALL cc,a16
+static inline void Call(Cpu::State &state, bool condition)
+{
+	state.Cycles += 12;
+
+	if (condition)
 	{
-		case 0x00: Cycles += 4; break; // NOP
-		case 0x01: Ops::General::SixteenBit::Load(BC.reg, Memory::ReadWord(PC), 12); PC += 2; break; // LD BC,d16
-		case 0x02: Ops::General::EightBit::Write(BC.reg, AF.hi, 8); break; // LD (BC),A
-		case 0x03: Ops::Math::SixteenBit::Inc(BC.reg, 8); break; // INC BC
-		case 0x04: Ops::Math::EightBit::Inc(BC.hi, 4); break; // INC B
-		case 0x05: Ops::Math::EightBit::Dec(BC.hi, 4); break; // DEC B
-		case 0x06: Ops::General::EightBit::Load(BC.hi, Memory::ReadByte(PC), 8); PC += 1; break; // LD B,d8
-		case 0x07: Ops::Rotate::LeftCircular(AF.hi, false, 4); break; // RLCA
-		case 0x08: Ops::General::LoadSPA16(20); PC += 2; break; // LD (a16),SP
-		case 0x09: Ops::Math::SixteenBit::Add(HL.reg, BC.reg, 8); break; // ADD HL,BC
-		case 0x0A: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(BC.reg), 8); break; // LD A,(BC)
-		case 0x0B: Ops::Math::SixteenBit::Dec(BC.reg, 8); break; // DEC BC
-		case 0x0C: Ops::Math::EightBit::Inc(BC.lo, 4); break; // INC C
-		case 0x0D: Ops::Math::EightBit::Dec(BC.lo, 4); break; // DEC C
-		case 0x0E: Ops::General::EightBit::Load(BC.lo, Memory::ReadByte(PC), 8); PC += 1; break; // LD C,d8
-		case 0x0F: Ops::Rotate::RightCircular(AF.hi, false, 4); break; // RRCA
-		case 0x10: Ops::General::Stop(4); break; // STOP 0
-		case 0x11: Ops::General::SixteenBit::Load(DE.reg, Memory::ReadWord(PC), 12); PC += 2; break; // LD DE,d16
-		case 0x12: Ops::General::EightBit::Write(DE.reg, AF.hi, 8); break; // LD (DE),A
-		case 0x13: Ops::Math::SixteenBit::Inc(DE.reg, 8); break; // INC DE
-		case 0x14: Ops::Math::EightBit::Inc(DE.hi, 4); break; // INC D
-		case 0x15: Ops::Math::EightBit::Dec(DE.hi, 4); break; // DEC D
-		case 0x16: Ops::General::EightBit::Load(DE.hi, Memory::ReadByte(PC), 8); PC += 1; break; // LD D,d8
-		case 0x17: Ops::Rotate::LeftCarry(AF.hi, false, 4); break; // RLA
-		case 0x18: Ops::Flow::JumpImmediate(true, 8); break; // JR r8
-		case 0x19: Ops::Math::SixteenBit::Add(HL.reg, DE.reg, 8); break; // ADD HL,DE
-		case 0x1A: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(DE.reg), 8); break; // LD A,(DE)
-		case 0x1B: Ops::Math::SixteenBit::Dec(DE.reg, 8); break; // DEC DE
-		case 0x1C: Ops::Math::EightBit::Inc(DE.lo, 4); break; // INC E
-		case 0x1D: Ops::Math::EightBit::Dec(DE.lo, 4); break; // DEC E
-		case 0x1E: Ops::General::EightBit::Load(DE.lo, Memory::ReadByte(PC), 8); PC += 1; break; // LD E,d8
-		case 0x1F: Ops::Rotate::RightCarry(AF.hi, false, 4); break; // RRA
-		case 0x20: Ops::Flow::JumpImmediate(!Flags::Get::Z(), 8); break; // JR NZ,r8
-		case 0x21: Ops::General::SixteenBit::Load(HL.reg, Memory::ReadWord(PC), 12); PC += 2; break; // LD HL,d16
-		case 0x22: Ops::General::EightBit::Write(HL.reg, AF.hi, 8); HL.reg += 1; break; // LD (HL+),A
-		case 0x23: Ops::Math::SixteenBit::Inc(HL.reg, 8); break; // INC HL
-		case 0x24: Ops::Math::EightBit::Inc(HL.hi, 4); break; // INC H
-		case 0x25: Ops::Math::EightBit::Dec(HL.hi, 4); break; // DEC H
-		case 0x26: Ops::General::EightBit::Load(HL.hi, Memory::ReadByte(PC), 8); PC += 1; break; // LD H,d8
-		case 0x27: Ops::Math::DAA(4); break; // DAA
-		case 0x28: Ops::Flow::JumpImmediate(Flags::Get::Z(), 8); break; // JR Z,r8
-		case 0x29: Ops::Math::SixteenBit::Add(HL.reg, HL.reg, 8); break; // ADD HL,HL
-		case 0x2A: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(HL.reg), 8); HL.reg += 1; break; // LD A,(HL+)
-		case 0x2B: Ops::Math::SixteenBit::Dec(HL.reg, 8); break; // DEC HL
-		case 0x2C: Ops::Math::EightBit::Inc(HL.lo, 4); break; // INC L
-		case 0x2D: Ops::Math::EightBit::Dec(HL.lo, 4); break; // DEC L
-		case 0x2E: Ops::General::EightBit::Load(HL.lo, Memory::ReadByte(PC), 8); PC += 1; break; // LD L,d8
-		case 0x2F: Ops::General::ComplementA(AF.hi, 4); break; // CPL
-		case 0x30: Ops::Flow::JumpImmediate(!Flags::Get::C(), 8); break; // JR NC,r8
-		case 0x31: Ops::General::SixteenBit::Load(SP.reg, Memory::ReadWord(PC), 12); PC += 2; break; // LD SP,d16
-		case 0x32: Ops::General::EightBit::Write(HL.reg, AF.hi, 8); HL.reg -= 1; break; // LD (HL-),A
-		case 0x33: Ops::Math::SixteenBit::Inc(SP.reg, 8); break; // INC SP
-		case 0x34: Ops::Math::EightBit::IncMemory(HL.reg, 12); break; // INC (HL)
-		case 0x35: Ops::Math::EightBit::DecMemory(HL.reg, 12); break; // DEC (HL)
-		case 0x36: Ops::General::EightBit::Write(HL.reg, Memory::ReadByte(PC), 8); PC += 1; break; // LD (HL),d8
-		case 0x37: Ops::General::SetCarryFlag(4); break; // SCF
-		case 0x38: Ops::Flow::JumpImmediate(Flags::Get::C(), 8); break; // JR C,r8
-		case 0x39: Ops::Math::SixteenBit::Add(HL.reg, SP.reg, 8); break; // ADD HL,SP
-		case 0x3A: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(HL.reg), 8); HL.reg -= 1; break; // LD A,(HL-)
-		case 0x3B: Ops::Math::SixteenBit::Dec(SP.reg, 8); break; // DEC SP
-		case 0x3C: Ops::Math::EightBit::Inc(AF.hi, 4); break; // INC A
-		case 0x3D: Ops::Math::EightBit::Dec(AF.hi, 4); break; // DEC A
-		case 0x3E: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // LD A,d8
-		case 0x3F: Ops::General::ComplementCarryFlag(4); break; // CCF
-		case 0x40: Ops::General::EightBit::Load(BC.hi, BC.hi, 4); break; // LD B,B
-		case 0x41: Ops::General::EightBit::Load(BC.hi, BC.lo, 4); break; // LD B,C
-		case 0x42: Ops::General::EightBit::Load(BC.hi, DE.hi, 4); break; // LD B,D
-		case 0x43: Ops::General::EightBit::Load(BC.hi, DE.lo, 4); break; // LD B,E
-		case 0x44: Ops::General::EightBit::Load(BC.hi, HL.hi, 4); break; // LD B,H
-		case 0x45: Ops::General::EightBit::Load(BC.hi, HL.lo, 4); break; // LD B,L
-		case 0x46: Ops::General::EightBit::Load(BC.hi, Memory::ReadByte(HL.reg), 8); break; // LD B,(HL)
-		case 0x47: Ops::General::EightBit::Load(BC.hi, AF.hi, 4); break; // LD B,A
-		case 0x48: Ops::General::EightBit::Load(BC.lo, BC.hi, 4); break; // LD C,B
-		case 0x49: Ops::General::EightBit::Load(BC.lo, BC.lo, 4); break; // LD C,C
-		case 0x4A: Ops::General::EightBit::Load(BC.lo, DE.hi, 4); break; // LD C,D
-		case 0x4B: Ops::General::EightBit::Load(BC.lo, DE.lo, 4); break; // LD C,E
-		case 0x4C: Ops::General::EightBit::Load(BC.lo, HL.hi, 4); break; // LD C,H
-		case 0x4D: Ops::General::EightBit::Load(BC.lo, HL.lo, 4); break; // LD C,L
-		case 0x4E: Ops::General::EightBit::Load(BC.lo, Memory::ReadByte(HL.reg), 8); break; // LD C,(HL)
-		case 0x4F: Ops::General::EightBit::Load(BC.lo, AF.hi, 4); break; // LD C,A
-		case 0x50: Ops::General::EightBit::Load(DE.hi, BC.hi, 4); break; // LD D,B
-		case 0x51: Ops::General::EightBit::Load(DE.hi, BC.lo, 4); break; // LD D,C
-		case 0x52: Ops::General::EightBit::Load(DE.hi, DE.hi, 4); break; // LD D,D
-		case 0x53: Ops::General::EightBit::Load(DE.hi, DE.lo, 4); break; // LD D,E
-		case 0x54: Ops::General::EightBit::Load(DE.hi, HL.hi, 4); break; // LD D,H
-		case 0x55: Ops::General::EightBit::Load(DE.hi, HL.lo, 4); break; // LD D,L
-		case 0x56: Ops::General::EightBit::Load(DE.hi, Memory::ReadByte(HL.reg), 8); break; // LD D,(HL)
-		case 0x57: Ops::General::EightBit::Load(DE.hi, AF.hi, 4); break; // LD D,A
-		case 0x58: Ops::General::EightBit::Load(DE.lo, BC.hi, 4); break; // LD E,B
-		case 0x59: Ops::General::EightBit::Load(DE.lo, BC.lo, 4); break; // LD E,C
-		case 0x5A: Ops::General::EightBit::Load(DE.lo, DE.hi, 4); break; // LD E,D
-		case 0x5B: Ops::General::EightBit::Load(DE.lo, DE.lo, 4); break; // LD E,E
-		case 0x5C: Ops::General::EightBit::Load(DE.lo, HL.hi, 4); break; // LD E,H
-		case 0x5D: Ops::General::EightBit::Load(DE.lo, HL.lo, 4); break; // LD E,L
-		case 0x5E: Ops::General::EightBit::Load(DE.lo, Memory::ReadByte(HL.reg), 8); break; // LD E,(HL)
-		case 0x5F: Ops::General::EightBit::Load(DE.lo, AF.hi, 4); break; // LD E,A
-		case 0x60: Ops::General::EightBit::Load(HL.hi, BC.hi, 4); break; // LD H,B
-		case 0x61: Ops::General::EightBit::Load(HL.hi, BC.lo, 4); break; // LD H,C
-		case 0x62: Ops::General::EightBit::Load(HL.hi, DE.hi, 4); break; // LD H,D
-		case 0x63: Ops::General::EightBit::Load(HL.hi, DE.lo, 4); break; // LD H,E
-		case 0x64: Ops::General::EightBit::Load(HL.hi, HL.hi, 4); break; // LD H,H
-		case 0x65: Ops::General::EightBit::Load(HL.hi, HL.lo, 4); break; // LD H,L
-		case 0x66: Ops::General::EightBit::Load(HL.hi, Memory::ReadByte(HL.reg), 8); break; // LD H,(HL)
-		case 0x67: Ops::General::EightBit::Load(HL.hi, AF.hi, 4); break; // LD H,A
-		case 0x68: Ops::General::EightBit::Load(HL.lo, BC.hi, 4); break; // LD L,B
-		case 0x69: Ops::General::EightBit::Load(HL.lo, BC.lo, 4); break; // LD L,C
-		case 0x6A: Ops::General::EightBit::Load(HL.lo, DE.hi, 4); break; // LD L,D
-		case 0x6B: Ops::General::EightBit::Load(HL.lo, DE.lo, 4); break; // LD L,E
-		case 0x6C: Ops::General::EightBit::Load(HL.lo, HL.hi, 4); break; // LD L,H
-		case 0x6D: Ops::General::EightBit::Load(HL.lo, HL.lo, 4); break; // LD L,L
-		case 0x6E: Ops::General::EightBit::Load(HL.lo, Memory::ReadByte(HL.reg), 8); break; // LD L,(HL)
-		case 0x6F: Ops::General::EightBit::Load(HL.lo, AF.hi, 4); break; // LD L,A
-		case 0x70: Ops::General::EightBit::Write(HL.reg, BC.hi, 8); break; // LD (HL),B
-		case 0x71: Ops::General::EightBit::Write(HL.reg, BC.lo, 8); break; // LD (HL),C
-		case 0x72: Ops::General::EightBit::Write(HL.reg, DE.hi, 8); break; // LD (HL),D
-		case 0x73: Ops::General::EightBit::Write(HL.reg, DE.lo, 8); break; // LD (HL),E
-		case 0x74: Ops::General::EightBit::Write(HL.reg, HL.hi, 8); break; // LD (HL),H
-		case 0x75: Ops::General::EightBit::Write(HL.reg, HL.lo, 8); break; // LD (HL),L
-		case 0x76: Ops::General::Halt(4); break; // HALT
-		case 0x77: Ops::General::EightBit::Write(HL.reg, AF.hi, 8); break; // LD (HL),A
-		case 0x78: Ops::General::EightBit::Load(AF.hi, BC.hi, 4); break; // LD A,B
-		case 0x79: Ops::General::EightBit::Load(AF.hi, BC.lo, 4); break; // LD A,C
-		case 0x7A: Ops::General::EightBit::Load(AF.hi, DE.hi, 4); break; // LD A,D
-		case 0x7B: Ops::General::EightBit::Load(AF.hi, DE.lo, 4); break; // LD A,E
-		case 0x7C: Ops::General::EightBit::Load(AF.hi, HL.hi, 4); break; // LD A,H
-		case 0x7D: Ops::General::EightBit::Load(AF.hi, HL.lo, 4); break; // LD A,L
-		case 0x7E: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(HL.reg), 8); break; // LD A,(HL)
-		case 0x7F: Ops::General::EightBit::Load(AF.hi, AF.hi, 4); break; // LD A,A
-		case 0x80: Ops::Math::EightBit::Add(AF.hi, BC.hi, 4); break; // ADD A,B
-		case 0x81: Ops::Math::EightBit::Add(AF.hi, BC.lo, 4); break; // ADD A,C
-		case 0x82: Ops::Math::EightBit::Add(AF.hi, DE.hi, 4); break; // ADD A,D
-		case 0x83: Ops::Math::EightBit::Add(AF.hi, DE.lo, 4); break; // ADD A,E
-		case 0x84: Ops::Math::EightBit::Add(AF.hi, HL.hi, 4); break; // ADD A,H
-		case 0x85: Ops::Math::EightBit::Add(AF.hi, HL.lo, 4); break; // ADD A,L
-		case 0x86: Ops::Math::EightBit::Add(AF.hi, Memory::ReadByte(HL.reg), 8); break; // ADD A,(HL)
-		case 0x87: Ops::Math::EightBit::Add(AF.hi, AF.hi, 4); break; // ADD A,A
-		case 0x88: Ops::Math::EightBit::AddCarry(AF.hi, BC.hi, 4); break; // ADC A,B
-		case 0x89: Ops::Math::EightBit::AddCarry(AF.hi, BC.lo, 4); break; // ADC A,C
-		case 0x8A: Ops::Math::EightBit::AddCarry(AF.hi, DE.hi, 4); break; // ADC A,D
-		case 0x8B: Ops::Math::EightBit::AddCarry(AF.hi, DE.lo, 4); break; // ADC A,E
-		case 0x8C: Ops::Math::EightBit::AddCarry(AF.hi, HL.hi, 4); break; // ADC A,H
-		case 0x8D: Ops::Math::EightBit::AddCarry(AF.hi, HL.lo, 4); break; // ADC A,L
-		case 0x8E: Ops::Math::EightBit::AddCarry(AF.hi, Memory::ReadByte(HL.reg), 8); break; // ADC A,(HL)
-		case 0x8F: Ops::Math::EightBit::AddCarry(AF.hi, AF.hi, 4); break; // ADC A,A
-		case 0x90: Ops::Math::EightBit::Sub(AF.hi, BC.hi, 4); break; // SUB A,B
-		case 0x91: Ops::Math::EightBit::Sub(AF.hi, BC.lo, 4); break; // SUB A,C
-		case 0x92: Ops::Math::EightBit::Sub(AF.hi, DE.hi, 4); break; // SUB A,D
-		case 0x93: Ops::Math::EightBit::Sub(AF.hi, DE.lo, 4); break; // SUB A,E
-		case 0x94: Ops::Math::EightBit::Sub(AF.hi, HL.hi, 4); break; // SUB A,H
-		case 0x95: Ops::Math::EightBit::Sub(AF.hi, HL.lo, 4); break; // SUB A,L
-		case 0x96: Ops::Math::EightBit::Sub(AF.hi, Memory::ReadByte(HL.reg), 8); break; // SUB A,(HL)
-		case 0x97: Ops::Math::EightBit::Sub(AF.hi, AF.hi, 4); break; // SUB A,A
-		case 0x98: Ops::Math::EightBit::SubCarry(AF.hi, BC.hi, 4); break; // SBC A,B
-		case 0x99: Ops::Math::EightBit::SubCarry(AF.hi, BC.lo, 4); break; // SBC A,C
-		case 0x9A: Ops::Math::EightBit::SubCarry(AF.hi, DE.hi, 4); break; // SBC A,D
-		case 0x9B: Ops::Math::EightBit::SubCarry(AF.hi, DE.lo, 4); break; // SBC A,E
-		case 0x9C: Ops::Math::EightBit::SubCarry(AF.hi, HL.hi, 4); break; // SBC A,H
-		case 0x9D: Ops::Math::EightBit::SubCarry(AF.hi, HL.lo, 4); break; // SBC A,L
-		case 0x9E: Ops::Math::EightBit::SubCarry(AF.hi, Memory::ReadByte(HL.reg), 8); break; // SBC A,(HL)
-		case 0x9F: Ops::Math::EightBit::SubCarry(AF.hi, AF.hi, 4); break; // SBC A,A
-		case 0xA0: Ops::Math::EightBit::And(AF.hi, BC.hi, 4); break; // AND A,B
-		case 0xA1: Ops::Math::EightBit::And(AF.hi, BC.lo, 4); break; // AND A,C
-		case 0xA2: Ops::Math::EightBit::And(AF.hi, DE.hi, 4); break; // AND A,D
-		case 0xA3: Ops::Math::EightBit::And(AF.hi, DE.lo, 4); break; // AND A,E
-		case 0xA4: Ops::Math::EightBit::And(AF.hi, HL.hi, 4); break; // AND A,H
-		case 0xA5: Ops::Math::EightBit::And(AF.hi, HL.lo, 4); break; // AND A,L
-		case 0xA6: Ops::Math::EightBit::And(AF.hi, Memory::ReadByte(HL.reg), 8); break; // AND A,(HL)
-		case 0xA7: Ops::Math::EightBit::And(AF.hi, AF.hi, 4); break; // AND A,A
-		case 0xA8: Ops::Math::EightBit::Xor(AF.hi, BC.hi, 4); break; // XOR A,B
-		case 0xA9: Ops::Math::EightBit::Xor(AF.hi, BC.lo, 4); break; // XOR A,C
-		case 0xAA: Ops::Math::EightBit::Xor(AF.hi, DE.hi, 4); break; // XOR A,D
-		case 0xAB: Ops::Math::EightBit::Xor(AF.hi, DE.hi, 4); break; // XOR A,E
-		case 0xAC: Ops::Math::EightBit::Xor(AF.hi, HL.hi, 4); break; // XOR A,H
-		case 0xAD: Ops::Math::EightBit::Xor(AF.hi, HL.lo, 4); break; // XOR A,L
-		case 0xAE: Ops::Math::EightBit::Xor(AF.hi, Memory::ReadByte(HL.reg), 8); break; // XOR A,(HL)
-		case 0xAF: Ops::Math::EightBit::Xor(AF.hi, AF.hi, 4); break; // XOR A,A
-		case 0xB0: Ops::Math::EightBit::Or(AF.hi, BC.hi, 4); break; // OR A,B
-		case 0xB1: Ops::Math::EightBit::Or(AF.hi, BC.lo, 4); break; // OR A,C
-		case 0xB2: Ops::Math::EightBit::Or(AF.hi, DE.hi, 4); break; // OR A,D
-		case 0xB3: Ops::Math::EightBit::Or(AF.hi, DE.lo, 4); break; // OR A,E
-		case 0xB4: Ops::Math::EightBit::Or(AF.hi, HL.hi, 4); break; // OR A,H
-		case 0xB5: Ops::Math::EightBit::Or(AF.hi, HL.lo, 4); break; // OR A,L
-		case 0xB6: Ops::Math::EightBit::Or(AF.hi, Memory::ReadByte(HL.reg), 8); break; // OR A,(HL)
-		case 0xB7: Ops::Math::EightBit::Or(AF.hi, AF.hi, 4); break; // OR A,A
-		case 0xB8: Ops::Math::EightBit::Compare(AF.hi, BC.hi, 4); break; // CP A,B
-		case 0xB9: Ops::Math::EightBit::Compare(AF.hi, BC.lo, 4); break; // CP A,C
-		case 0xBA: Ops::Math::EightBit::Compare(AF.hi, DE.hi, 4); break; // CP A,D
-		case 0xBB: Ops::Math::EightBit::Compare(AF.hi, DE.lo, 4); break; // CP A,E
-		case 0xBC: Ops::Math::EightBit::Compare(AF.hi, HL.hi, 4); break; // CP A,H
-		case 0xBD: Ops::Math::EightBit::Compare(AF.hi, HL.lo, 4); break; // CP A,L
-		case 0xBE: Ops::Math::EightBit::Compare(AF.hi, Memory::ReadByte(HL.reg), 8); break; // CP A,(HL)
-		case 0xBF: Ops::Math::EightBit::Compare(AF.hi, AF.hi, 4); break; // CP A,A
-		case 0xC0: Ops::Flow::Return(!Flags::Get::Z(), 8); break; // RET NZ
-		case 0xC1: BC.reg = Memory::Pop(); Cycles += 12; break; // POP BC
-		case 0xC2: Ops::Flow::Jump(!Flags::Get::Z(), 12); break; // JP NZ,a16
-		case 0xC3: Ops::Flow::Jump(true, 12); break; // JP a16
-		case 0xC4: Ops::Flow::Call(!Flags::Get::Z(), 12); break; // CALL NZ,a16
-		case 0xC5: Memory::Push(BC.reg); Cycles += 16; break; // PUSH BC
-		case 0xC6: Ops::Math::EightBit::Add(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // ADD A,d8
-		case 0xC7: Ops::Flow::Restart(0x00, 32); break; // RST 00H
-		case 0xC8: Ops::Flow::Return(Flags::Get::Z(), 8); break; // RET Z
-		case 0xC9: Ops::Flow::Return(true, 8); break; // RET
-		case 0xCA: Ops::Flow::Jump(Flags::Get::Z(), 8); break; // JP Z,a16
-		case 0xCB: ExecuteExtendedOpcode(); Cycles += 4; break; // PREFIX CB
-		case 0xCC: Ops::Flow::Call(Flags::Get::Z(), 12); break; // CALL Z,a16
-		case 0xCD: Ops::Flow::Call(true, 12); break; // CALL a16
-		case 0xCE: Ops::Math::EightBit::AddCarry(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // ADC A,d8
-		case 0xCF: Ops::Flow::Restart(0x08, 32); break; // RST 08H
-		case 0xD0: Ops::Flow::Return(!Flags::Get::C(), 8); break; // RET NC
-		case 0xD1: DE.reg = Memory::Pop(); Cycles += 12; break; // POP DE
-		case 0xD2: Ops::Flow::Jump(!Flags::Get::C(), 8); break; // JP NC,a16
-		case 0xD4: Ops::Flow::Call(!Flags::Get::C(), 12); break; // CALL NC,a16
-		case 0xD5: Memory::Push(DE.reg); Cycles += 16; break; // PUSH DE
-		case 0xD6: Ops::Math::EightBit::Sub(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // SUB A,d8
-		case 0xD7: Ops::Flow::Restart(0x10, 32); break; // RST 10H
-		case 0xD8: Ops::Flow::Return(Flags::Get::C(), 8); break; // RET C
-		case 0xD9: Ops::Flow::Return(true, 8); Interrupt::MasterSwitch = true; break; // RETI
-		case 0xDA: Ops::Flow::Jump(Flags::Get::C(), 8); break; // JP C,a16
-		case 0xDC: Ops::Flow::Call(Flags::Get::C(), 12); break; // CALL C,a16
-		case 0xDE: Ops::Math::EightBit::SubCarry(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // SBC A,d8
-		case 0xDF: Ops::Flow::Restart(0x18, 32); break; // RST 18H
-		case 0xE0: Ops::General::EightBit::Write(0xFF00 + Memory::ReadByte(PC), AF.hi, 12); PC += 1; break; // LDH (FF00 + a8),A
-		case 0xE1: HL.reg = Memory::Pop(); Cycles += 12; break; // POP HL
-		case 0xE2: Ops::General::EightBit::Write(0xFF00 + Memory::ReadByte(BC.lo), AF.hi, 8); break; // LD (C),A
-		case 0xE5: Memory::Push(HL.reg); Cycles += 16; break; // PUSH HL
-		case 0xE6: Ops::Math::EightBit::And(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // AND A,d8
-		case 0xE7: Ops::Flow::Restart(0x20, 32); break; // RST 20H
-		case 0xE8: Ops::Math::AddStackPointerR8(16); PC += 1; break; // ADD SP,r8
-		case 0xE9: PC = HL.reg; Cycles += 4; break; // JP HL
-		case 0xEA: Ops::General::EightBit::Write(Memory::ReadWord(PC), AF.hi, 16); PC += 2; break; // LD (a16),A
-		case 0xEE: Ops::Math::EightBit::Xor(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // XOR A, d8
-		case 0xEF: Ops::Flow::Restart(0x28, 32); break; // RST 28H
-		case 0xF0: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(0xFF00 + Memory::ReadByte(PC)), 12); PC += 1; break; // LDH A,(FF00 + a8)
-		case 0xF1: AF.reg = (Memory::Pop() & ~0xF); Cycles += 12; break; // POP AF
-		case 0xF2: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(0xFF00 + BC.lo), 8); break; // LD A,(FF00 + C)
-		case 0xF3: Interrupt::MasterSwitch = false; Cycles += 4; break; // DI
-		case 0xF5: Memory::Push(AF.reg); Cycles += 16; break; // PUSH AF
-		case 0xF6: Ops::Math::EightBit::Or(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // OR A,d8
-		case 0xF7: Ops::Flow::Restart(0x30, 32); break; // RST 30H
-		case 0xF8: Ops::General::LoadHLSPR8(12); PC += 1; break; // LD HL,SP+r8
-		case 0xF9: Ops::General::SixteenBit::Load(SP.reg, HL.reg, 8); break; // LD SP,HL
-		case 0xFA: Ops::General::EightBit::Load(AF.hi, Memory::ReadByte(Memory::ReadWord(PC)), 16); PC += 2; break; // LD A,(a16)
-		case 0xFB: Operation.PendingInterruptEnabled = true; Cycles += 4; break; // EI
-		case 0xFE: Ops::Math::EightBit::Compare(AF.hi, Memory::ReadByte(PC), 8); PC += 1; break; // CP A,d8
-		case 0xFF: Ops::Flow::Restart(0x38, 32); break; // RST 38H
-		default: Log::UnimplementedOpcode(Opcode); break;
+		// push the address of the next instruction to the stack
+		Push(state, state.PC + 2);
+		// call the instruction at nn
+		state.PC = state.Operand;
+		// add the correct extra cycles as the action took place
+		state.Cycles += 12;
+		return;
 	}
 
-	// enable interrupts if requested
-	if (Operation.PendingInterruptEnabled)
+	state.PC += 2;
+}
+
+// RET cc
+static inline void Return(Cpu::State &state, bool condition)
+{
+	if (condition)
+	{
+		state.PC = Pop(state);
+		// add the correct extra cycles as the action took place
+		state.Cycles += 12;
+	}
+
+	state.Cycles += 8;
+}
+
+// RST n
+static inline void Restart(Cpu::State &state, WORD address)
+{
+	Push(state, state.PC);
+	state.PC = address;
+	state.Cycles += 32;
+}
+
+// # Handler Tables # //
+
+// compile-time sequence of opcodes (used to generate the handler tables)
+template <int... Opcodes> struct OpcodeSequence {};
+template <int Count, int... Opcodes> struct MakeOpcodeSequence : MakeOpcodeSequence<Count - 1, Count - 1, Opcodes...> {};
+template <int... Opcodes> struct MakeOpcodeSequence<0, Opcodes...> { typedef OpcodeSequence<Opcodes...> Type; };
+
+// a table holding the handler of every opcode
+template <template <int> class Instruction, typename Sequence> struct HandlerTable;
+template <template <int> class Instruction, int... Opcodes> struct HandlerTable<Instruction, OpcodeSequence<Opcodes...> >
+{
+	static constexpr Handler Handlers[sizeof...(Opcodes)] = { &Instruction<Opcodes>::Execute... };
+};
+
+template <template <int> class Instruction, int... Opcodes>
+constexpr Handler HandlerTable<Instruction, OpcodeSequence<Opcodes...> >::Handlers[sizeof...(Opcodes)];
+
+// extended (CB prefixed) opcodes
+template <int Opcode> struct ExtendedInstruction
+{
+	static void Execute(Cpu::State &state)
+	{
+		const int operation = ((Opcode >> 3) & 7);
+		const int operand = (Opcode & 7);
+
+		switch(Opcode >> 6)
+		{
+			case 0: RotateShiftRegister<operation, operand>(state); break; // RLC/RRC/RL/RR/SLA/SRA/SWAP/SRL r
+			case 1: Test<operation, operand>(state); break; // BIT b,r
+			case 2: Reset<operation, operand>(state); break; // RES b,r
+			case 3: Set<operation, operand>(state); break; // SET b,r
+		}
+	}
+};
+
+// the extended opcode table
+typedef HandlerTable<ExtendedInstruction, MakeOpcodeSequence<256>::Type> ExtendedInstructions;
+
+// execute the extended opcode (the immediate data of the CB prefix)
+static inline void ExecuteExtended(Cpu::State &state)
+{
+	BYTE Opcode = (BYTE)state.Operand;
+	state.PC += 1;
+
+	ExtendedInstructions::Handlers[Opcode](state);
+}
+
+// opcodes
+template <int Opcode> struct Instruction
+{
+	static void Execute(Cpu::State &state)
+	{
+		const int x = (Opcode >> 6);
+		const int y = ((Opcode >> 3) & 7);
+		const int z = (Opcode & 7);
+
+		// the regular blocks, specialized per operand
+		if (x == 1 && Opcode != 0x76) { Load<y, z>(state); return; } // LD r,r'
+		if (x == 2) { AluRegister<y, z>(state); return; } // ALU A,r
+		if (x == 0 && z == 4) { Inc<y>(state); return; } // INC r
+		if (x == 0 && z == 5) { Dec<y>(state); return; } // DEC r
+		if (x == 0 && z == 6) { LoadImmediate<y>(state); return; } // LD r,d8
+		if (x == 3 && z == 6) { AluImmediate<y>(state); return; } // ALU A,d8
+		if (x == 3 && z == 7) { Restart(state, (Opcode & 0x38)); return; } // RST n
+
+		// everything else
+		WORD &PC = state.PC;
+		BYTE &A = state.AF.hi;
+		int &Cycles = state.Cycles;
+
+		switch(Opcode)
+		{
+			case 0x00: Cycles += 4; break; // NOP
+			case 0x01: state.BC.reg = state.Operand; PC += 2; Cycles += 12; break; // LD BC,d16
+			case 0x02: Memory::Write(state.BC.reg, A); Cycles += 8; break; // LD (BC),A
+			case 0x03: state.BC.reg += 1; Cycles += 8; break; // INC BC
+			case 0x07: A = RotateShift<ROTATE_RLC, false>(state, A); Cycles += 4; break; // RLCA
+			case 0x08: Ops::General::LoadSPA16(20); PC += 2; break; // LD (a16),SP
+			case 0x09: AddHL(state, state.BC.reg); break; // ADD HL,BC
+			case 0x0A: A = Memory::ReadByte(state.BC.reg); Cycles += 8; break; // LD A,(BC)
+			case 0x0B: state.BC.reg -= 1; Cycles += 8; break; // DEC BC
+			case 0x0F: A = RotateShift<ROTATE_RRC, false>(state, A); Cycles += 4; break; // RRCA
+			case 0x10: Ops::General::Stop(4); break; // STOP 0
+			case 0x11: state.DE.reg = state.Operand; PC += 2; Cycles += 12; break; // LD DE,d16
+			case 0x12: Memory::Write(state.DE.reg, A); Cycles += 8; break; // LD (DE),A
+			case 0x13: state.DE.reg += 1; Cycles += 8; break; // INC DE
+			case 0x17: A = RotateShift<ROTATE_RL, false>(state, A); Cycles += 4; break; // RLA
+			case 0x18: JumpRelative(state, true); break; // JR r8
+			case 0x19: AddHL(state, state.DE.reg); break; // ADD HL,DE
+			case 0x1A: A = Memory::ReadByte(state.DE.reg); Cycles += 8; break; // LD A,(DE)
+			case 0x1B: state.DE.reg -= 1; Cycles += 8; break; // DEC DE
+			case 0x1F: A = RotateShift<ROTATE_RR, false>(state, A); Cycles += 4; break; // RRA
+			case 0x20: JumpRelative(state, !FlagZ(state)); break; // JR NZ,r8
+			case 0x21: state.HL.reg = state.Operand; PC += 2; Cycles += 12; break; // LD HL,d16
+			case 0x22: Memory::Write(state.HL.reg, A); state.HL.reg += 1; Cycles += 8; break; // LD (HL+),A
+			case 0x23: state.HL.reg += 1; Cycles += 8; break; // INC HL
+			case 0x27: Ops::Math::DAA(4); break; // DAA
+			case 0x28: JumpRelative(state, FlagZ(state)); break; // JR Z,r8
+			case 0x29: AddHL(state, state.HL.reg); break; // ADD HL,HL
+			case 0x2A: A = Memory::ReadByte(state.HL.reg); state.HL.reg += 1; Cycles += 8; break; // LD A,(HL+)
+			case 0x2B: state.HL.reg -= 1; Cycles += 8; break; // DEC HL
+			case 0x2F: Ops::General::ComplementA(A, 4); break; // CPL
+			case 0x30: JumpRelative(state, !FlagC(state)); break; // JR NC,r8
+			case 0x31: state.SP.reg = state.Operand; PC += 2; Cycles += 12; break; // LD SP,d16
+			case 0x32: Memory::Write(state.HL.reg, A); state.HL.reg -= 1; Cycles += 8; break; // LD (HL-),A
+			case 0x33: state.SP.reg += 1; Cycles += 8; break; // INC SP
+			case 0x37: Ops::General::SetCarryFlag(4); break; // SCF
+			case 0x38: JumpRelative(state, FlagC(state)); break; // JR C,r8
+			case 0x39: AddHL(state, state.SP.reg); break; // ADD HL,SP
+			case 0x3A: A = Memory::ReadByte(state.HL.reg); state.HL.reg -= 1; Cycles += 8; break; // LD A,(HL-)
+			case 0x3B: state.SP.reg -= 1; Cycles += 8; break; // DEC SP
+			case 0x3F: Ops::General::ComplementCarryFlag(4); break; // CCF
+			case 0x76: Ops::General::Halt(4); break; // HALT
+			case 0xC0: Return(state, !FlagZ(state)); break; // RET NZ
+			case 0xC1: state.BC.reg = Pop(state); Cycles += 12; break; // POP BC
+			case 0xC2: Jump(state, !FlagZ(state), 12); break; // JP NZ,a16
+			case 0xC3: Jump(state, true, 12); break; // JP a16
+			case 0xC4: Call(state, !FlagZ(state)); break; // CALL NZ,a16
+			case 0xC5: Push(state, state.BC.reg); Cycles += 16; break; // PUSH BC
+			case 0xC8: Return(state, FlagZ(state)); break; // RET Z
+			case 0xC9: Return(state, true); break; // RET
+			case 0xCA: Jump(state, FlagZ(state), 8); break; // JP Z,a16
+			case 0xCB: ExecuteExtended(state); Cycles += 4; break; // PREFIX CB
+			case 0xCC: Call(state, FlagZ(state)); break; // CALL Z,a16
+			case 0xCD: Call(state, true); break; // CALL a16
+			case 0xD0: Return(state, !FlagC(state)); break; // RET NC
+			case 0xD1: state.DE.reg = Pop(state); Cycles += 12; break; // POP DE
+			case 0xD2: Jump(state, !FlagC(state), 8); break; // JP NC,a16
+			case 0xD4: Call(state, !FlagC(state)); break; // CALL NC,a16
+			case 0xD5: Push(state, state.DE.reg); Cycles += 16; break; // PUSH DE
+			case 0xD8: Return(state, FlagC(state)); break; // RET C
+			case 0xD9: Return(state, true); Interrupt::Set::MasterSwitch(true); break; // RETI
+			case 0xDA: Jump(state, FlagC(state), 8); break; // JP C,a16
+			case 0xDC: Call(state, FlagC(state)); break; // CALL C,a16
+			case 0xE0: Memory::Write(0xFF00 + (BYTE)state.Operand, A); PC += 1; Cycles += 12; break; // LDH (FF00 + a8),A
+			case 0xE1: state.HL.reg = Pop(state); Cycles += 12; break; // POP HL
+			case 0xE2: Memory::Write(0xFF00 + state.BC.lo, A); Cycles += 8; break; // LD (FF00 + C),A
+			case 0xE5: Push(state, state.HL.reg); Cycles += 16; break; // PUSH HL
+			case 0xE8: Ops::Math::AddStackPointerR8(16); PC += 1; break; // ADD SP,r8
+			case 0xE9: PC = state.HL.reg; Cycles += 4; break; // JP HL
+			case 0xEA: Memory::Write(state.Operand, A); PC += 2; Cycles += 16; break; // LD (a16),A
+			case 0xF0: A = Memory::ReadByte(0xFF00 + (BYTE)state.Operand); PC += 1; Cycles += 12; break; // LDH A,(FF00 + a8)
+			case 0xF1: state.AF.reg = (Pop(state) & ~0xF); state.Flags.Operation = PENDING_NONE; Cycles += 12; break; // POP AF
+			case 0xF2: A = Memory::ReadByte(0xFF00 + state.BC.lo); Cycles += 8; break; // LD A,(FF00 + C)
+			case 0xF3: Interrupt::Set::MasterSwitch(false); Cycles += 4; break; // DI
+			case 0xF5: MaterializeFlags(state); Push(state, state.AF.reg); Cycles += 16; break; // PUSH AF
+			case 0xF8: Ops::General::LoadHLSPR8(12); PC += 1; break; // LD HL,SP+r8
+			case 0xF9: state.SP.reg = state.HL.reg; Cycles += 8; break; // LD SP,HL
+			case 0xFA: A = Memory::ReadByte(state.Operand); PC += 2; Cycles += 16; break; // LD A,(a16)
+			case 0xFB: state.Operation.PendingInterruptEnabled = true; Cycles += 4; break; // EI
+			default: Log::UnimplementedOpcode(Opcode); break;
+		}
+	}
+};
+
+// the opcode table
+typedef HandlerTable<Instruction, MakeOpcodeSequence<256>::Type> Instructions;
+
+// the length of an instruction, in bytes
+static constexpr int InstructionLength(int opcode)
+{
+	return
+		// LD rr,d16, LD (a16),SP, JP a16, CALL a16, LD (a16),A and LD A,(a16)
+		(((opcode & 0xCF) == 0x01) || opcode == 0x08 || opcode == 0xC3 || opcode == 0xCD || opcode == 0xEA || opcode == 0xFA ||
+		((opcode & 0xE7) == 0xC2) || ((opcode & 0xE7) == 0xC4)) ? 3 :
+		// LD r,d8, ALU A,d8, JR, LDH, ADD SP,r8, LD HL,SP+r8 and the CB prefix
+		(((opcode & 0xC7) == 0x06) || ((opcode & 0xC7) == 0xC6) || opcode == 0x18 || ((opcode & 0xE7) == 0x20) ||
+		opcode == 0xE0 || opcode == 0xF0 || opcode == 0xE8 || opcode == 0xF8 || opcode == 0xCB) ? 2 : 1;
+}
+
+// the instruction lengths, for decoding
+template <int... Opcodes> struct LengthTable
+{
+	static constexpr BYTE Lengths[sizeof...(Opcodes)] = { InstructionLength(Opcodes)... };
+};
+
+template <int... Opcodes> constexpr BYTE LengthTable<Opcodes...>::Lengths[sizeof...(Opcodes)];
+
+template <typename Sequence> struct InstructionLengths;
+template <int... Opcodes> struct InstructionLengths<OpcodeSequence<Opcodes...> > : LengthTable<Opcodes...> {};
+
+typedef InstructionLengths<MakeOpcodeSequence<256>::Type> Lengths;
+
+// decode a run of code (an instruction whose immediate data runs past the end is left to memory)
+void Cpu::Decode(const BYTE *data, int size, Decoded *code)
+{
+	for (int i = 0; i < size; i++)
+	{
+		int length = Lengths::Lengths[data[i]];
+
+		code[i].Opcode = data[i];
+		code[i].Length = ((i + length) <= size) ? length : 0;
+		code[i].Operand = 0;
+
+		if (code[i].Length == 2) code[i].Operand = data[i + 1];
+		if (code[i].Length == 3) code[i].Operand = (data[i + 1] | (data[i + 2] << 8));
+	}
+}
+
+// fetch the next opcode (and its immediate data)
+static inline BYTE Fetch(Cpu::State &state)
+{
+	const Cpu::Decoded *code = Memory::ReadCode(state.PC);
+	BYTE Opcode;
+
+	// rom code is pre-decoded, anything else is decoded from memory
+	if (code != NULL && code->Length != 0)
+	{
+		Opcode = code->Opcode;
+		state.Operand = code->Operand;
+	}
+	else
+	{
+		Opcode = Memory::ReadByte(state.PC);
+
+		switch(Lengths::Lengths[Opcode])
+		{
+			case 2: state.Operand = Memory::ReadByte(state.PC + 1); break;
+			case 3: state.Operand = Memory::ReadWord(state.PC + 1); break;
+			default: break;
+		}
+	}
+
+	//Log::ToFile(state.PC, Opcode, Flags::Get::Z(), Flags::Get::N(), Flags::Get::H(), Flags::Get::C());
+	//Log::ExecutedOpcode(Opcode);
+
+	if (!state.Operation.Stop && !state.Operation.Halt)
+	{
+		state.PC += 1;
+	}
+
+	return Opcode;
+}
+
+// enable interrupts if requested
+static inline void EnablePendingInterrupts(Cpu::State &state)
+{
+	if (state.Operation.PendingInterruptEnabled)
 	{
 		// only enable the interrupt AFTER the next instruction has ran
-		if (interruptCounter == 2)
+		if (state.InterruptCounter == 2)
 		{
-			Interrupt::MasterSwitch = true;
-			interruptCounter = 0;
-			Operation.PendingInterruptEnabled = false;
+			Interrupt::Set::MasterSwitch(true);
+			state.InterruptCounter = 0;
+			state.Operation.PendingInterruptEnabled = false;
 		}
 
-		interruptCounter += 1;
+		state.InterruptCounter += 1;
 	}
 }
 
-// execute extended Opcode
-void Cpu::ExecuteExtendedOpcode()
+// finish an instruction (update the rest of the machine by the cycles it took)
+static inline void Retire(Cpu::State &state, Scheduler::State &scheduler, const BYTE *mem, int cycles)
 {
-	BYTE Opcode = Memory::ReadByte(PC);
-	PC += 1;
+	EnablePendingInterrupts(state);
+	// run the hardware events that are due
+	Scheduler::Advance(scheduler, cycles);
 
-	switch(Opcode)
+	// service interupts (only if one is requested and enabled)
+	if (mem[INT_REQUEST_ADDRESS] & mem[INT_ENABLED_ADDRESS] & 0x1F)
 	{
-		// 8-bit swap
-		case 0x30: Ops::Bits::Swap(BC.hi, 8); break; // SWAP B
-		case 0x31: Ops::Bits::Swap(BC.lo, 8); break; // SWAP C
-		case 0x32: Ops::Bits::Swap(DE.hi, 8); break; // SWAP D
-		case 0x33: Ops::Bits::Swap(DE.lo, 8); break; // SWAP E
-		case 0x34: Ops::Bits::Swap(HL.hi, 8); break; // SWAP H
-		case 0x35: Ops::Bits::Swap(HL.lo, 8); break; // SWAP L
-		case 0x36: Ops::Bits::SwapMemory(HL.reg, 16); break; // SWAP (HL)
-		case 0x37: Ops::Bits::Swap(AF.hi, 8); break; // SWAP A
-		// rotate left circular
-		case 0x00: Ops::Rotate::LeftCircular(BC.hi, 8, true); break; // RLC B
-		case 0x01: Ops::Rotate::LeftCircular(BC.lo, 8, true); break; // RLC C
-		case 0x02: Ops::Rotate::LeftCircular(DE.hi, 8, true); break; // RLC D
-		case 0x03: Ops::Rotate::LeftCircular(DE.lo, 8, true); break; // RLC E
-		case 0x04: Ops::Rotate::LeftCircular(HL.hi, 8, true); break; // RLC H
-		case 0x05: Ops::Rotate::LeftCircular(HL.lo, 8, true); break; // RLC L
-		case 0x06: Ops::Rotate::LeftCircularMemory(HL.reg, 16, true); break; // RLC (HL)
-		case 0x07: Ops::Rotate::LeftCircular(AF.hi, 8, true); break; // RLC A
-		// rotate right circular
-		case 0x08: Ops::Rotate::RightCircular(BC.hi, true, 8); break; // RRC B
-		case 0x09: Ops::Rotate::RightCircular(BC.lo, true, 8); break; // RRC C
-		case 0x0A: Ops::Rotate::RightCircular(DE.hi, true, 8); break; // RRC D
-		case 0x0B: Ops::Rotate::RightCircular(DE.lo, true, 8); break; // RRC E
-		case 0x0C: Ops::Rotate::RightCircular(HL.hi, true, 8); break; // RRC H
-		case 0x0D: Ops::Rotate::RightCircular(HL.lo, true, 8); break; // RRC L
-		case 0x0E: Ops::Rotate::RightCircularMemory(HL.reg, 16, true); break; // RRC (HL)
-		case 0x0F: Ops::Rotate::RightCircular(AF.hi, true, 8); break; // RRC A
-		// rotate left
-		case 0x10: Ops::Rotate::LeftCarry(BC.hi, true, 8); break; // RL B
-		case 0x11: Ops::Rotate::LeftCarry(BC.lo, true, 8); break; // RL C
-		case 0x12: Ops::Rotate::LeftCarry(DE.hi, true, 8); break; // RL D
-		case 0x13: Ops::Rotate::LeftCarry(DE.lo, true, 8); break; // RL E
-		case 0x14: Ops::Rotate::LeftCarry(HL.hi, true, 8); break; // RL H
-		case 0x15: Ops::Rotate::LeftCarry(HL.lo, true, 8); break; // RL L
-		case 0x16: Ops::Rotate::LeftCarryMemory(HL.reg, true, 16); break; // RL (HL)
-		case 0x17: Ops::Rotate::LeftCarry(AF.hi, true, 8); break; // RL A
-		// rotate right
-		case 0x18: Ops::Rotate::RightCarry(BC.hi, true, 8); break; // RR B
-		case 0x19: Ops::Rotate::RightCarry(BC.lo, true, 8); break; // RR C
-		case 0x1A: Ops::Rotate::RightCarry(DE.hi, true, 8); break; // RR D
-		case 0x1B: Ops::Rotate::RightCarry(DE.lo, true, 8); break; // RR E
-		case 0x1C: Ops::Rotate::RightCarry(HL.hi, true, 8); break; // RR H
-		case 0x1D: Ops::Rotate::RightCarry(HL.lo, true, 8); break; // RR L
-		case 0x1E: Ops::Rotate::RightCarryMemory(HL.reg, true, 16); break; // RR (HL)
-		case 0x1F: Ops::Rotate::RightCarry(AF.hi, true, 8); break; // RR A
-		// shift left
-		case 0x20: Ops::Shift::Left(BC.hi, 8); break; // SLA B
-		case 0x21: Ops::Shift::Left(BC.lo, 8); break; // SLA C
-		case 0x22: Ops::Shift::Left(DE.hi, 8); break; // SLA D
-		case 0x23: Ops::Shift::Left(DE.lo, 8); break; // SLA E
-		case 0x24: Ops::Shift::Left(HL.hi, 8); break; // SLA H
-		case 0x25: Ops::Shift::Left(HL.lo, 8); break; // SLA L
-		case 0x26: Ops::Shift::LeftMemory(HL.reg, 16); break; // SLA (HL)
-		case 0x27: Ops::Shift::Left(AF.hi, 8); break; // SLA A
-		// shift right
-		case 0x28: Ops::Shift::Right(BC.hi, 8); break; // SRA B
-		case 0x29: Ops::Shift::Right(BC.lo, 8); break; // SRA C
-		case 0x2A: Ops::Shift::Right(DE.hi, 8); break; // SRA D
-		case 0x2B: Ops::Shift::Right(DE.lo, 8); break; // SRA E
-		case 0x2C: Ops::Shift::Right(HL.hi, 8); break; // SRA H
-		case 0x2D: Ops::Shift::Right(HL.lo, 8); break; // SRA L
-		case 0x2E: Ops::Shift::RightMemory(HL.reg, 16); break; // SRA (HL)
-		case 0x2F: Ops::Shift::Right(AF.hi, 8); break; // SRA A
-		// shift right
-		case 0x38: Ops::Shift::RightCarry(BC.hi, 8); break; // SRL B
-		case 0x39: Ops::Shift::RightCarry(BC.lo, 8); break; // SRL C
-		case 0x3A: Ops::Shift::RightCarry(DE.hi, 8); break; // SRL D
-		case 0x3B: Ops::Shift::RightCarry(DE.lo, 8); break; // SRL E
-		case 0x3C: Ops::Shift::RightCarry(HL.hi, 8); break; // SRL H
-		case 0x3D: Ops::Shift::RightCarry(HL.lo, 8); break; // SRL L 
-		case 0x3E: Ops::Shift::RightCarryMemory(HL.reg, 16); break; // SRL (HL)
-		case 0x3F: Ops::Shift::RightCarry(AF.hi, 8); break; // SRL A
-		// test bit
-		case 0x40: Ops::Bits::Test(BC.hi, 0, 8); break; // BIT 0,B 
-		case 0x41: Ops::Bits::Test(BC.lo, 0, 8); break; // BIT 0,C
-		case 0x42: Ops::Bits::Test(DE.hi, 0, 8); break; // BIT 0,D
-		case 0x43: Ops::Bits::Test(DE.lo, 0, 8); break; // BIT 0,E
-		case 0x44: Ops::Bits::Test(HL.hi, 0, 8); break; // BIT 0,H
-		case 0x45: Ops::Bits::Test(HL.lo, 0, 8); break; // BIT 0,L
-		case 0x46: Ops::Bits::TestMemory(HL.reg, 0, 16); break; // BIT 0,(HL)
-		case 0x47: Ops::Bits::Test(AF.hi, 0, 8); break; // BIT 0,A
-		case 0x48: Ops::Bits::Test(BC.hi, 1, 8); break; // BIT 1,B
-		case 0x49: Ops::Bits::Test(BC.lo, 1, 8); break; // BIT 1,C
-		case 0x4A: Ops::Bits::Test(DE.hi, 1, 8); break; // BIT 1,D
-		case 0x4B: Ops::Bits::Test(DE.lo, 1, 8); break; // BIT 1,E
-		case 0x4C: Ops::Bits::Test(HL.hi, 1, 8); break; // BIT 1,H
-		case 0x4D: Ops::Bits::Test(HL.lo, 1, 8); break; // BIT 1,L
-		case 0x4E: Ops::Bits::TestMemory(HL.reg, 1, 16); break; // BIT 1,(HL)
-		case 0x4F: Ops::Bits::Test(AF.hi, 1, 8); break; // BIT 1,A
-		case 0x50: Ops::Bits::Test(BC.hi, 2, 8); break; // BIT 2,B
-		case 0x51: Ops::Bits::Test(BC.lo, 2, 8); break; // BIT 2,C
-		case 0x52: Ops::Bits::Test(DE.hi, 2, 8); break; // BIT 2,D
-		case 0x53: Ops::Bits::Test(DE.lo, 2, 8); break; // BIT 2,E
-		case 0x54: Ops::Bits::Test(HL.hi, 2, 8); break; // BIT 2,H
-		case 0x55: Ops::Bits::Test(HL.lo, 2, 8); break; // BIT 2,L
-		case 0x56: Ops::Bits::TestMemory(HL.reg, 2, 16); break; // BIT 2,(HL)
-		case 0x57: Ops::Bits::Test(AF.hi, 2, 8); break; // BIT 2,A
-		case 0x58: Ops::Bits::Test(BC.hi, 3, 8); break; // BIT 3,B
-		case 0x59: Ops::Bits::Test(BC.lo, 3, 8); break; // BIT 3,C 
-		case 0x5A: Ops::Bits::Test(DE.hi, 3, 8); break; // BIT 3,D
-		case 0x5B: Ops::Bits::Test(DE.lo, 3, 8); break; // BIT 3,E
-		case 0x5C: Ops::Bits::Test(HL.hi, 3, 8); break; // BIT 3,H
-		case 0x5D: Ops::Bits::Test(HL.lo, 3, 8); break; // BIT 3,L
-		case 0x5E: Ops::Bits::TestMemory(HL.reg, 3, 16); break; // BIT 3,(HL)
-		case 0x5F: Ops::Bits::Test(AF.hi, 3, 8); break; // BIT 3,A
-		case 0x60: Ops::Bits::Test(BC.hi, 4, 8); break; // BIT 4,B
-		case 0x61: Ops::Bits::Test(BC.lo, 4, 8); break; // BIT 4,C
-		case 0x62: Ops::Bits::Test(DE.hi, 4, 8); break; // BIT 4,D
-		case 0x63: Ops::Bits::Test(DE.lo, 4, 8); break; // BIT 4,E
-		case 0x64: Ops::Bits::Test(HL.hi, 4, 8); break; // BIT 4,H
-		case 0x65: Ops::Bits::Test(HL.lo, 4, 8); break; // BIT 4,L 
-		case 0x66: Ops::Bits::TestMemory(HL.reg, 4, 16); break; // BIT 4,(HL)
-		case 0x67: Ops::Bits::Test(AF.hi, 4, 8); break; // BIT 4,A
-		case 0x68: Ops::Bits::Test(BC.hi, 5, 8); break; // BIT 5,B
-		case 0x69: Ops::Bits::Test(BC.lo, 5, 8); break; // BIT 5,C 
-		case 0x6A: Ops::Bits::Test(DE.hi, 5, 8); break; // BIT 5,D
-		case 0x6B: Ops::Bits::Test(DE.lo, 5, 8); break; // BIT 5,E
-		case 0x6C: Ops::Bits::Test(HL.hi, 5, 8); break; // BIT 5,H
-		case 0x6D: Ops::Bits::Test(HL.lo, 5, 8); break; // BIT 5,L
-		case 0x6E: Ops::Bits::TestMemory(HL.reg, 5, 16); break; // BIT 5,(HL)
-		case 0x6F: Ops::Bits::Test(AF.hi, 5, 8); break; // BIT 5,A
-		case 0x70: Ops::Bits::Test(BC.hi, 6, 8); break; // BIT 6,B 
-		case 0x71: Ops::Bits::Test(BC.lo, 6, 8); break; // BIT 6,C
-		case 0x72: Ops::Bits::Test(DE.hi, 6, 8); break; // BIT 6,D
-		case 0x73: Ops::Bits::Test(DE.lo, 6, 8); break; // BIT 6,E
-		case 0x74: Ops::Bits::Test(HL.hi, 6, 8); break; // BIT 6,H
-		case 0x75: Ops::Bits::Test(HL.lo, 6, 8); break; // BIT 6,L 
-		case 0x76: Ops::Bits::TestMemory(HL.reg, 6, 16); break; // BIT 6,(HL) 
-		case 0x77: Ops::Bits::Test(AF.hi, 6, 8); break; // BIT 6,A
-		case 0x78: Ops::Bits::Test(BC.hi, 7, 8); break; // BIT 7,B
-		case 0x79: Ops::Bits::Test(BC.lo, 7, 8); break; // BIT 7,C
-		case 0x7A: Ops::Bits::Test(DE.hi, 7, 8); break; // BIT 7,D
-		case 0x7B: Ops::Bits::Test(DE.lo, 7, 8); break; // BIT 7,E
-		case 0x7C: Ops::Bits::Test(HL.hi, 7, 8); break; // BIT 7,H
-		case 0x7D: Ops::Bits::Test(HL.lo, 7, 8); break; // BIT 7,L
-		case 0x7E: Ops::Bits::TestMemory(HL.reg, 7, 16); break; // BIT 7,(HL)
-		case 0x7F: Ops::Bits::Test(AF.hi, 7, 8); break; // BIT 7,A
-		// reset bit
-		case 0x80: Ops::Bits::Reset(BC.hi, 0, 8); break; // RES 0,B
-		case 0x81: Ops::Bits::Reset(BC.lo, 0, 8); break; // RES 0,C
-		case 0x82: Ops::Bits::Reset(DE.hi, 0, 8); break; // RES 0,D
-		case 0x83: Ops::Bits::Reset(DE.lo, 0, 8); break; // RES 0,E
-		case 0x84: Ops::Bits::Reset(HL.hi, 0, 8); break; // RES 0,H
-		case 0x85: Ops::Bits::Reset(HL.lo, 0, 8); break; // RES 0,L
-		case 0x86: Ops::Bits::ResetMemory(HL.reg, 0, 16); break; // RES 0,(HL)
-		case 0x87: Ops::Bits::Reset(AF.hi, 0, 8); break; // RES 0,A
-		case 0x88: Ops::Bits::Reset(BC.hi, 1, 8); break; // RES 1,B
-		case 0x89: Ops::Bits::Reset(BC.lo, 1, 8); break; // RES 1,C
-		case 0x8A: Ops::Bits::Reset(DE.hi, 1, 8); break; // RES 1,D
-		case 0x8B: Ops::Bits::Reset(DE.lo, 1, 8); break; // RES 1,E
-		case 0x8C: Ops::Bits::Reset(HL.hi, 1, 8); break; // RES 1,H 
-		case 0x8D: Ops::Bits::Reset(HL.lo, 1, 8); break; // RES 1,L
-		case 0x8E: Ops::Bits::ResetMemory(HL.reg, 1, 16); break; // RES 1,(HL)
-		case 0x8F: Ops::Bits::Reset(AF.hi, 1, 8); break; // RES 1,A
-		case 0x90: Ops::Bits::Reset(BC.hi, 2, 8); break; // RES 2,B
-		case 0x91: Ops::Bits::Reset(BC.lo, 2, 8); break; // RES 2,C
-		case 0x92: Ops::Bits::Reset(DE.hi, 2, 8); break; // RES 2,D
-		case 0x93: Ops::Bits::Reset(DE.lo, 2, 8); break; // RES 2,E
-		case 0x94: Ops::Bits::Reset(HL.hi, 2, 8); break; // RES 2,H
-		case 0x95: Ops::Bits::Reset(HL.lo, 2, 8); break; // RES 2,L
-		case 0x96: Ops::Bits::ResetMemory(HL.reg, 2, 16); break; // RES 2,(HL)
-		case 0x97: Ops::Bits::Reset(AF.hi, 2, 8); break; // RES 2,A
-		case 0x98: Ops::Bits::Reset(BC.hi, 3, 8); break; // RES 3,B
-		case 0x99: Ops::Bits::Reset(BC.lo, 3, 8); break; // RES 3,C
-		case 0x9A: Ops::Bits::Reset(DE.hi, 3, 8); break; // RES 3,D
-		case 0x9B: Ops::Bits::Reset(DE.lo, 3, 8); break; // RES 3,E
-		case 0x9C: Ops::Bits::Reset(HL.hi, 3, 8); break; // RES 3,H
-		case 0x9D: Ops::Bits::Reset(HL.lo, 3, 8); break; // RES 3,L
-		case 0x9E: Ops::Bits::ResetMemory(HL.reg, 3, 16); break; // RES 3,(HL)
-		case 0x9F: Ops::Bits::Reset(AF.hi, 3, 8); break; // RES 3,A
-		case 0xA0: Ops::Bits::Reset(BC.hi, 4, 8); break; // RES 4,B
-		case 0xA1: Ops::Bits::Reset(BC.lo, 4, 8); break; // RES 4,C
-		case 0xA2: Ops::Bits::Reset(DE.hi, 4, 8); break; // RES 4,D
-		case 0xA3: Ops::Bits::Reset(DE.lo, 4, 8); break; // RES 4,E
-		case 0xA4: Ops::Bits::Reset(HL.hi, 4, 8); break; // RES 4,H
-		case 0xA5: Ops::Bits::Reset(HL.lo, 4, 8); break; // RES 4,L
-		case 0xA6: Ops::Bits::ResetMemory(HL.reg, 4, 16); break; // RES 4,(HL)
-		case 0xA7: Ops::Bits::Reset(AF.hi, 4, 8); break; // RES 4,A
-		case 0xA8: Ops::Bits::Reset(BC.hi, 5, 8); break; // RES 5,B
-		case 0xA9: Ops::Bits::Reset(BC.lo, 5, 8); break; // RES 5,C
-		case 0xAA: Ops::Bits::Reset(DE.hi, 5, 8); break; // RES 5,D
-		case 0xAB: Ops::Bits::Reset(DE.lo, 5, 8); break; // RES 5,E
-		case 0xAC: Ops::Bits::Reset(HL.hi, 5, 8); break; // RES 5,H
-		case 0xAD: Ops::Bits::Reset(HL.lo, 5, 8); break; // RES 5,L 
-		case 0xAE: Ops::Bits::ResetMemory(HL.reg, 5, 16); break; // RES 5,(HL) 
-		case 0xAF: Ops::Bits::Reset(AF.hi, 5, 8); break; // RES 5,A
-		case 0xB0: Ops::Bits::Reset(BC.hi, 6, 8); break; // RES 6,B
-		case 0xB1: Ops::Bits::Reset(BC.lo, 6, 8); break; // RES 6,C
-		case 0xB2: Ops::Bits::Reset(DE.hi, 6, 8); break; // RES 6,D
-		case 0xB3: Ops::Bits::Reset(DE.lo, 6, 8); break; // RES 6,E
-		case 0xB4: Ops::Bits::Reset(HL.hi, 6, 8); break; // RES 6,H
-		case 0xB5: Ops::Bits::Reset(HL.lo, 6, 8); break; // RES 6,L
-		case 0xB6: Ops::Bits::ResetMemory(HL.reg, 6, 16); break; // RES 6,(HL)
-		case 0xB7: Ops::Bits::Reset(AF.hi, 6, 8); break; // RES 6,A
-		case 0xB8: Ops::Bits::Reset(BC.hi, 7, 8); break; // RES 7,B
-		case 0xB9: Ops::Bits::Reset(BC.lo, 7, 8); break; // RES 7,C 
-		case 0xBA: Ops::Bits::Reset(DE.hi, 7, 8); break; // RES 7,D
-		case 0xBB: Ops::Bits::Reset(DE.lo, 7, 8); break; // RES 7,E
-		case 0xBC: Ops::Bits::Reset(HL.hi, 7, 8); break; // RES 7,H 
-		case 0xBD: Ops::Bits::Reset(HL.lo, 7, 8); break; // RES 7,L
-		case 0xBE: Ops::Bits::ResetMemory(HL.reg, 7, 16); break; // RES 7,(HL)
-		case 0xBF: Ops::Bits::Reset(AF.hi, 7, 8); break; // RES 7,A
-		// set bit
-		case 0xC0: Ops::Bits::Set(BC.hi, 0, 8); break; // SET 0,B
-		case 0xC1: Ops::Bits::Set(BC.lo, 0, 8); break; // SET 0,C
-		case 0xC2: Ops::Bits::Set(DE.hi, 0, 8); break; // SET 0,D
-		case 0xC3: Ops::Bits::Set(DE.lo, 0, 8); break; // SET 0,E
-		case 0xC4: Ops::Bits::Set(HL.hi, 0, 8); break; // SET 0,H
-		case 0xC5: Ops::Bits::Set(HL.lo, 0, 8); break; // SET 0,L
-		case 0xC6: Ops::Bits::SetMemory(HL.reg, 0, 16); break; // SET 0,(HL)
-		case 0xC7: Ops::Bits::Set(AF.hi, 0, 8); break; // SET 0,A
-		case 0xC8: Ops::Bits::Set(BC.hi, 1, 8); break; // SET 1,B
-		case 0xC9: Ops::Bits::Set(BC.lo, 1, 8); break; // SET 1,C
-		case 0xCA: Ops::Bits::Set(DE.hi, 1, 8); break; // SET 1,D
-		case 0xCB: Ops::Bits::Set(DE.lo, 1, 8); break; // SET 1,E
-		case 0xCC: Ops::Bits::Set(HL.hi, 1, 8); break; // SET 1,H
-		case 0xCD: Ops::Bits::Set(HL.lo, 1, 8); break; // SET 1,L
-		case 0xCE: Ops::Bits::SetMemory(HL.reg, 1, 16); break; // SET 1,(HL)
-		case 0xCF: Ops::Bits::Set(AF.hi, 1, 8); break; // SET 1,A
-		case 0xD0: Ops::Bits::Set(BC.hi, 2, 8); break; // SET 2,B
-		case 0xD1: Ops::Bits::Set(BC.lo, 2, 8); break; // SET 2,C
-		case 0xD2: Ops::Bits::Set(DE.hi, 2, 8); break; // SET 2,D
-		case 0xD3: Ops::Bits::Set(DE.lo, 2, 8); break; // SET 2,E
-		case 0xD4: Ops::Bits::Set(HL.hi, 2, 8); break; // SET 2,H
-		case 0xD5: Ops::Bits::Set(HL.lo, 2, 8); break; // SET 2,L
-		case 0xD6: Ops::Bits::SetMemory(HL.reg, 2, 16); break; // SET 2,(HL)
-		case 0xD7: Ops::Bits::Set(AF.hi, 2, 8); break; // SET 2,A
-		case 0xD8: Ops::Bits::Set(BC.hi, 3, 8); break; // SET 3,B
-		case 0xD9: Ops::Bits::Set(BC.lo, 3, 8); break; // SET 3,C
-		case 0xDA: Ops::Bits::Set(DE.hi, 3, 8); break; // SET 3,D
-		case 0xDB: Ops::Bits::Set(DE.lo, 3, 8); break; // SET 3,E
-		case 0xDC: Ops::Bits::Set(HL.hi, 3, 8); break; // SET 3,H
-		case 0xDD: Ops::Bits::Set(HL.lo, 3, 8); break; // SET 3,L
-		case 0xDE: Ops::Bits::SetMemory(HL.reg, 3, 16); break; // SET 3,(HL)
-		case 0xDF: Ops::Bits::Set(AF.hi, 3, 8); break; // SET 3,A
-		case 0xE0: Ops::Bits::Set(BC.hi, 4, 8); break; // SET 4,B
-		case 0xE1: Ops::Bits::Set(BC.lo, 4, 8); break; // SET 4,C
-		case 0xE2: Ops::Bits::Set(DE.hi, 4, 8); break; // SET 4,D 
-		case 0xE3: Ops::Bits::Set(DE.lo, 4, 8); break; // SET 4,E
-		case 0xE4: Ops::Bits::Set(HL.hi, 4, 8); break; // SET 4,H
-		case 0xE5: Ops::Bits::Set(HL.lo, 4, 8); break; // SET 4,L
-		case 0xE6: Ops::Bits::SetMemory(HL.reg, 4, 16); break; // SET 4,(HL)
-		case 0xE7: Ops::Bits::Set(AF.hi, 4, 8); break; // SET 4,A
-		case 0xE8: Ops::Bits::Set(BC.hi, 5, 8); break; // SET 5,B
-		case 0xE9: Ops::Bits::Set(BC.lo, 5, 8); break; // SET 5,C
-		case 0xEA: Ops::Bits::Set(DE.hi, 5, 8); break; // SET 5,D
-		case 0xEB: Ops::Bits::Set(DE.lo, 5, 8); break; // SET 5,E
-		case 0xEC: Ops::Bits::Set(HL.hi, 5, 8); break; // SET 5,H
-		case 0xED: Ops::Bits::Set(HL.lo, 5, 8); break; // SET 5,L
-		case 0xEE: Ops::Bits::SetMemory(HL.reg, 5, 16); break; // SET 5,(HL)
-		case 0xEF: Ops::Bits::Set(AF.hi, 5, 8); break; // SET 5,A
-		case 0xF0: Ops::Bits::Set(BC.hi, 6, 8); break; // SET 6,B
-		case 0xF1: Ops::Bits::Set(BC.lo, 6, 8); break; // SET 6,C
-		case 0xF2: Ops::Bits::Set(DE.hi, 6, 8); break; // SET 6,D
-		case 0xF3: Ops::Bits::Set(DE.lo, 6, 8); break; // SET 6,E
-		case 0xF4: Ops::Bits::Set(HL.hi, 6, 8); break; // SET 6,H
-		case 0xF5: Ops::Bits::Set(HL.lo, 6, 8); break; // SET 6,L
-		case 0xF6: Ops::Bits::SetMemory(HL.reg, 6, 16); break; // SET 6,(HL)
-		case 0xF7: Ops::Bits::Set(AF.hi, 6, 8); break; // SET 6,A
-		case 0xF8: Ops::Bits::Set(BC.hi, 7, 8); break; // SET 7,B
-		case 0xF9: Ops::Bits::Set(BC.lo, 7, 8); break; // SET 7,C 
-		case 0xFA: Ops::Bits::Set(DE.hi, 7, 8); break; // SET 7,D
-		case 0xFB: Ops::Bits::Set(DE.lo, 7, 8); break; // SET 7,E
-		case 0xFC: Ops::Bits::Set(HL.hi, 7, 8); break; // SET 7,H
-		case 0xFD: Ops::Bits::Set(HL.lo, 7, 8); break; // SET 7,L
-		case 0xFE: Ops::Bits::SetMemory(HL.reg, 7, 16); break; // SET 7,(HL) 
-		case 0xFF: Ops::Bits::Set(AF.hi, 7, 8); break; // SET 7,A
-		default: Log::UnimplementedOpcode(Opcode); break;
+		int currentCycle = state.Cycles;
+		Interrupt::Service();
+		Scheduler::Advance(scheduler, state.Cycles - currentCycle);
 	}
 }
 
-// save state
-void Cpu::SaveState()
-{
-	// open/create the save state file
-	FILE *fp = fopen("state1.bin", "w");
-	// save registers
-	fprintf(fp, "%04X\n", AF.reg);
-	fprintf(fp, "%04X\n", BC.reg);
-	fprintf(fp, "%04X\n", DE.reg);
-	fprintf(fp, "%04X\n", HL.reg);
-	fprintf(fp, "%04X\n", PC);
-	fprintf(fp, "%04X\n", SP.reg);
-	// save misc
-	fprintf(fp, "%d\n", Interrupt::MasterSwitch);
-	fprintf(fp, "%d\n", Cycles);
-	fprintf(fp, "%d\n", Operation.PendingInterruptEnabled);
-	fprintf(fp, "%d\n", Operation.Stop);
-	// save the memory
-	for (int i = 0x0000; i < 0x10000; i++)
+// idle while halted, jumping straight to the next event (or the end of the run)
+static inline void Idle(Cpu::State &state, Scheduler::State &scheduler, const BYTE *mem, int cycles)
+{
+	while (state.Operation.Halt && state.Cycles < cycles)
 	{
-		fprintf(fp, "%02X\n", Memory::ReadByte(i));
+		unsigned long long untilEvent = scheduler.NextEvent - scheduler.Clock;
+		int idleCycles = (cycles - state.Cycles);
+
+		if (untilEvent < (unsigned long long)idleCycles) idleCycles = (int)untilEvent;
+
+		// the cpu idles in steps of HALT_CYCLES (only one while an EI is pending, so it counts)
+		if (state.Operation.PendingInterruptEnabled) idleCycles = HALT_CYCLES;
+		else idleCycles = ((idleCycles + (HALT_CYCLES - 1)) / HALT_CYCLES) * HALT_CYCLES;
+
+		state.Cycles += idleCycles;
+		Retire(state, scheduler, mem, idleCycles);
 	}
+}
 
-	// close the file
-	fclose(fp);
+// is the opcode a relative jump (the branches idle loops are watched at)
+static constexpr bool IsRelativeJump(int opcode)
+{
+	return (opcode == 0x18 || opcode == 0x20 || opcode == 0x28 || opcode == 0x30 || opcode == 0x38);
+}
+
+// can the straight run of code from target up to the branch only ever idle? (it may
+// only read memory into A and F, and not read DIV or TIMA, which change without an event)
+static bool IsIdleLoopBody(Cpu::State &state, WORD target, WORD branch)
+{
+	WORD address = target;
+
+	while (address < branch)
+	{
+		BYTE opcode = Memory::ReadByte(address);
+		// the memory the instruction reads (if any)
+		int read = -1;
+		int length = 1;
+
+		switch(opcode)
+		{
+			// NOP, rotate A, DAA, CPL, SCF, CCF, INC A and DEC A
+			case 0x00: case 0x07: case 0x0F: case 0x17: case 0x1F:
+			case 0x27: case 0x2F: case 0x37: case 0x3F: case 0x3C: case 0x3D:
+			break;
+
+			case 0x0A: read = state.BC.reg; break; // LD A,(BC)
+			case 0x1A: read = state.DE.reg; break; // LD A,(DE)
+			case 0x3E: length = 2; break; // LD A,d8
+			case 0xF0: read = 0xFF00 + Memory::ReadByte(address + 1); length = 2; break; // LDH A,(a8)
+			case 0xF2: read = 0xFF00 + state.BC.lo; break; // LDH A,(C)
+			case 0xFA: read = Memory::ReadWord(address + 1); length = 3; break; // LD A,(a16)
+
+			// BIT b,r and the rotates, shifts, RES and SET of A
+			case 0xCB:
+			{
+				BYTE extended = Memory::ReadByte(address + 1);
+				length = 2;
+
+				if ((extended >> 6) == 1)
+				{
+					if ((extended & 7) == 6) read = state.HL.reg;
+				}
+				else if ((extended & 7) != 7)
+				{
+					return false;
+				}
+			}
+			break;
+
+			default:
+			{
+				// LD A,r and ALU A,r
+				if ((opcode >= 0x78 && opcode <= 0x7F) || (opcode >= 0x80 && opcode <= 0xBF))
+				{
+					if ((opcode & 7) == 6) read = state.HL.reg;
+				}
+				// ALU A,d8
+				else if ((opcode & 0xC7) == 0xC6)
+				{
+					length = 2;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			break;
+		}
+
+		if (read == DIVIDER_ADDRESS || read == TIMA_ADDRESS) return false;
+
+		address += length;
+	}
+
+	return (address == branch);
 }
 
-// load state
-void Cpu::LoadState()
+// skip an idle loop (a loop that polls memory until an event changes it) to the next event
+//
+// A loop is idle when its branch has been taken twice in a row with the same registers,
+// the same number of cycles apart, and its body can't write anything but A and F. Every
+// iteration until the next event is then the same, so they're skipped whole.
+static inline void SkipIdleLoop(Cpu::State &state, Scheduler::State &scheduler, WORD branch, int cycles)
 {
-	// open the save state file
-	FILE *fp = fopen("state1.bin", "r");
-	// the value of the current data
-	char val[512];
-	// the current data index
-	int i = 0;
+	Cpu::IdleLoop &loop = state.Loop;
+	unsigned long long period = (scheduler.Clock - loop.Clock);
+	bool sameLoop = (loop.Branch == branch && loop.Target == state.PC);
+	bool sameState = true;
+
+	// make F current
+	MaterializeFlags(state);
 
-	while(fscanf(fp, "%s\n", &val) != EOF)
+	WORD registers[5] = { state.AF.reg, state.BC.reg, state.DE.reg, state.HL.reg, state.SP.reg };
+
+	for (int i = 0; i < 5; i++)
 	{
-		if (i == 0)
-			AF.reg = (WORD)strtol(val, NULL, 16);
-		else if (i == 1)
-			BC.reg = (WORD)strtol(val, NULL, 16);
-		else if (i == 2)
-			DE.reg = (WORD)strtol(val, NULL, 16);
-		else if (i == 3)
-			HL.reg = (WORD)strtol(val, NULL, 16);
-		else if (i == 4)
-			PC = (WORD)strtol(val, NULL, 16);
-		else if (i == 5)
-			SP.reg = (WORD)strtol(val, NULL, 16);
-		else if (i == 6)
-			Interrupt::MasterSwitch = (int)strtol(val, NULL, 16);
-		else if (i == 7)
-			Cycles = (int)strtol(val, NULL, 16);
-		else if (i == 8)
-			Operation.PendingInterruptEnabled = (int)strtol(val, NULL, 16);
-		else if (i == 9)
-			Operation.Stop = (int)strtol(val, NULL, 16);
-		else if (i >= 10)
-			Memory::Write(0x0000 + (i - 10), (BYTE)strtol(val, NULL, 16));
-
-		// increment i
-		i += 1;
+		if (registers[i] != loop.Registers[i]) sameState = false;
+		loop.Registers[i] = registers[i];
 	}
 
-	// close the file
-	fclose(fp);
-}
-
-// debugger
-void Cpu::Debugger()
-{
-	bool FlagZ = Flags::Get::Z();
-	bool FlagN = Flags::Get::N();
-	bool FlagH = Flags::Get::H();
-	bool FlagC = Flags::Get::C();
-
-	// register viewer window
-	ImGui::Begin("Register Viewer", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
-	ImGui::SetWindowSize("Register Viewer", ImVec2(180, 210));
-	ImGui::SetWindowPos("Register Viewer", ImVec2(640 - 180, 5));
-	ImGuiExtensions::TextWithColors("{FF0000}AF: {FFFFFF}%04X", AF.reg); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}LCDC: {FFFFFF}%02X", Memory::ReadByte(LCDC_ADDRESS)); ImGui::SameLine(); ImGui::NewLine(); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}BC: {FFFFFF}%04X", BC.reg); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}STAT: {FFFFFF}%02X", Memory::ReadByte(STAT_ADDRESS)); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}DE: {FFFFFF}%04X", DE.reg); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}LY:   {FFFFFF}%02X", Memory::ReadByte(LY_ADDRESS)); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}HL: {FFFFFF}%04X", HL.reg); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}IME:  {FFFFFF}%d", Interrupt::MasterSwitch); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}SP: {FFFFFF}%04X", SP.reg); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}IE:   {FFFFFF}%02X", Memory::ReadByte(INT_ENABLED_ADDRESS)); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}PC: {FFFFFF}%04X", PC); ImGui::SameLine(); ImGui::SameLine(); ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}IF:   {FFFFFF}%02X", Memory::ReadByte(INT_REQUEST_ADDRESS)); ImGui::Unindent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}TMA:  {FFFFFF}%02X", Memory::ReadByte(TIMA_ADDRESS));  ImGui::SameLine();ImGui::Indent(80.f);
-	ImGuiExtensions::TextWithColors("{FF0000}DIV:  {FFFFFF}%02X", Memory::ReadByte(DIVIDER_ADDRESS)); ImGui::Unindent(80.f);
-	// flags
-	ImGui::Checkbox("Z", &FlagZ); ImGui::SameLine();
-	ImGui::Checkbox("N", &FlagN); ImGui::SameLine();
-	ImGui::Checkbox("H", &FlagH);
-	ImGui::Checkbox("C", &FlagC);
-	ImGui::End();
-
-	// memory viewer window
-	ImGui::Begin("Mem View", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
-	ImGui::SetWindowSize("Mem View", ImVec2(100, 210));
-	ImGui::SetWindowPos("Mem View", ImVec2((640 - 289), 5));
-
-	/*
-	// high ram + i/o
-	for (WORD i = 0xFFFE; i >= 0xFF00; --i)
+	bool idle = (sameLoop && sameState && period == loop.Period);
+
+	loop.Branch = branch;
+	loop.Target = state.PC;
+	loop.Clock = scheduler.Clock;
+	loop.Period = period;
+
+	if (!idle || state.Cycles >= cycles || state.Operation.PendingInterruptEnabled) return;
+	if (!IsIdleLoopBody(state, loop.Target, branch)) return;
+
+	// skip the iterations that finish before the next event (and the end of the run)
+	unsigned long long untilEvent = (scheduler.NextEvent - scheduler.Clock);
+	unsigned long long untilEnd = (unsigned long long)(cycles - state.Cycles);
+	unsigned long long limit = (untilEvent < untilEnd) ? untilEvent : untilEnd;
+	unsigned long long skipped = ((limit - 1) / period) * period;
+
+	if (skipped > 0)
+	{
+		state.Cycles += (int)skipped;
+		Scheduler::Advance(scheduler, (int)skipped);
+		loop.Clock = scheduler.Clock;
+	}
+}
+
+// execute Opcode
+void Cpu::ExecuteOpcode()
+{
+	State &state = GameBoy::Current()->CpuState;
+
+	// a halted cpu doesn't run anything, it just idles
+	if (state.Operation.Halt)
 	{
-		// high ram
-		if (i == 0xFFFE)
+		state.Cycles += HALT_CYCLES;
+	}
+	else
+	{
+		Instructions::Handlers[Fetch(state)](state);
+	}
+
+	EnablePendingInterrupts(state);
+}
+
+// execute extended Opcode
+void Cpu::ExecuteExtendedOpcode()
+{
+	State &state = GameBoy::Current()->CpuState;
+
+	state.Operand = Memory::ReadByte(state.PC);
+	ExecuteExtended(state);
+}
+
+// every opcode, for generating the dispatch labels
+#define OPCODE_ROW(row, OP) OP(row##0) OP(row##1) OP(row##2) OP(row##3) OP(row##4) OP(row##5) OP(row##6) OP(row##7) \
+	OP(row##8) OP(row##9) OP(row##A) OP(row##B) OP(row##C) OP(row##D) OP(row##E) OP(row##F)
+#define OPCODE_ALL(OP) OPCODE_ROW(0, OP) OPCODE_ROW(1, OP) OPCODE_ROW(2, OP) OPCODE_ROW(3, OP) \
+	OPCODE_ROW(4, OP) OPCODE_ROW(5, OP) OPCODE_ROW(6, OP) OPCODE_ROW(7, OP) \
+	OPCODE_ROW(8, OP) OPCODE_ROW(9, OP) OPCODE_ROW(A, OP) OPCODE_ROW(B, OP) \
+	OPCODE_ROW(C, OP) OPCODE_ROW(D, OP) OPCODE_ROW(E, OP) OPCODE_ROW(F, OP)
+
+// get an opcode's handler
+Cpu::Handler Cpu::GetHandler(BYTE opcode)
+{
+	return Instructions::Handlers[opcode];
+}
+
+// get the carry flag (working it out from the pending operation, if there is one)
+BYTE Cpu::GetCarryFlag(const State &state)
+{
+	return FlagC(state);
+}
+
+// run until the cycle counter reaches the given value through compiled blocks (where
+// there are any), returns the number of instructions ran
+static int RunCompiled(GameBoy *gameBoy, int cycles)
+{
+	Cpu::State &state = gameBoy->CpuState;
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	const BYTE *mem = gameBoy->MemoryState.Mem;
+	int instructionsRan = 0;
+
+	while (true)
+	{
+		// idle while halted
+		Idle(state, scheduler, mem, cycles);
+		if (state.Cycles >= cycles) return instructionsRan;
+
+		const Dynarec::Block *block = NULL;
+		int entry = 0;
+		WORD branch = state.PC;
+		WORD target = 0;
+		BYTE opcode = 0;
+
+		// a block only runs from decoded rom code, while no interrupt or EI is pending (so it has nothing to service,
+		// a requested interrupt isn't serviced while they're disabled, and only EI and RETI enable them)
+		if (Memory::ReadCode(state.PC) != NULL && !state.Operation.PendingInterruptEnabled && !state.Operation.Stop && !(gameBoy->InterruptState.MasterSwitch && (mem[INT_REQUEST_ADDRESS] & mem[INT_ENABLED_ADDRESS] & 0x1F)))
 		{
-			ImGuiExtensions::TextWithColors("{77FF77}High Ram");
+			block = Dynarec::Lookup(state.PC, entry);
 		}
-		// i/o
-		else if (i == 0xFF7E)
+
+		if (block != NULL)
 		{
-			ImGui::NewLine();
-			ImGuiExtensions::TextWithColors("{77FF77}I/O");
-			ImGui::NewLine();
+			int ran = Dynarec::Execute(*block, entry, cycles);
+
+			// the block already moved the clock on
+			target = state.PC;
+			Retire(state, scheduler, mem, 0);
+			instructionsRan += ran;
+
+			// the block's last instruction only ran if every instruction did
+			if (entry + ran == block->Count)
+			{
+				branch = block->LastAddress;
+				opcode = block->LastOpcode;
+			}
 		}
-		
-		// print the value at the address
-		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
-	}
-	
-	// print the category
-	ImGui::NewLine();
-	ImGuiExtensions::TextWithColors("{77FF77}VRAM");
-	ImGui::NewLine();
-
-	// tile data
-	for (WORD i = 0x9FFE; i >= 0x8000; --i)
-	{
-		// print the value at the address
-		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+		else
+		{
+			int currentCycle = state.Cycles;
+			opcode = Fetch(state);
+			Instructions::Handlers[opcode](state);
+			target = state.PC;
+			Retire(state, scheduler, mem, state.Cycles - currentCycle);
+			instructionsRan += 1;
+		}
+
+		// a relative jump was taken backwards (and no interrupt was serviced)
+		if (IsRelativeJump(opcode) && target <= branch && state.PC == target) SkipIdleLoop(state, scheduler, branch, cycles);
 	}
+}
 
-	// print the category
-	ImGui::NewLine();
-	ImGuiExtensions::TextWithColors("{77FF77}WRAM");
-	ImGui::NewLine();
+// run until the cycle counter reaches the given value, returns the number of instructions ran
+int Cpu::Run(int cycles)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	State &state = gameBoy->CpuState;
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	const BYTE *mem = gameBoy->MemoryState.Mem;
+	int instructionsRan = 0;
+	int currentCycle = 0;
+	// the address and target of the last relative jump (to watch for idle loops)
+	WORD branch = 0;
+	WORD target = 0;
 
-	// work ram
-	for (WORD i = 0xDE00; i >= 0xC000; --i)
+	// run compiled code where the host supports it
+	if (!gameBoy->DynarecState.Disabled && Dynarec::IsSupported())
 	{
-		// print the value at the address
-		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+		return RunCompiled(gameBoy, cycles);
 	}
-	ImGui::End();
-	*/
 
-	// print ALL ram
-	for (WORD i = 0xFFFF; i >= 0xC000; --i)
+#if defined(__GNUC__)
+	// threaded dispatch (each handler jumps straight to the next one)
+	#define OPCODE_LABEL(n) &&op_##n,
+	#define OPCODE_DISPATCH() \
+		if (state.Cycles >= cycles) return instructionsRan; \
+		currentCycle = state.Cycles; \
+		goto *labels[Fetch(state)]
+	#define OPCODE_HANDLER(n) \
+		op_##n: \
+		if (IsRelativeJump(0x##n)) branch = (state.PC - 1); \
+		Instruction<0x##n>::Execute(state); \
+		if (IsRelativeJump(0x##n)) target = state.PC; \
+		Retire(state, scheduler, mem, state.Cycles - currentCycle); \
+		instructionsRan += 1; \
+		if (0x##n == OPCODE_HALT) Idle(state, scheduler, mem, cycles); \
+		if (IsRelativeJump(0x##n) && target <= branch && state.PC == target) SkipIdleLoop(state, scheduler, branch, cycles); \
+		OPCODE_DISPATCH();
+
+	static const void *labels[256] = { OPCODE_ALL(OPCODE_LABEL) };
+
+	// the cpu may still be halted from the last run
+	Idle(state, scheduler, mem, cycles);
+	OPCODE_DISPATCH();
+	OPCODE_ALL(OPCODE_HANDLER)
+
+	#undef OPCODE_LABEL
+	#undef OPCODE_DISPATCH
+	#undef OPCODE_HANDLER
+#else
+	// table dispatch
+	while (state.Cycles < cycles)
 	{
-		// print the value at the address
-		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+		// idle while halted
+		Idle(state, scheduler, mem, cycles);
+		if (state.Cycles >= cycles) break;
+
+		currentCycle = state.Cycles;
+		branch = state.PC;
+		BYTE opcode = Fetch(state);
+		Instructions::Handlers[opcode](state);
+		target = state.PC;
+		Retire(state, scheduler, mem, state.Cycles - currentCycle);
+		instructionsRan += 1;
+
+		// a relative jump was taken backwards (and no interrupt was serviced)
+		if (IsRelativeJump(opcode) && target <= branch && state.PC == target) SkipIdleLoop(state, scheduler, branch, cycles);
 	}
-	ImGui::End();
 
-	// memory viewer window
-	memoryViewer.DrawWindow("Memory Editor", Memory::Mem, 0x10000, 0x0000);
-	memoryViewer.GotoAddrAndHighlight(PC, PC);
+	return instructionsRan;
+#endif
 }
@@ -0,0 +1,130 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: debugger.cpp
+*/
+
+// includes
+#include "imgui/imgui.h"
+#include "imgui/imgui_memory_editor.h"
+#include "imgui/imgui_custom_extensions.h"
+#include "include/cpu.h"
+#include "include/debugger.h"
+#include "include/flags.h"
+#include "include/interrupt.h"
+#include "include/memory.h"
+
+// debug memory viewer
+static MemoryEditor memoryViewer;
+
+// read memory for the memory viewer (the rom and banked ram aren't in Memory::Get())
+static unsigned char ReadMemory(unsigned char *data, size_t offset)
+{
+	return Memory::ReadByte((WORD)offset);
+}
+
+// init the debugger
+void Debugger::Init()
+{
+	// setup the memory viewer
+	memoryViewer.Rows = 4;
+	memoryViewer.ReadFn = ReadMemory;
+}
+
+// show the debugger
+void Debugger::Show()
+{
+	bool FlagZ = Flags::Get::Z();
+	bool FlagN = Flags::Get::N();
+	bool FlagH = Flags::Get::H();
+	bool FlagC = Flags::Get::C();
+
+	// register viewer window
+	ImGui::Begin("Register Viewer", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
+	ImGui::SetWindowSize("Register Viewer", ImVec2(180, 210));
+	ImGui::SetWindowPos("Register Viewer", ImVec2(640 - 180, 5));
+	ImGuiExtensions::TextWithColors("{FF0000}AF: {FFFFFF}%04X", Cpu::Get::AF()->reg); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}LCDC: {FFFFFF}%02X", Memory::ReadByte(LCDC_ADDRESS)); ImGui::SameLine(); ImGui::NewLine(); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}BC: {FFFFFF}%04X", Cpu::Get::BC()->reg); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}STAT: {FFFFFF}%02X", Memory::ReadByte(STAT_ADDRESS)); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}DE: {FFFFFF}%04X", Cpu::Get::DE()->reg); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}LY:   {FFFFFF}%02X", Memory::ReadByte(LY_ADDRESS)); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}HL: {FFFFFF}%04X", Cpu::Get::HL()->reg); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}IME:  {FFFFFF}%d", Interrupt::Get::MasterSwitch()); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}SP: {FFFFFF}%04X", Cpu::Get::SP()->reg); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}IE:   {FFFFFF}%02X", Memory::ReadByte(INT_ENABLED_ADDRESS)); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}PC: {FFFFFF}%04X", Cpu::Get::PC()); ImGui::SameLine(); ImGui::SameLine(); ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}IF:   {FFFFFF}%02X", Memory::ReadByte(INT_REQUEST_ADDRESS)); ImGui::Unindent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}TMA:  {FFFFFF}%02X", Memory::ReadByte(TIMA_ADDRESS));  ImGui::SameLine();ImGui::Indent(80.f);
+	ImGuiExtensions::TextWithColors("{FF0000}DIV:  {FFFFFF}%02X", Memory::ReadByte(DIVIDER_ADDRESS)); ImGui::Unindent(80.f);
+	// flags
+	ImGui::Checkbox("Z", &FlagZ); ImGui::SameLine();
+	ImGui::Checkbox("N", &FlagN); ImGui::SameLine();
+	ImGui::Checkbox("H", &FlagH);
+	ImGui::Checkbox("C", &FlagC);
+	ImGui::End();
+
+	// memory viewer window
+	ImGui::Begin("Mem View", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
+	ImGui::SetWindowSize("Mem View", ImVec2(100, 210));
+	ImGui::SetWindowPos("Mem View", ImVec2((640 - 289), 5));
+
+	/*
+	// high ram + i/o
+	for (WORD i = 0xFFFE; i >= 0xFF00; --i)
+	{
+		// high ram
+		if (i == 0xFFFE)
+		{
+			ImGuiExtensions::TextWithColors("{77FF77}High Ram");
+		}
+		// i/o
+		else if (i == 0xFF7E)
+		{
+			ImGui::NewLine();
+			ImGuiExtensions::TextWithColors("{77FF77}I/O");
+			ImGui::NewLine();
+		}
+		
+		// print the value at the address
+		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+	}
+	
+	// print the category
+	ImGui::NewLine();
+	ImGuiExtensions::TextWithColors("{77FF77}VRAM");
+	ImGui::NewLine();
+
+	// tile data
+	for (WORD i = 0x9FFE; i >= 0x8000; --i)
+	{
+		// print the value at the address
+		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+	}
+
+	// print the category
+	ImGui::NewLine();
+	ImGuiExtensions::TextWithColors("{77FF77}WRAM");
+	ImGui::NewLine();
+
+	// work ram
+	for (WORD i = 0xDE00; i >= 0xC000; --i)
+	{
+		// print the value at the address
+		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+	}
+	ImGui::End();
+	*/
+
+	// print ALL ram
+	for (WORD i = 0xFFFF; i >= 0xC000; --i)
+	{
+		// print the value at the address
+		ImGuiExtensions::TextWithColors("{FF0000}%04X: {FFFFFF}%02X", i, Memory::ReadByte(i));
+	}
+	ImGui::End();
+
+	// memory viewer window
+	memoryViewer.DrawWindow("Memory Editor", Memory::Get(), 0x10000, 0x0000);
+	memoryViewer.GotoAddrAndHighlight(Cpu::Get::PC(), Cpu::Get::PC());
+}
@@ -0,0 +1,126 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: display.cpp
+*/
+
+// includes
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_opengl.h>
+#include "include/display.h"
+#include "include/lcd.h"
+
+// definitions
+#define SCREEN_BYTES (160 * 144 * 4)
+
+// vars
+static GLuint texture;
+// the pixel buffers frames are streamed through (one is filled while the driver may still be reading the other)
+static GLuint pixelBuffers[2];
+static int nextPixelBuffer = 0;
+// the buffer functions (looked up at run time, as not every platform's gl library exports them)
+static PFNGLGENBUFFERSPROC genBuffers = NULL;
+static PFNGLBINDBUFFERPROC bindBuffer = NULL;
+static PFNGLBUFFERDATAPROC bufferData = NULL;
+static PFNGLMAPBUFFERPROC mapBuffer = NULL;
+static PFNGLUNMAPBUFFERPROC unmapBuffer = NULL;
+// are frames streamed through the pixel buffers? (if not, they're uploaded straight from the screen)
+static bool usePixelBuffers = false;
+// the last screen uploaded
+static BYTE uploadedScreen[SCREEN_BYTES];
+
+// look up the pixel buffer functions, returns false if the driver doesn't have them
+static bool LoadPixelBufferFunctions()
+{
+	if (!SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object")) return false;
+
+	genBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+	bindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+	bufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+	mapBuffer = (PFNGLMAPBUFFERPROC)SDL_GL_GetProcAddress("glMapBuffer");
+	unmapBuffer = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress("glUnmapBuffer");
+
+	return (genBuffers != NULL && bindBuffer != NULL && bufferData != NULL && mapBuffer != NULL && unmapBuffer != NULL);
+}
+
+// init the display
+void Display::Init()
+{
+	// setup opengl for the game window
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glGenTextures(1, &texture); // create texture
+	glBindTexture(GL_TEXTURE_2D, texture); // specify that the texture is 2D
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 160, 144, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); // allocate the texture once
+	glEnable(GL_TEXTURE_2D);
+
+	// create the pixel buffers (if the driver has them)
+	usePixelBuffers = LoadPixelBufferFunctions();
+
+	if (usePixelBuffers)
+	{
+		genBuffers(2, pixelBuffers);
+
+		for (int i = 0; i < 2; i++)
+		{
+			bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+			bufferData(GL_PIXEL_UNPACK_BUFFER, SCREEN_BYTES, NULL, GL_STREAM_DRAW);
+		}
+
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// update the texture
+	UpdateTexture(Lcd::Get::Screen());
+}
+
+// update the texture (only if the screen changed)
+void Display::UpdateTexture(const BYTE *screen)
+{
+	// the screen is the same as the last upload
+	if (memcmp(screen, uploadedScreen, SCREEN_BYTES) == 0) return;
+
+	memcpy(uploadedScreen, screen, SCREEN_BYTES);
+
+	// without pixel buffers, upload straight from the screen
+	if (!usePixelBuffers)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 160, 144, GL_RGBA, GL_UNSIGNED_BYTE, screen);
+		return;
+	}
+
+	// fill the next pixel buffer (orphaning its old storage, so we never wait on the driver)
+	bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextPixelBuffer]);
+	bufferData(GL_PIXEL_UNPACK_BUFFER, SCREEN_BYTES, NULL, GL_STREAM_DRAW);
+	void *pixels = mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+
+	if (pixels != NULL)
+	{
+		memcpy(pixels, screen, SCREEN_BYTES);
+		unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		// copy the pixel buffer into the texture
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 160, 144, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else
+	{
+		// the buffer couldn't be mapped, upload straight from the screen
+		bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 160, 144, GL_RGBA, GL_UNSIGNED_BYTE, screen);
+	}
+
+	nextPixelBuffer ^= 1;
+}
+// render the display
+void Display::Render()
+{
+	glBegin(GL_QUADS);
+	glTexCoord2f(0, 0); glVertex2f(0, 0);
+	glTexCoord2f(0, 1); glVertex2f(0, 144);
+	glTexCoord2f(1, 1); glVertex2f(160, 144);
+	glTexCoord2f(1, 0); glVertex2f(160, 0);
+	glEnd();
+}
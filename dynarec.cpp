@@ -0,0 +1,893 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: dynarec.cpp
+*/
+
+// includes
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include "include/dynarec.h"
+#include "include/gameboy.h"
+#include "include/memory.h"
+#include "include/rom.h"
+
+// # Arena # //
+
+// reserve the executable memory (writable until a block is copied in, see Compile)
+Dynarec::Arena::Arena() : Code(NULL), Size(0)
+{
+#if defined(DYNAREC_ENABLED)
+	void *mapping = mmap(NULL, DYNAREC_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	// without it every block stays on the interpreter
+	if (mapping != MAP_FAILED)
+	{
+		Code = (BYTE *)mapping;
+		Size = DYNAREC_ARENA_SIZE;
+
+		// hand the chunks out from the start of the arena
+		for (size_t offset = Size; offset > 0; offset -= DYNAREC_CHUNK_SIZE)
+		{
+			FreeChunks.push_back(Code + offset - DYNAREC_CHUNK_SIZE);
+		}
+	}
+#endif
+}
+
+// the process' arena (never unmapped, so machines can give their chunks back at any time)
+Dynarec::Arena &Dynarec::GetArena()
+{
+	static Arena *arena = new Arena();
+
+	return *arena;
+}
+
+// take a free chunk of the arena
+Dynarec::Chunk::Chunk() : Code(NULL)
+{
+	Arena &arena = GetArena();
+	std::lock_guard<std::mutex> lock(arena.Lock);
+
+	if (!arena.FreeChunks.empty())
+	{
+		Code = arena.FreeChunks.back();
+		arena.FreeChunks.pop_back();
+	}
+}
+
+// give the chunk back to the arena
+Dynarec::Chunk::~Chunk()
+{
+	if (Code != NULL)
+	{
+		Arena &arena = GetArena();
+		std::lock_guard<std::mutex> lock(arena.Lock);
+		arena.FreeChunks.push_back(Code);
+	}
+}
+
+#if defined(DYNAREC_ENABLED)
+
+// # Code Generation # //
+
+// a block being assembled
+class Emitter
+{
+	public:
+		void Byte(BYTE val) { Code.push_back(val); }
+		void Bytes(std::initializer_list<BYTE> vals) { Code.insert(Code.end(), vals); }
+		void Word(WORD val) { Byte(val & 0xFF); Byte(val >> 8); }
+		void Dword(unsigned int val) { for (int i = 0; i < 4; i++) Byte((val >> (i * 8)) & 0xFF); }
+		void Qword(unsigned long long val) { for (int i = 0; i < 8; i++) Byte((val >> (i * 8)) & 0xFF); }
+
+		// a conditional jump to the end of the block (patched once the block is assembled)
+		void JumpToEnd(BYTE condition)
+		{
+			Bytes({0x0F, condition});
+			Exits.push_back(Code.size());
+			Dword(0);
+		}
+
+		// a jump within the block (a condition of 0 always jumps), returns where to patch it
+		size_t Jump(BYTE condition)
+		{
+			if (condition == 0) Byte(0xE9); else Bytes({0x0F, condition});
+			Dword(0);
+			return (Code.size() - 4);
+		}
+
+		// point a jump within the block here
+		void Land(size_t jump)
+		{
+			unsigned int offset = (unsigned int)(Code.size() - (jump + 4));
+			memcpy(&Code[jump], &offset, 4);
+		}
+
+		// point every jump to the end of the block here
+		void PatchExits()
+		{
+			for (size_t i = 0; i < Exits.size(); i++)
+			{
+				unsigned int offset = (unsigned int)(Code.size() - (Exits[i] + 4));
+				memcpy(&Code[Exits[i]], &offset, 4);
+			}
+		}
+
+	public:
+		std::vector<BYTE> Code;
+		std::vector<size_t> Exits;
+};
+
+// condition codes
+#define JUMP_ALWAYS 0
+#define JUMP_IF_BELOW 0x82
+#define JUMP_IF_ABOVE_OR_EQUAL 0x83
+#define JUMP_IF_ZERO 0x84
+#define JUMP_IF_NOT_ZERO 0x85
+
+// the offsets of F and the pending flags in the cpu state
+#define OFFSET_F offsetof(Cpu::State, AF)
+#define OFFSET_A (offsetof(Cpu::State, AF) + 1)
+#define OFFSET_FLAGS_OPERATION offsetof(Cpu::State, Flags.Operation)
+#define OFFSET_FLAGS_VAL offsetof(Cpu::State, Flags.Val)
+#define OFFSET_FLAGS_VAL2 offsetof(Cpu::State, Flags.Val2)
+#define OFFSET_FLAGS_CARRY offsetof(Cpu::State, Flags.Carry)
+#define OFFSET_FLAGS_RESULT offsetof(Cpu::State, Flags.Result)
+
+// the offset of an 8 bit register in the cpu state (in the order they're encoded in the opcodes)
+static size_t RegisterOffset(int reg)
+{
+	switch(reg)
+	{
+		case 0: return offsetof(Cpu::State, BC) + 1; // B
+		case 1: return offsetof(Cpu::State, BC); // C
+		case 2: return offsetof(Cpu::State, DE) + 1; // D
+		case 3: return offsetof(Cpu::State, DE); // E
+		case 4: return offsetof(Cpu::State, HL) + 1; // H
+		case 5: return offsetof(Cpu::State, HL); // L
+		default: return OFFSET_A; // A
+	}
+}
+
+// the offset of a 16 bit register pair in the cpu state (in the order they're encoded in the opcodes)
+static size_t PairOffset(int pair)
+{
+	switch(pair)
+	{
+		case 0: return offsetof(Cpu::State, BC);
+		case 1: return offsetof(Cpu::State, DE);
+		case 2: return offsetof(Cpu::State, HL);
+		default: return offsetof(Cpu::State, SP);
+	}
+}
+
+// mov word [rbx + offset], val
+static void StoreWord(Emitter &emit, size_t offset, WORD val)
+{
+	emit.Bytes({0x66, 0xC7, 0x83});
+	emit.Dword((unsigned int)offset);
+	emit.Word(val);
+}
+
+// mov byte [rbx + offset], val
+static void StoreByte(Emitter &emit, size_t offset, BYTE val)
+{
+	emit.Bytes({0xC6, 0x83});
+	emit.Dword((unsigned int)offset);
+	emit.Byte(val);
+}
+
+// movzx eax, byte [rbx + offset]
+static void LoadByte(Emitter &emit, size_t offset)
+{
+	emit.Bytes({0x0F, 0xB6, 0x83});
+	emit.Dword((unsigned int)offset);
+}
+
+// mov [rbx + offset], al
+static void StoreAl(Emitter &emit, size_t offset)
+{
+	emit.Bytes({0x88, 0x83});
+	emit.Dword((unsigned int)offset);
+}
+
+// read memory for a block
+static BYTE ReadMemory(WORD address)
+{
+	return Memory::ReadByte(address);
+}
+
+// read the byte at the address in eax into eax (plain memory straight from the page tables, anything else through the handlers)
+static void Read(Emitter &emit)
+{
+	// mov ecx, eax; shr ecx, 8
+	emit.Bytes({0x89, 0xC1, 0xC1, 0xE9, 0x08});
+	// mov rdx, [rbp + ReadPage]; mov rdx, [rdx + rcx * 8]; test rdx, rdx
+	emit.Bytes({0x48, 0x8B, 0x95});
+	emit.Dword((unsigned int)offsetof(Dynarec::Context, ReadPage));
+	emit.Bytes({0x48, 0x8B, 0x14, 0xCA, 0x48, 0x85, 0xD2});
+	size_t handler = emit.Jump(JUMP_IF_ZERO);
+	// movzx eax, al; movzx eax, byte [rdx + rax]
+	emit.Bytes({0x0F, 0xB6, 0xC0, 0x0F, 0xB6, 0x04, 0x02});
+	size_t done = emit.Jump(JUMP_ALWAYS);
+	// mov edi, eax; mov rax, ReadMemory; call rax; movzx eax, al
+	emit.Land(handler);
+	emit.Bytes({0x89, 0xC7, 0x48, 0xB8});
+	emit.Qword((unsigned long long)&ReadMemory);
+	emit.Bytes({0xFF, 0xD0, 0x0F, 0xB6, 0xC0});
+	emit.Land(done);
+}
+
+// work out the zero flag into eax (the result of the pending operation, or F)
+static void ZeroFlag(Emitter &emit)
+{
+	// test al, al on the pending operation
+	LoadByte(emit, OFFSET_FLAGS_OPERATION);
+	emit.Bytes({0x84, 0xC0});
+	size_t none = emit.Jump(JUMP_IF_ZERO);
+	// test al, al on the result; sete al
+	LoadByte(emit, OFFSET_FLAGS_RESULT);
+	emit.Bytes({0x84, 0xC0, 0x0F, 0x94, 0xC0});
+	size_t done = emit.Jump(JUMP_ALWAYS);
+	// shr eax, 7 on F
+	emit.Land(none);
+	LoadByte(emit, OFFSET_F);
+	emit.Bytes({0xC1, 0xE8, 0x07});
+	emit.Land(done);
+}
+
+// work out the carry flag into eax (as FlagC does, only calling out for the pending arithmetic)
+static void CarryFlag(Emitter &emit)
+{
+	std::vector<size_t> done;
+
+	// test al, al on the pending operation
+	LoadByte(emit, OFFSET_FLAGS_OPERATION);
+	emit.Bytes({0x84, 0xC0});
+	size_t pending = emit.Jump(JUMP_IF_NOT_ZERO);
+	// shr eax, 4; and eax, 1 on F
+	LoadByte(emit, OFFSET_F);
+	emit.Bytes({0xC1, 0xE8, 0x04, 0x83, 0xE0, 0x01});
+	done.push_back(emit.Jump(JUMP_ALWAYS));
+
+	// INC and DEC keep the carry flag they were given: cmp al, PENDING_INC
+	emit.Land(pending);
+	emit.Bytes({0x3C, PENDING_INC});
+	size_t alu = emit.Jump(JUMP_IF_BELOW);
+	LoadByte(emit, OFFSET_FLAGS_CARRY);
+	done.push_back(emit.Jump(JUMP_ALWAYS));
+
+	// AND, XOR and OR clear it: cmp al, AND; jb; cmp al, CP; je; xor eax, eax
+	emit.Land(alu);
+	emit.Bytes({0x3C, PENDING_ALU + ALU_AND});
+	size_t arithmetic = emit.Jump(JUMP_IF_BELOW);
+	emit.Bytes({0x3C, PENDING_ALU + ALU_CP});
+	size_t compare = emit.Jump(JUMP_IF_ZERO);
+	emit.Bytes({0x31, 0xC0});
+	done.push_back(emit.Jump(JUMP_ALWAYS));
+
+	// the arithmetic: mov rdi, rbx; mov rax, GetCarryFlag; call rax; movzx eax, al
+	emit.Land(arithmetic);
+	emit.Land(compare);
+	emit.Bytes({0x48, 0x89, 0xDF, 0x48, 0xB8});
+	emit.Qword((unsigned long long)&Cpu::GetCarryFlag);
+	emit.Bytes({0xFF, 0xD0, 0x0F, 0xB6, 0xC0});
+
+	for (size_t i = 0; i < done.size(); i++) emit.Land(done[i]);
+}
+
+// ADD/ADC/SUB/SBC/AND/XOR/OR/CP A,r13d (setting the pending flags as Alu does)
+static void Alu(Emitter &emit, int operation)
+{
+	// the carry in: mov edx, eax (or xor edx, edx)
+	if (operation == ALU_ADC || operation == ALU_SBC)
+	{
+		CarryFlag(emit);
+		emit.Bytes({0x89, 0xC2});
+	}
+	else
+	{
+		emit.Bytes({0x31, 0xD2});
+	}
+
+	// mov ecx, r13d; movzx eax, A
+	emit.Bytes({0x44, 0x89, 0xE9});
+	LoadByte(emit, OFFSET_A);
+	// mov [Val], al; mov [Val2], cl; mov [Carry], dl
+	StoreAl(emit, OFFSET_FLAGS_VAL);
+	emit.Bytes({0x88, 0x8B});
+	emit.Dword((unsigned int)OFFSET_FLAGS_VAL2);
+	emit.Bytes({0x88, 0x93});
+	emit.Dword((unsigned int)OFFSET_FLAGS_CARRY);
+	StoreByte(emit, OFFSET_FLAGS_OPERATION, (BYTE)(PENDING_ALU + operation));
+
+	switch(operation)
+	{
+		case ALU_ADD: emit.Bytes({0x00, 0xC8}); break; // add al, cl
+		case ALU_ADC: emit.Bytes({0x00, 0xD0, 0x00, 0xC8}); break; // add al, dl; add al, cl
+		case ALU_SUB: case ALU_CP: emit.Bytes({0x28, 0xC8}); break; // sub al, cl
+		case ALU_SBC: emit.Bytes({0x28, 0xD0, 0x28, 0xC8}); break; // sub al, dl; sub al, cl
+		case ALU_AND: emit.Bytes({0x20, 0xC8}); break; // and al, cl
+		case ALU_XOR: emit.Bytes({0x30, 0xC8}); break; // xor al, cl
+		case ALU_OR: emit.Bytes({0x08, 0xC8}); break; // or al, cl
+	}
+
+	StoreAl(emit, OFFSET_FLAGS_RESULT);
+	if (operation != ALU_CP) StoreAl(emit, OFFSET_A);
+}
+
+// add the cycles an instruction took to the cpu's cycles and the clock
+static void AddCycles(Emitter &emit, int cycles)
+{
+	// add dword [rbx + Cycles], cycles
+	emit.Bytes({0x83, 0x83});
+	emit.Dword((unsigned int)offsetof(Cpu::State, Cycles));
+	emit.Byte((BYTE)cycles);
+	// add qword [r12], cycles
+	emit.Bytes({0x49, 0x83, 0x04, 0x24, (BYTE)cycles});
+}
+
+// call an interpreter handler for an instruction (the clock follows the cycles it took)
+static void CallHandler(Emitter &emit, Cpu::Handler handler)
+{
+	// mov r13d, [rbx + Cycles]
+	emit.Bytes({0x44, 0x8B, 0xAB});
+	emit.Dword((unsigned int)offsetof(Cpu::State, Cycles));
+	// mov rdi, rbx
+	emit.Bytes({0x48, 0x89, 0xDF});
+	// mov rax, handler; call rax
+	emit.Bytes({0x48, 0xB8});
+	emit.Qword((unsigned long long)handler);
+	emit.Bytes({0xFF, 0xD0});
+	// movsxd rax, [rbx + Cycles]; movsxd r13, r13d; sub rax, r13; add [r12], rax
+	emit.Bytes({0x48, 0x63, 0x83});
+	emit.Dword((unsigned int)offsetof(Cpu::State, Cycles));
+	emit.Bytes({0x4D, 0x63, 0xED});
+	emit.Bytes({0x4C, 0x29, 0xE8});
+	emit.Bytes({0x49, 0x01, 0x04, 0x24});
+}
+
+// did a write change what the block relies on? (the events, the interrupts or the memory map)
+static bool Changed(Dynarec::Context *context)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	const BYTE *mem = gameBoy->MemoryState.Mem;
+
+	if (gameBoy->SchedulerState.NextEvent != context->NextEvent) return true;
+	if (gameBoy->MemoryState.Generation != context->Generation) return true;
+
+	return (gameBoy->InterruptState.MasterSwitch && (mem[INT_REQUEST_ADDRESS] & mem[INT_ENABLED_ADDRESS] & 0x1F) != 0);
+}
+
+// does the instruction end a block? (jumps, calls, returns, RST, HALT, STOP and EI)
+static bool EndsBlock(BYTE opcode)
+{
+	switch(opcode)
+	{
+		case 0x10: case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: case 0x76:
+		case 0xC0: case 0xC2: case 0xC3: case 0xC4: case 0xC8: case 0xC9: case 0xCA: case 0xCC: case 0xCD:
+		case 0xD0: case 0xD2: case 0xD4: case 0xD8: case 0xD9: case 0xDA: case 0xDC: case 0xE9: case 0xFB:
+			return true;
+
+		default: return ((opcode & 0xC7) == 0xC7); // RST n
+	}
+}
+
+// can the instruction write memory?
+static bool MayWrite(BYTE opcode, BYTE extended)
+{
+	switch(opcode)
+	{
+		case 0x02: case 0x08: case 0x12: case 0x22: case 0x32: case 0x34: case 0x35: case 0x36:
+		case 0xC5: case 0xD5: case 0xE0: case 0xE2: case 0xE5: case 0xEA: case 0xF5:
+			return true;
+
+		// the rotates, shifts, RES and SET of (HL)
+		case 0xCB: return ((extended & 7) == 6 && (extended >> 6) != 1);
+
+		// LD (HL),r
+		default: return (opcode >= 0x70 && opcode <= 0x77 && opcode != 0x76);
+	}
+}
+
+// translate an instruction into native code, returns false if it has to call its handler
+static bool Translate(Emitter &emit, const Cpu::Decoded &code, WORD address)
+{
+	BYTE opcode = code.Opcode;
+	const int x = (opcode >> 6);
+	const int y = ((opcode >> 3) & 7);
+	const int z = (opcode & 7);
+	WORD next = (WORD)(address + code.Length);
+
+	// NOP
+	if (opcode == 0x00)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		AddCycles(emit, 4);
+		return true;
+	}
+
+	// LD r,r'
+	if (x == 1 && y != 6 && z != 6)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+
+		if (y != z)
+		{
+			LoadByte(emit, RegisterOffset(z));
+			StoreAl(emit, RegisterOffset(y));
+		}
+
+		AddCycles(emit, 4);
+		return true;
+	}
+
+	// LD r,(HL)
+	if (x == 1 && y != 6 && z == 6)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		// movzx eax, word [rbx + HL]
+		emit.Bytes({0x0F, 0xB7, 0x83});
+		emit.Dword((unsigned int)PairOffset(2));
+		Read(emit);
+		StoreAl(emit, RegisterOffset(y));
+		AddCycles(emit, 8);
+		return true;
+	}
+
+	// LD A,(BC), LD A,(DE), LD A,(HL+) and LD A,(HL-)
+	if ((opcode & 0xCF) == 0x0A)
+	{
+		int pair = (opcode >> 4);
+
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		// movzx eax, word [rbx + rr]
+		emit.Bytes({0x0F, 0xB7, 0x83});
+		emit.Dword((unsigned int)PairOffset((pair < 2) ? pair : 2));
+		Read(emit);
+		StoreAl(emit, OFFSET_A);
+
+		// add (or sub) word [rbx + HL], 1
+		if (pair >= 2)
+		{
+			emit.Bytes({0x66, 0x83, (BYTE)((pair == 2) ? 0x83 : 0xAB)});
+			emit.Dword((unsigned int)PairOffset(2));
+			emit.Byte(1);
+		}
+
+		AddCycles(emit, 8);
+		return true;
+	}
+
+	// LDH A,(a8), LD A,(FF00 + C) and LD A,(a16)
+	if (opcode == 0xF0 || opcode == 0xF2 || opcode == 0xFA)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+
+		if (opcode == 0xF2)
+		{
+			// movzx eax, C; or eax, 0xFF00
+			LoadByte(emit, RegisterOffset(1));
+			emit.Byte(0x0D);
+			emit.Dword(0xFF00);
+		}
+		else
+		{
+			// mov eax, address
+			emit.Byte(0xB8);
+			emit.Dword((opcode == 0xF0) ? (0xFF00 + (BYTE)code.Operand) : code.Operand);
+		}
+
+		Read(emit);
+		StoreAl(emit, OFFSET_A);
+		AddCycles(emit, (opcode == 0xF0) ? 12 : (opcode == 0xF2) ? 8 : 16);
+		return true;
+	}
+
+	// LD r,d8
+	if (x == 0 && z == 6 && y != 6)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		StoreByte(emit, RegisterOffset(y), (BYTE)code.Operand);
+		AddCycles(emit, 8);
+		return true;
+	}
+
+	// LD rr,d16
+	if ((opcode & 0xCF) == 0x01)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		StoreWord(emit, PairOffset(opcode >> 4), code.Operand);
+		AddCycles(emit, 12);
+		return true;
+	}
+
+	// INC rr and DEC rr
+	if ((opcode & 0xCF) == 0x03 || (opcode & 0xCF) == 0x0B)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		// add (or sub) word [rbx + rr], 1
+		emit.Bytes({0x66, 0x83, (BYTE)(((opcode & 0xCF) == 0x03) ? 0x83 : 0xAB)});
+		emit.Dword((unsigned int)PairOffset(opcode >> 4));
+		emit.Byte(1);
+		AddCycles(emit, 8);
+		return true;
+	}
+
+	// INC r and DEC r (which keep the carry flag)
+	if (x == 0 && (z == 4 || z == 5) && y != 6)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		CarryFlag(emit);
+		StoreAl(emit, OFFSET_FLAGS_CARRY);
+		// inc (or dec) al
+		LoadByte(emit, RegisterOffset(y));
+		emit.Bytes({0xFE, (BYTE)((z == 4) ? 0xC0 : 0xC8)});
+		StoreAl(emit, RegisterOffset(y));
+		StoreAl(emit, OFFSET_FLAGS_RESULT);
+		StoreByte(emit, OFFSET_FLAGS_OPERATION, (z == 4) ? PENDING_INC : PENDING_DEC);
+		StoreByte(emit, OFFSET_FLAGS_VAL, 0);
+		StoreByte(emit, OFFSET_FLAGS_VAL2, 0);
+		AddCycles(emit, 4);
+		return true;
+	}
+
+	// ALU A,r, ALU A,(HL) and ALU A,d8
+	if (x == 2 || (x == 3 && z == 6))
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+
+		if (x == 3)
+		{
+			// mov r13d, d8
+			emit.Bytes({0x41, 0xBD});
+			emit.Dword((BYTE)code.Operand);
+		}
+		else if (z == 6)
+		{
+			// movzx eax, word [rbx + HL]; (read); mov r13d, eax
+			emit.Bytes({0x0F, 0xB7, 0x83});
+			emit.Dword((unsigned int)PairOffset(2));
+			Read(emit);
+			emit.Bytes({0x41, 0x89, 0xC5});
+		}
+		else
+		{
+			// movzx r13d, byte [rbx + r]
+			emit.Bytes({0x44, 0x0F, 0xB6, 0xAB});
+			emit.Dword((unsigned int)RegisterOffset(z));
+		}
+
+		Alu(emit, y);
+		AddCycles(emit, (x == 2 && z != 6) ? 4 : 8);
+		return true;
+	}
+
+	// JR r8
+	if (opcode == 0x18)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), (WORD)(next + (SIGNED_BYTE)code.Operand));
+		AddCycles(emit, 12);
+		return true;
+	}
+
+	// JP a16
+	if (opcode == 0xC3)
+	{
+		StoreWord(emit, offsetof(Cpu::State, PC), code.Operand);
+		AddCycles(emit, 16);
+		return true;
+	}
+
+	// JR cc,r8 and JP cc,a16 (NZ, Z, NC or C)
+	if ((opcode & 0xE7) == 0x20 || (opcode & 0xE7) == 0xC2)
+	{
+		bool relative = (x == 0);
+		int condition = (y & 3);
+		WORD target = relative ? (WORD)(next + (SIGNED_BYTE)code.Operand) : code.Operand;
+		// the cycles if the jump isn't taken, as the interpreter counts them (taking it adds 4)
+		int cycles = (relative || opcode != 0xC2) ? 8 : 12;
+
+		// test al, al on the flag (the jump is taken if it's set for Z and C, or clear for NZ and NC)
+		if (condition < 2) ZeroFlag(emit); else CarryFlag(emit);
+		emit.Bytes({0x84, 0xC0});
+		size_t skip = emit.Jump((condition & 1) ? JUMP_IF_ZERO : JUMP_IF_NOT_ZERO);
+		StoreWord(emit, offsetof(Cpu::State, PC), target);
+		AddCycles(emit, cycles + 4);
+		size_t done = emit.Jump(JUMP_ALWAYS);
+		emit.Land(skip);
+		StoreWord(emit, offsetof(Cpu::State, PC), next);
+		AddCycles(emit, cycles);
+		emit.Land(done);
+		return true;
+	}
+
+	return false;
+}
+
+// # Setters # //
+
+// enable (or disable) the dynarec for the current machine
+void Dynarec::Enable(bool enabled)
+{
+	GameBoy::Current()->DynarecState.Disabled = !enabled;
+}
+
+// # Blocks # //
+
+// init the dynarec (forgets every compiled block)
+void Dynarec::Init()
+{
+	Flush();
+}
+
+// can the current machine run compiled blocks?
+bool Dynarec::IsSupported()
+{
+	return (GetArena().Code != NULL);
+}
+
+// find (or compile) the block an address is in, and which of its instructions it is (NULL if it has to be interpreted)
+const Dynarec::Block *Dynarec::Lookup(WORD address, int &entry)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	State &state = gameBoy->DynarecState;
+	const Cpu::Decoded *code = Memory::ReadCode(address);
+
+	// only decoded rom code is compiled
+	if (state.Disabled || code == NULL || code->Length == 0) return NULL;
+
+	// the blocks are of another rom
+	if (state.CodeImage != gameBoy->RomState.CurrentImage)
+	{
+		Flush();
+		state.CodeImage = gameBoy->RomState.CurrentImage;
+		state.Banks.resize((state.CodeImage->Size / ROM_BANK_SIZE) * 2);
+	}
+
+	// find the blocks of the bank at the window it is mapped at (blocks are compiled for their addresses), and the offset of the code in it
+	size_t window = (address / ROM_BANK_SIZE);
+	size_t slot = ((gameBoy->RomState.MappedBanks[window] * 2) + window);
+	size_t offset = (address & (ROM_BANK_SIZE - 1));
+
+	if (!state.Banks[slot])
+	{
+		state.Banks[slot].reset(new Bank());
+	}
+
+	unsigned int id = state.Banks[slot]->Blocks[offset];
+
+	if (id == 0)
+	{
+		if (!IsSupported()) return NULL;
+
+		id = Compile(code, address, ROM_BANK_SIZE - offset);
+
+		// (after compiling, which flushes the blocks when the arena is full)
+		if (!state.Banks[slot]) state.Banks[slot].reset(new Bank());
+		Bank &blocks = *state.Banks[slot];
+
+		if (id == 0)
+		{
+			blocks.Blocks[offset] = DYNAREC_NO_BLOCK;
+			return NULL;
+		}
+
+		// the block's instructions that aren't in another block yet enter it
+		for (int i = 0, at = 0; i < state.Blocks[id].Count; at += code[at].Length, i++)
+		{
+			if (blocks.Blocks[offset + at] != 0) continue;
+
+			blocks.Blocks[offset + at] = id;
+			blocks.Entries[offset + at] = (BYTE)i;
+		}
+	}
+
+	if (id == DYNAREC_NO_BLOCK) return NULL;
+
+	entry = state.Banks[slot]->Entries[offset];
+
+	return &state.Blocks[id];
+}
+
+// run a block from one of its instructions, returns the number of instructions ran
+int Dynarec::Execute(const Block &block, int entry, int cycles)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	Context context;
+	unsigned long long end = scheduler.Clock + (unsigned long long)(cycles - gameBoy->CpuState.Cycles);
+
+	context.Clock = &scheduler.Clock;
+	context.Deadline = (scheduler.NextEvent < end) ? scheduler.NextEvent : end;
+	context.NextEvent = scheduler.NextEvent;
+	context.Generation = gameBoy->MemoryState.Generation;
+	context.ReadPage = gameBoy->MemoryState.ReadPage;
+	context.Entry = ((const BYTE *)block.Code + block.Entries[entry]);
+
+	return (block.Code(&gameBoy->CpuState, &context) - entry);
+}
+
+// compile the block starting at a decoded instruction (size is the number of decoded instructions left in its bank), returns its id (0 if it has to be interpreted)
+unsigned int Dynarec::Compile(const Cpu::Decoded *code, WORD address, size_t size)
+{
+	State &state = GameBoy::Current()->DynarecState;
+	Emitter emit;
+	Block block;
+	size_t offset = 0;
+	int count = 0;
+	int native = 0;
+
+	// push rbx, rbp, r12, r13, r14 (which keeps the stack aligned for calls)
+	emit.Bytes({0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56});
+	// mov rbx, rdi (the cpu state); mov rbp, rsi (the context)
+	emit.Bytes({0x48, 0x89, 0xFB, 0x48, 0x89, 0xF5});
+	// mov r12, [rsi + Clock]; mov r14, [rsi + Deadline]
+	emit.Bytes({0x4C, 0x8B, 0xA6});
+	emit.Dword((unsigned int)offsetof(Context, Clock));
+	emit.Bytes({0x4C, 0x8B, 0xB6});
+	emit.Dword((unsigned int)offsetof(Context, Deadline));
+	// jmp [rsi + Entry] (to the instruction the block is entered at)
+	emit.Bytes({0xFF, 0xA6});
+	emit.Dword((unsigned int)offsetof(Context, Entry));
+
+	while (offset < size && count < DYNAREC_MAX_BLOCK_INSTRUCTIONS)
+	{
+		const Cpu::Decoded &instruction = code[offset];
+		WORD instructionAddress = (WORD)(address + offset);
+
+		// an instruction that runs past the end of the bank is left to the interpreter
+		if (instruction.Length == 0 || offset + instruction.Length > size) break;
+
+		bool last = EndsBlock(instruction.Opcode);
+		bool write = false;
+
+		block.Entries[count] = (WORD)emit.Code.size();
+
+		if (Translate(emit, instruction, instructionAddress))
+		{
+			native += 1;
+		}
+		else
+		{
+			// the handler expects PC past the opcode, and the immediate data in Operand
+			StoreWord(emit, offsetof(Cpu::State, PC), (WORD)(instructionAddress + 1));
+			if (instruction.Length > 1) StoreWord(emit, offsetof(Cpu::State, Operand), instruction.Operand);
+			CallHandler(emit, Cpu::GetHandler(instruction.Opcode));
+			write = MayWrite(instruction.Opcode, (BYTE)instruction.Operand);
+		}
+
+		block.LastAddress = instructionAddress;
+		block.LastOpcode = instruction.Opcode;
+		offset += instruction.Length;
+		count += 1;
+
+		if (last) break;
+
+		// mov eax, count
+		emit.Byte(0xB8);
+		emit.Dword(count);
+
+		// leave if the write changed the events, interrupts or memory map
+		if (write)
+		{
+			// mov rdi, rbp; mov rax, Changed; call rax; test al, al
+			emit.Bytes({0x48, 0x89, 0xEF, 0x48, 0xB8});
+			emit.Qword((unsigned long long)&Changed);
+			emit.Bytes({0xFF, 0xD0, 0x84, 0xC0});
+			// mov eax, count (the call replaced it)
+			emit.Byte(0xB8);
+			emit.Dword(count);
+			emit.JumpToEnd(JUMP_IF_NOT_ZERO);
+		}
+
+		// leave once the next event is due (or the run is over): cmp [r12], r14
+		emit.Bytes({0x4D, 0x39, 0x34, 0x24});
+		emit.JumpToEnd(JUMP_IF_ABOVE_OR_EQUAL);
+	}
+
+	// a block that would mostly call handlers runs faster on the interpreter
+	if (count == 0 || (native * 2) < count) return 0;
+
+	// mov eax, count
+	emit.Byte(0xB8);
+	emit.Dword(count);
+	emit.PatchExits();
+	// pop r14, r13, r12, rbp, rbx; ret
+	emit.Bytes({0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3});
+
+	if (emit.Code.size() > DYNAREC_CHUNK_SIZE) return 0;
+
+	// the block goes in the machine's last chunk, or a new one once that is full
+	if (state.Chunks.empty() || state.Used + emit.Code.size() > DYNAREC_CHUNK_SIZE)
+	{
+		std::unique_ptr<Chunk> chunk(new Chunk());
+
+		// every chunk is in use, so start again with the machine's own
+		if (chunk->Code == NULL)
+		{
+			Flush();
+			chunk.reset(new Chunk());
+		}
+
+		if (chunk->Code == NULL) return 0;
+
+		state.Chunks.push_back(std::move(chunk));
+		state.Used = 0;
+	}
+
+	// the chunk is only writable while the block is copied in (nothing runs from it meanwhile, as it's only ran by this machine)
+	BYTE *chunk = state.Chunks.back()->Code;
+	BYTE *start = (chunk + state.Used);
+
+	if (mprotect(chunk, DYNAREC_CHUNK_SIZE, PROT_READ | PROT_WRITE) != 0) return 0;
+	memcpy(start, emit.Code.data(), emit.Code.size());
+	if (mprotect(chunk, DYNAREC_CHUNK_SIZE, PROT_READ | PROT_EXEC) != 0) return 0;
+
+	// keep blocks 16 byte aligned
+	state.Used += ((emit.Code.size() + 15) & ~(size_t)15);
+
+	block.Code = (int (*)(Cpu::State *, Context *))start;
+	block.Count = count;
+	state.Blocks.push_back(block);
+
+	return (unsigned int)(state.Blocks.size() - 1);
+}
+
+// forget every compiled block
+void Dynarec::Flush()
+{
+	State &state = GameBoy::Current()->DynarecState;
+
+	// give the chunks back
+	state.Chunks.clear();
+	state.Used = 0;
+
+	state.Blocks.clear();
+	state.Blocks.push_back(Block());
+
+	// unlink the blocks from the rom code
+	for (size_t bank = 0; bank < state.Banks.size(); bank++)
+	{
+		state.Banks[bank].reset();
+	}
+}
+
+#else
+
+// # Interpreter Only # //
+
+// enable (or disable) the dynarec for the current machine
+void Dynarec::Enable(bool enabled)
+{
+}
+
+// init the dynarec
+void Dynarec::Init()
+{
+}
+
+// can the current machine run compiled blocks?
+bool Dynarec::IsSupported()
+{
+	return false;
+}
+
+// find (or compile) the block an address is in
+const Dynarec::Block *Dynarec::Lookup(WORD address, int &entry)
+{
+	return NULL;
+}
+
+// run a block from one of its instructions
+int Dynarec::Execute(const Block &block, int entry, int cycles)
+{
+	return 0;
+}
+
+#endif
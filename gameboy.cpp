@@ -0,0 +1,99 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: gameboy.cpp
+*/
+
+// includes
+#include "include/gameboy.h"
+
+// the machine bound to this thread
+thread_local GameBoy * GameBoy::current = NULL;
+
+// create a powered-off machine (all state zeroed)
+GameBoy::GameBoy() : CpuState(), MemoryState(), TimerState(), JoypadState(), LcdState(), InterruptState(), RomState(), BiosState(), SchedulerState(), DynarecState()
+{
+	// map the memory
+	Memory::Map(MemoryState);
+}
+
+// bind the machine to the calling thread
+void GameBoy::Bind()
+{
+	current = this;
+	Memory::Bind(MemoryState);
+}
+
+// init the machine (the rom and bios should already be loaded)
+void GameBoy::Init(bool usingBios)
+{
+	Bind();
+	// init the scheduler
+	Scheduler::Init();
+	// init the Cpu
+	Cpu::Init(usingBios);
+	// init the timer
+	Timer::Init();
+	// init the joypad
+	Joypad::Init();
+	// init Lcd
+	Lcd::Init();
+	// init the dynarec
+	Dynarec::Init();
+}
+
+// execute a single instruction, returns the cycles it took
+int GameBoy::Step()
+{
+	Bind();
+	// store the current cycle
+	int currentCycle = CpuState.Cycles;
+	// execute the next opcode
+	Cpu::ExecuteOpcode();
+	// get the value of the current cycle only
+	int cycles = (CpuState.Cycles - currentCycle);
+	// run the hardware events that are due
+	Scheduler::Advance(SchedulerState, cycles);
+	// service interupts
+	Interrupt::Service();
+	// the time taken to service an interrupt
+	Scheduler::Advance(SchedulerState, CpuState.Cycles - currentCycle - cycles);
+
+	return cycles;
+}
+
+// run for (at least) the given number of cycles, returns the number of instructions ran
+int GameBoy::RunCycles(int cycles)
+{
+	Bind();
+	// reset Cpu cycles
+	CpuState.Cycles = 0;
+	// execute if within the max cycles for this update
+	return Cpu::Run(cycles);
+}
+
+// run a single frame, returns the number of instructions ran
+int GameBoy::RunFrame()
+{
+	return RunCycles(FRAME_CYCLES);
+}
+
+// run frames that won't be kept (for run-ahead, the caller puts the machine back), returns the number of instructions ran
+int GameBoy::RunFramesAhead(int frames)
+{
+	Bind();
+	int instructions = 0;
+	unsigned long long end = Scheduler::Now() + ((unsigned long long)frames * FRAME_CYCLES);
+
+	// only the last lcd frame is drawn, the scanlines before it are drawn over before the screen is shown
+	Lcd::Set::DrawFrom((end > LCD_FRAME_CYCLES) ? (end - LCD_FRAME_CYCLES) : 0);
+
+	for (int i = 0; i < frames; i++)
+	{
+		instructions += RunFrame();
+	}
+
+	Lcd::Set::DrawFrom(0);
+
+	return instructions;
+}
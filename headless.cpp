@@ -0,0 +1,269 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: headless.cpp
+*/
+
+// includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "include/batch.h"
+#include "include/bios.h"
+#include "include/cpu.h"
+#include "include/dynarec.h"
+#include "include/gameboy.h"
+#include "include/lcd.h"
+#include "include/log.h"
+#include "include/movie.h"
+#include "include/pacer.h"
+#include "include/rom.h"
+#include "include/saveState.h"
+#include "include/snapshot.h"
+#include "include/unitTest.h"
+
+// default number of frames to run
+#define DEFAULT_FRAMES 600
+
+// the emulated machines
+static std::vector<std::unique_ptr<GameBoy>> gameBoys;
+// number of instructions ran
+static long instructionsRan = 0;
+
+// print usage
+static void Usage(const char *name)
+{
+	Log::Normal("usage: %s [-f frames] [-n instances] [-j threads] [-b bios] [-s speed] [-a frames] [-l state] [-m movie] [-i] [-t] <rom>", name);
+	Log::Normal("  -f frames  number of frames to emulate (default %d)", DEFAULT_FRAMES);
+	Log::Normal("  -n count   number of machines to run side by side (default 1)");
+	Log::Normal("  -j threads number of worker threads (default one per cpu)");
+	Log::Normal("  -b bios    boot from the given bios image");
+	Log::Normal("  -s speed   run at N times the real speed (default 0, uncapped)");
+	Log::Normal("  -a frames  run N frames ahead of each frame and go back, as run-ahead does (one machine only)");
+	Log::Normal("  -l state   start from a save state");
+	Log::Normal("  -m movie   play a movie back (to its end) and check it stays in sync (one machine only)");
+	Log::Normal("  -i         interpret only (don't compile rom code to native code)");
+	Log::Normal("  -t         run the unit tests and exit");
+}
+
+// run the unit tests, returns the number of checks that failed
+static int RunUnitTests()
+{
+	GameBoy gameBoy;
+	gameBoy.Init(false);
+	UnitTest::Test::EightBit::Add();
+	UnitTest::Test::EightBit::AddCarry();
+	UnitTest::Test::EightBit::Sub();
+	UnitTest::Test::EightBit::SubCarry();
+	UnitTest::Test::EightBit::Dec();
+	UnitTest::Test::EightBit::Inc();
+	UnitTest::Test::EightBit::Compare();
+	UnitTest::Test::EightBit::And();
+	UnitTest::Test::EightBit::Or();
+	UnitTest::Test::EightBit::Xor();
+	UnitTest::Test::EightBit::RotateRight();
+	UnitTest::Test::EightBit::LoadHigh();
+	UnitTest::Test::EightBit::PendingFlags();
+	UnitTest::Test::SixteenBit::Add();
+	UnitTest::Test::Cartridge::Mbc1();
+	UnitTest::Test::Cartridge::Mbc3();
+	UnitTest::Test::Cartridge::Mbc5();
+	UnitTest::Test::Cartridge::Reload();
+	UnitTest::Test::Cartridge::RealTimeClock();
+	UnitTest::Test::Timing::Divider();
+	UnitTest::Test::Timing::Counter();
+	UnitTest::Test::Machine::SaveStates();
+	UnitTest::Test::Machine::RewindStates();
+	UnitTest::Test::Machine::MovieSync();
+	UnitTest::Test::Machine::Recompiler();
+	UnitTest::Test::Screen::ConvertLine();
+
+	return UnitTest::Get::Failures();
+}
+
+// main
+int main(int argc, char* args[])
+{
+	const char *romFileName = NULL;
+	const char *biosFileName = NULL;
+	long frames = DEFAULT_FRAMES;
+	int instances = 1;
+	int threads = 0;
+	double speed = 0;
+	int runAhead = 0;
+	const char *stateFileName = NULL;
+	const char *movieFileName = NULL;
+	bool didLoadBios = false;
+	bool interpretOnly = false;
+
+	// parse the arguments
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(args[i], "-f") == 0 && (i + 1) < argc)
+		{
+			frames = atol(args[++i]);
+		}
+		else if (strcmp(args[i], "-n") == 0 && (i + 1) < argc)
+		{
+			instances = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "-j") == 0 && (i + 1) < argc)
+		{
+			threads = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "-b") == 0 && (i + 1) < argc)
+		{
+			biosFileName = args[++i];
+		}
+		else if (strcmp(args[i], "-s") == 0 && (i + 1) < argc)
+		{
+			speed = atof(args[++i]);
+		}
+		else if (strcmp(args[i], "-a") == 0 && (i + 1) < argc)
+		{
+			runAhead = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "-l") == 0 && (i + 1) < argc)
+		{
+			stateFileName = args[++i];
+		}
+		else if (strcmp(args[i], "-m") == 0 && (i + 1) < argc)
+		{
+			movieFileName = args[++i];
+		}
+		else if (strcmp(args[i], "-i") == 0)
+		{
+			interpretOnly = true;
+		}
+		else if (strcmp(args[i], "-t") == 0)
+		{
+			// (a failed check fails the run, so the tests can gate a build)
+			int failures = RunUnitTests();
+			Log::Normal("unit tests: %d failed", failures);
+			return (failures == 0) ? 0 : 1;
+		}
+		else if (args[i][0] != '-')
+		{
+			romFileName = args[i];
+		}
+		else
+		{
+			Usage(args[0]);
+			return 1;
+		}
+	}
+
+	// a rom and at least one machine are required (and a movie plays on one)
+	if (romFileName == NULL || instances < 1 || (movieFileName != NULL && instances != 1))
+	{
+		Usage(args[0]);
+		return 1;
+	}
+
+	// create the machines (they all share the same rom image)
+	for (int i = 0; i < instances; i++)
+	{
+		GameBoy *gameBoy = new GameBoy();
+		gameBoys.push_back(std::unique_ptr<GameBoy>(gameBoy));
+
+		// bind the machine to this thread
+		gameBoy->Bind();
+
+		// load the rom
+		if (!Rom::Load(romFileName)) return 1;
+
+		// load the bios
+		if (biosFileName != NULL)
+		{
+			didLoadBios = Bios::Load(biosFileName);
+		}
+
+		// init the machine
+		gameBoy->Init(didLoadBios);
+
+		// run it on the interpreter only
+		if (interpretOnly)
+		{
+			Dynarec::Enable(false);
+		}
+
+		// start from a save state
+		if (stateFileName != NULL && !SaveState::LoadFromFile(stateFileName)) return 1;
+	}
+
+	std::vector<GameBoy *> machines;
+
+	for (int i = 0; i < instances; i++)
+	{
+		machines.push_back(gameBoys[i].get());
+	}
+
+	// keep to the requested speed
+	Pacer pacer;
+	pacer.SetMode((speed > 0) ? Pacer::MULTIPLIER : Pacer::UNCAPPED, speed);
+
+	// run the requested number of frames
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// play the movie back to its end
+	Movie movie;
+	bool synced = true;
+
+	if (movieFileName != NULL)
+	{
+		if (!movie.StartPlayback(movieFileName)) return 1;
+
+		frames = 0;
+
+		for (int cycles = movie.Play(FRAME_CYCLES); cycles > 0; cycles = movie.Play(FRAME_CYCLES))
+		{
+			instructionsRan += machines[0]->RunCycles(cycles);
+			pacer.Pace(cycles);
+			frames++;
+		}
+
+		synced = movie.StopPlayback();
+	}
+	else if (instances == 1)
+	{
+		Snapshot snapshot;
+
+		for (long i = 0; i < frames; i++)
+		{
+			instructionsRan += machines[0]->RunFrame();
+
+			// run ahead, then go back
+			if (runAhead > 0)
+			{
+				snapshot.Take();
+				machines[0]->RunFramesAhead(runAhead);
+				snapshot.Restore();
+			}
+
+			pacer.Pace(FRAME_CYCLES);
+		}
+	}
+	else
+	{
+		Batch batch(threads);
+
+		for (long i = 0; i < frames; i++)
+		{
+			instructionsRan += batch.RunFrames(machines.data(), instances, 1);
+			pacer.Pace(FRAME_CYCLES);
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double emulated = (double)frames * instances / 60.0;
+
+	// report
+	Log::Normal("instances: %d, frames: %ld, instructions: %ld, time: %.3fs, speed: %.1fx", instances, frames, instructionsRan, elapsed, (elapsed > 0) ? (emulated / elapsed) : 0.0);
+
+	if (movieFileName != NULL) Log::Normal("movie: %s", synced ? "in sync" : "OUT OF SYNC");
+
+	return synced ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: batch.h
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// includes
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "typedefs.h"
+
+// forward declarations
+class GameBoy;
+
+// batch class (steps many machines at once on a pool of worker threads)
+//
+// Each worker owns a slice of the machines and steals from the other slices
+// once its own is empty. The calling thread takes part as worker 0, and the
+// pool threads sleep between batches.
+class Batch
+{
+	public:
+		Batch(int threadCount = 0);
+		~Batch();
+		long RunFrames(GameBoy **machines, int count, int frames);
+		long RunCycles(GameBoy **machines, int count, int cycles);
+		int GetThreadCount() const;
+
+	private:
+		long Run(GameBoy **machines, int count, int cycles, int frames);
+		void WorkerLoop(int id);
+		long DoWork(int id);
+
+	private:
+		// a worker's slice of the machines
+		struct alignas(64) Slice
+		{
+			std::atomic<int> Next;
+			int End;
+		};
+
+		std::vector<std::thread> Threads;
+		std::vector<Slice> Slices;
+		std::mutex Lock;
+		std::condition_variable Start;
+		std::condition_variable Done;
+		// the current batch
+		GameBoy **Machines;
+		int Cycles;
+		int Frames;
+		long Generation;
+		int Running;
+		bool Quit;
+		std::atomic<long> InstructionsRan;
+};
+
+#endif
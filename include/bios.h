@@ -10,16 +10,26 @@
 // includes
 #include "typedefs.h"
 
-// bios class
+// definitions
+#define BIOS_SIZE 0x100
+
+// bios class (overlays the first page of the rom until the bios removes itself)
 class Bios
 {
 	public:
 		static bool Load(const char *fileName);
 		static void Reload();
 		static void Remove();
+		static void Map();
 
-	private:
-		static const char *biosFileName;
+	public:
+		// the bios state of a single machine (owned by GameBoy)
+		struct State
+		{
+			const char *FileName;
+			BYTE Data[BIOS_SIZE];
+			bool Mapped;
+		};
 };
 
 #endif
\ No newline at end of file
@@ -23,4 +23,49 @@ class Bit
 		static BYTE DidCarry(int val, WORD mask);
 };
 
+// set a bit
+inline void Bit::Set(BYTE &val, BYTE bit)
+{
+	BYTE mask = 1 << bit;
+	val |= mask;
+}
+
+// reset a bit
+inline void Bit::Reset(BYTE &val, BYTE bit)
+{
+	BYTE mask = 1 << bit;
+	val &= ~mask;
+}
+
+// get a bit
+inline BYTE Bit::Get(BYTE val, BYTE bit)
+{
+	BYTE mask = 1 << bit;
+	return (val & mask) ? 1 : 0;
+}
+
+// did we half carry
+inline BYTE Bit::DidHalfCarry(BYTE val, BYTE val2, BYTE mask)
+{
+	return ((val & mask) + (val2 & mask)) > mask;
+}
+
+// did we half carry
+inline BYTE Bit::DidHalfCarry(WORD val, WORD val2, WORD mask)
+{
+	return ((val & mask) + (val2 & mask)) > mask;
+}
+
+// did we carry
+inline BYTE Bit::DidCarry(WORD val, WORD mask)
+{
+	return val > mask;
+}
+
+// did we carry
+inline BYTE Bit::DidCarry(int val, WORD mask)
+{
+	return val > mask;
+}
+
 #endif
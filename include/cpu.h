@@ -10,6 +10,29 @@
 // includes
 #include "typedefs.h"
 
+// definitions
+// 8 bit alu operations, in the order they're encoded in the opcodes
+#define ALU_ADD 0
+#define ALU_ADC 1
+#define ALU_SUB 2
+#define ALU_SBC 3
+#define ALU_AND 4
+#define ALU_XOR 5
+#define ALU_OR 6
+#define ALU_CP 7
+
+// pending flag operations (an alu operation, INC or DEC)
+#define PENDING_NONE 0
+#define PENDING_ALU 1
+#define PENDING_INC (PENDING_ALU + 8)
+#define PENDING_DEC (PENDING_ALU + 9)
+
+// masks of the flags in the F register
+#define FLAG_MASK_Z 0x80
+#define FLAG_MASK_N 0x40
+#define FLAG_MASK_H 0x20
+#define FLAG_MASK_C 0x10
+
 // cpu class
 class Cpu
 {
@@ -17,9 +40,19 @@ class Cpu
 		static int Init(bool usingBios);
 		static void ExecuteOpcode();
 		static void ExecuteExtendedOpcode();
-		static void Debugger();
-		static void SaveState();
-		static void LoadState();
+		static int Run(int cycles);
+
+	public:
+		// a pre-decoded instruction (the opcode and its immediate data)
+		struct Decoded
+		{
+			BYTE Opcode;
+			// the length of the instruction (0 if it runs past the end of the decoded code)
+			BYTE Length;
+			WORD Operand;
+		};
+
+		static void Decode(const BYTE *data, int size, Decoded *code);
 
 	public:
 		struct Operations 
@@ -28,8 +61,6 @@ class Cpu
 			bool Stop;
 			bool Halt;
 		};
-		static Operations Operation;
-		static int Cycles;
 
 	private:
 		union Registers 
@@ -41,12 +72,53 @@ class Cpu
 				BYTE hi;
 			};
 		};
-		static WORD PC;
-		static Registers SP;
-		static Registers AF;
-		static Registers BC;
-		static Registers DE;
-		static Registers HL;
+
+		// the last operation which set the flags (F is only worked out from it when it's read)
+		struct PendingFlags
+		{
+			BYTE Operation;
+			BYTE Val;
+			BYTE Val2;
+			BYTE Carry;
+			BYTE Result;
+		};
+
+	public:
+		// the backward branch being watched for an idle (polling) loop
+		struct IdleLoop
+		{
+			WORD Branch;
+			WORD Target;
+			// the clock, registers and cycles between the last two times the branch was taken
+			unsigned long long Clock;
+			unsigned long long Period;
+			WORD Registers[5];
+		};
+
+		// the cpu state of a single machine (owned by GameBoy)
+		struct State
+		{
+			WORD PC;
+			Registers SP;
+			Registers AF;
+			Registers BC;
+			Registers DE;
+			Registers HL;
+			Operations Operation;
+			PendingFlags Flags;
+			int Cycles;
+			// the immediate data of the current instruction
+			WORD Operand;
+			// counter to enable pending interrupts
+			int InterruptCounter;
+			IdleLoop Loop;
+		};
+
+		// an opcode's handler (runs the instruction with PC past the opcode and its immediate data in Operand)
+		typedef void (*Handler)(State &state);
+
+		static Handler GetHandler(BYTE opcode);
+		static BYTE GetCarryFlag(const State &state);
 
 	public:
 		// for getting members which should be indirectly-publicly accessible
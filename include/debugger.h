@@ -0,0 +1,21 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: debugger.h
+*/
+
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+// includes
+#include "typedefs.h"
+
+// debugger class (ImGui front-end, not part of the core)
+class Debugger
+{
+	public:
+		static void Init();
+		static void Show();
+};
+
+#endif
@@ -0,0 +1,22 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: display.h
+*/
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+// includes
+#include "typedefs.h"
+
+// display class (OpenGL presentation of the lcd, not part of the core)
+class Display
+{
+	public:
+		static void Init();
+		static void UpdateTexture(const BYTE *screen);
+		static void Render();
+};
+
+#endif
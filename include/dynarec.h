@@ -0,0 +1,142 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: dynarec.h
+*/
+
+#ifndef DYNAREC_H
+#define DYNAREC_H
+
+// includes
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "cpu.h"
+#include "rom.h"
+#include "typedefs.h"
+
+// definitions
+#if defined(__x86_64__) && defined(__linux__)
+#define DYNAREC_ENABLED
+#endif
+#define DYNAREC_ARENA_SIZE (64 * 1024 * 1024)
+#define DYNAREC_CHUNK_SIZE (64 * 1024)
+#define DYNAREC_MAX_BLOCK_INSTRUCTIONS 64
+// the block id of code that stays on the interpreter
+#define DYNAREC_NO_BLOCK 0xFFFFFFFF
+
+// dynarec class (recompiles rom code into native x86-64 code, a basic block at a time)
+//
+// A block is the straight run of rom code up to the next jump, call, return,
+// RST, HALT, STOP or EI. It is compiled the first time it is reached and kept
+// against the bank, window (0x0000 or 0x4000) and offset of each instruction
+// it covers, so a bank switch picks up the other bank's blocks and rom blocks
+// never need invalidating. The window is part of the key as a block has its
+// addresses compiled in, and a bank can be mapped at either window. A
+// block can be entered at any of its instructions, so one that left early
+// carries on from where it stopped.
+// The decoded code is the rom image's (shared), the block ids are the
+// machine's own.
+//
+// Register loads, memory reads, the 8 bit alu operations, INC/DEC and the
+// jumps are translated to native code (setting the lazy flags as the
+// interpreter does), everything else calls the interpreter's handler. A block
+// that would mostly call handlers isn't compiled at all. A block keeps PC, the
+// cycles and the clock current after every instruction, and leaves early once
+// the next event is due, the run is over or a write changed the events, the
+// interrupts or the memory map. Code outside the rom (and every host that
+// isn't x86-64 Linux) runs on the interpreter.
+//
+// The executable memory is reserved once per process and handed out to the
+// machines a chunk at a time. A chunk is only ever written by (and ran from)
+// the machine that owns it, and is only writable while a block is copied in.
+class Dynarec
+{
+	public:
+		// what a block runs against (filled in each time a block is ran)
+		struct Context
+		{
+			unsigned long long *Clock;
+			// the clock the block must stop at (the next event or the end of the run)
+			unsigned long long Deadline;
+			// the next event, interrupts and memory map when the block was entered
+			unsigned long long NextEvent;
+			unsigned int Generation;
+			// the machine's read page table (for reading memory without a call)
+			const BYTE *const *ReadPage;
+			// the native code of the instruction to start at
+			const BYTE *Entry;
+		};
+
+		// a compiled block
+		struct Block
+		{
+			// runs the block from the context's entry, returns the number of instructions ran up to where it stopped
+			int (*Code)(Cpu::State *state, Context *context);
+			// where the native code of each instruction starts
+			WORD Entries[DYNAREC_MAX_BLOCK_INSTRUCTIONS];
+			// the address and opcode of the block's last instruction
+			WORD LastAddress;
+			BYTE LastOpcode;
+			int Count;
+		};
+
+		// the executable memory the blocks are written to (one per process)
+		struct Arena
+		{
+			Arena();
+			BYTE *Code;
+			size_t Size;
+			// the chunks no machine is using
+			std::vector<BYTE *> FreeChunks;
+			std::mutex Lock;
+		};
+
+		// the blocks of a rom bank
+		struct Bank
+		{
+			// the id of the block each instruction is in (0 if there isn't one yet), and which of its instructions it is
+			unsigned int Blocks[ROM_BANK_SIZE];
+			BYTE Entries[ROM_BANK_SIZE];
+		};
+
+		// a chunk of the arena, owned by a single machine (given back when it's dropped)
+		struct Chunk
+		{
+			Chunk();
+			~Chunk();
+			// NULL if every chunk was in use
+			BYTE *Code;
+		};
+
+	public:
+		// the dynarec state of a single machine (owned by GameBoy)
+		struct State
+		{
+			bool Disabled;
+			// the chunks the blocks are written to, and how much of the last one is used
+			std::vector<std::unique_ptr<Chunk> > Chunks;
+			size_t Used;
+			// the compiled blocks (0 is unused, so a block id of 0 is none)
+			std::vector<Block> Blocks;
+			// the rom image the blocks were compiled from, and the blocks of each of its banks at each window
+			// (bank * 2 + window, allocated the first time a bank's code is ran there)
+			std::shared_ptr<const Rom::Image> CodeImage;
+			std::vector<std::unique_ptr<Bank> > Banks;
+		};
+
+	public:
+		static void Init();
+		static bool IsSupported();
+		static void Enable(bool enabled);
+		static const Block *Lookup(WORD address, int &entry);
+		static int Execute(const Block &block, int entry, int cycles);
+
+	private:
+		static Arena &GetArena();
+		static unsigned int Compile(const Cpu::Decoded *code, WORD address, size_t bankEnd);
+		static void Flush();
+};
+
+#endif
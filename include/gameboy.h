@@ -0,0 +1,66 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: gameboy.h
+*/
+
+#ifndef GAMEBOY_H
+#define GAMEBOY_H
+
+// includes
+#include "typedefs.h"
+#include "bios.h"
+#include "cpu.h"
+#include "dynarec.h"
+#include "interrupt.h"
+#include "joypad.h"
+#include "lcd.h"
+#include "memory.h"
+#include "rom.h"
+#include "scheduler.h"
+#include "timer.h"
+
+// definitions
+#define CLOCK_SPEED 4194304
+#define FRAME_CYCLES (CLOCK_SPEED / 60)
+
+// gameboy class (owns the complete state of one emulated machine)
+//
+// The Cpu, Memory, Timer, Joypad, Lcd, Interrupt, Rom and Bios classes operate on the
+// machine bound to the calling thread, so any number of machines can run in
+// one process (one at a time per thread).
+class GameBoy
+{
+	public:
+		GameBoy();
+		void Bind();
+		void Init(bool usingBios);
+		int Step();
+		int RunCycles(int cycles);
+		int RunFrame();
+		int RunFramesAhead(int frames);
+		static GameBoy *Current();
+
+	public:
+		Cpu::State CpuState;
+		Memory::State MemoryState;
+		Timer::State TimerState;
+		Joypad::State JoypadState;
+		Lcd::State LcdState;
+		Interrupt::State InterruptState;
+		Rom::State RomState;
+		Bios::State BiosState;
+		Scheduler::State SchedulerState;
+		Dynarec::State DynarecState;
+
+	private:
+		static thread_local GameBoy *current;
+};
+
+// get the machine bound to the calling thread
+inline GameBoy * GameBoy::Current()
+{
+	return current;
+}
+
+#endif
@@ -24,7 +24,28 @@ class Interrupt
 		enum IDS{
 			VBLANK = 0, LCD = 1, TIMER = 2, SERIAL = 3, JOYPAD = 4
 		};
-		static bool MasterSwitch;
+
+		// the interrupt state of a single machine (owned by GameBoy)
+		struct State
+		{
+			bool MasterSwitch;
+			// was the cpu in halt state
+			bool WasHalted;
+		};
+
+		// for getting members which should be indirectly-publicly accessible
+		class Get
+		{
+			public:
+				static bool MasterSwitch();
+		};
+
+		// for setting members which should be indirectly-publicly accessible
+		class Set
+		{
+			public:
+				static void MasterSwitch(bool val);
+		};
 
 	private:
 		union Type
@@ -0,0 +1,66 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: joypad.h
+*/
+
+#ifndef JOYPAD_H
+#define JOYPAD_H
+
+// includes
+#include "typedefs.h"
+
+// definitions
+#define JOYPAD_MAX_PENDING 32
+
+// joypad class (the buttons, read through P1 at 0xFF00)
+//
+// The host never changes the buttons directly. It queues each press and
+// release with the cycle it happens at, and a scheduler event applies it at
+// exactly that cycle, so the same input at the same cycles always runs the
+// same way (and the cpu never skips an idle loop or runs a block past it).
+// A P1 line going low while its group is selected requests the joypad
+// interrupt and ends STOP.
+class Joypad
+{
+	public:
+		enum Buttons
+		{
+			RIGHT, LEFT, UP, DOWN, A, B, SELECT, START, BUTTON_COUNT
+		};
+
+		// a press or release of a button, at a cycle
+		struct Input
+		{
+			unsigned long long Timestamp;
+			int Button;
+			bool Pressed;
+		};
+
+	public:
+		static void Init();
+		static bool Queue(Input input);
+		static BYTE Read();
+		static void Write(BYTE data);
+		static void Event(unsigned long long timestamp);
+
+	private:
+		static BYTE GetLines(BYTE select, BYTE held);
+		static void Change(BYTE select, BYTE held);
+
+	public:
+		// the joypad state of a single machine (owned by GameBoy)
+		//
+		// The group select bits are kept in memory at 0xFF00, the lines are
+		// worked out from them and the buttons held when read.
+		struct State
+		{
+			// a bit per button (in Buttons order), set while it is held
+			BYTE Held;
+			// the inputs waiting for their cycle, oldest first
+			Input Pending[JOYPAD_MAX_PENDING];
+			int PendingCount;
+		};
+};
+
+#endif
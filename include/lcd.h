@@ -10,24 +10,74 @@
 // includes
 #include "typedefs.h"
 
+// definitions
+#define TILE_COUNT 384
+#define PACKED_SCREEN_SIZE ((144 * 160) / 4)
+#define LCD_FRAME_CYCLES 70224
+
 // lcd class
 class Lcd
 {
 	public:
 		static void Init();
 		static void Reset();
-		static int SetLCDStatus();
 		static bool IsLCDEnabled();
 		static int DrawTiles();
 		static int DrawSprites();
 		static void DrawScanline();
-		static void UpdateTexture();
-		static int Update(int cycles);
-		static void Render();		
+		static void TurnOn();
+		static void TurnOff();
+		static void CheckCoincidence();
+		static void Event(unsigned long long timestamp);
+		static void InvalidateTile(WORD address);
+		static void InvalidateTiles();
+		static void PackScreen(BYTE *packed);
+		static void UnpackScreen(const BYTE *packed);
+		static bool ConvertLine(const BYTE *colourNumbers, const unsigned int colours[4], BYTE *out, int conversion);
+
+	private:
+		static void SetMode(BYTE mode);
+
+	public:
+		// for getting members which should be indirectly-publicly accessible
+		class Get
+		{
+			public:
+				static BYTE *Screen();
+				static unsigned int FrameCount();
+		};
+
+		// for setting members which should be indirectly-publicly accessible
+		class Set
+		{
+			public:
+				static void DrawFrom(unsigned long long clock);
+		};
+
+	public:
+		// the ways a scanline is converted to rgba (scanlines are drawn with the fastest the host supports)
+		enum Conversions
+		{
+			CONVERT_SCALAR, CONVERT_SSE2, CONVERT_AVX2, CONVERSION_COUNT
+		};
+
+	public:
+		// the lcd state of a single machine (owned by GameBoy)
+		struct State
+		{
+			// the screen, as rgba
+			BYTE Screen[144][160][4];
+			// the number of frames finished (bumped at vblank, and when the screen is cleared)
+			unsigned int FrameCount;
+			// the tile data decoded into colour numbers (a tile is decoded again once its vram is written)
+			BYTE Tiles[TILE_COUNT][8][8];
+			// a bit per tile, set when the tile's vram is written
+			unsigned int TileDirty[TILE_COUNT / 32];
+			// the scanlines transferred before this clock aren't drawn (they would be drawn over before being shown)
+			unsigned long long DrawFrom;
+		};
 
 	private:
-		static BYTE Screen[144][160][3];
-		static int ScanlineCounter;
 		enum Status
 		{
 			HBLANK, VBLANK, OAM, TRANSFER
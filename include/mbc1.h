@@ -16,7 +16,8 @@
 class Mbc1
 {
 	public:
-		// TODO
+		static void Map();
+		static void Write(WORD address, BYTE data);
 };
 
 #endif
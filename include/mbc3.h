@@ -0,0 +1,41 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: mbc3.h
+*/
+
+#ifndef MBC3_H
+#define MBC3_H
+
+// includes
+#include "typedefs.h"
+
+// definitions
+#define MBC3_CLOCK_REGISTER_START 0x08
+#define MBC3_CLOCK_REGISTER_END 0x0C
+// the clock counts seconds of emulated time
+#define MBC3_CLOCK_CYCLES_PER_SECOND 4194304
+// the day counter's high register (bit 0 is bit 8 of the day, bit 6 stops the clock, bit 7 is the day carry)
+#define MBC3_CLOCK_DAY_HIGH 4
+#define MBC3_CLOCK_HALT 0x40
+#define MBC3_CLOCK_DAY_CARRY 0x80
+
+// mbc3 class
+//
+// The real time clock isn't ticked: the seconds since the registers were
+// last brought up to date are worked out from the machine's clock when the
+// game latches or writes them, so the clock runs with emulated time (and
+// saves, rewinds and movies replay it exactly).
+class Mbc3
+{
+	public:
+		static void Map();
+		static void Write(WORD address, BYTE data);
+		static BYTE ReadRam(WORD address);
+		static void WriteRam(WORD address, BYTE data);
+
+	private:
+		static void UpdateClock();
+};
+
+#endif
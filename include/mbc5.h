@@ -0,0 +1,23 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: mbc5.h
+*/
+
+#ifndef MBC5_H
+#define MBC5_H
+
+// includes
+#include "typedefs.h"
+
+// definitions
+
+// mbc5 class
+class Mbc5
+{
+	public:
+		static void Map();
+		static void Write(WORD address, BYTE data);
+};
+
+#endif
@@ -8,17 +8,19 @@
 #define MEMORY_H
 
 // includes
-#include "typedefs.h" 
+#include <cstddef>
+#include "cpu.h"
+#include "typedefs.h"
 
 // definitions
 #define PROTECTED_MEM_START_ADDRESS 0xFEA0
 #define PROTECTED_MEM_END_ADDRESS 0xFEFF
 #define UNMAPPED_MEM_START_ADDRESS 0xFF4C
 #define UNMAPPED_MEM_END_ADDRESS 0xFF7F
-#define ECHO_RAM_1_START_ADDRESS 0xC000
-#define ECHO_RAM_1_END_ADDRESS 0xDE00
-#define ECHO_RAM_2_START_ADDRESS 0xE000
-#define ECHO_RAM_2_END_ADDRESS 0xFE00
+#define ECHO_RAM_START_ADDRESS 0xE000
+#define ECHO_RAM_END_ADDRESS 0xFDFF
+#define ECHO_RAM_OFFSET 0x2000
+#define JOYPAD_ADDRESS 0xFF00
 #define SERIAL_PORT_ADDRESS 0xFF02
 #define INT_ENABLED_ADDRESS 0xFFFF
 #define INT_REQUEST_ADDRESS 0xFF0F
@@ -39,8 +41,26 @@
 #define SPRITE_PALETTE_1_ADDRESS 0xFF48
 #define SPRITE_PALETTE_2_ADDRESS 0xFF49
 #define DMA_ADDRESS 0xFF46
+#define DMA_CYCLES 640
+#define TILE_DATA_START_ADDRESS 0x8000
+#define TILE_DATA_END_ADDRESS 0x97FF
+#define MEMORY_PAGE_SHIFT 8
+#define MEMORY_PAGE_MASK 0xFF
+#define MEMORY_PAGE_COUNT 0x100
+#define IO_PAGE 0xFF
 
 // memory class
+//
+// Memory is mapped in 256 byte pages. A page with a pointer in the page table
+// is plain memory and is read or written straight through it; a page without
+// one (the I/O registers, OAM) goes through the handlers.
+//
+// Every page written is stamped with the current write epoch. A caller that
+// keeps something in sync with memory (an incrementally updated state) takes
+// a new epoch when it syncs, and a page is dirty for it if it was stamped
+// after that, so any number of callers can track the pages that changed
+// without clearing anything. The I/O page (registers and HRAM) is written
+// directly by the hardware, so it is always dirty.
 class Memory 
 {
 	public:
@@ -50,9 +70,101 @@ class Memory
 		static void Write(WORD address, BYTE data);
 		static void Push(WORD data);
 		static WORD Pop();
+		static void FinishDma();
+		static BYTE *Get();
+		static void MapRead(WORD address, int size, const BYTE *data);
+		static void MapWrite(WORD address, int size, BYTE *data);
+		static void MapCode(WORD address, int size, const Cpu::Decoded *code);
+		static const Cpu::Decoded *ReadCode(WORD address);
+		static bool IsPageDirty(int page, unsigned int since);
+		static unsigned int NextEpoch();
+		static void MarkAllPagesDirty();
 
 	public:
-		static BYTE Mem[0x10000];
+		// the memory state of a single machine (owned by GameBoy)
+		struct State
+		{
+			BYTE Mem[0x10000];
+			// the page tables (rebuilt by Map, so must not be copied between machines)
+			const BYTE *ReadPage[MEMORY_PAGE_COUNT];
+			BYTE *WritePage[MEMORY_PAGE_COUNT];
+			// the pre-decoded code of each page (NULL decodes it from memory)
+			const Cpu::Decoded *CodePage[MEMORY_PAGE_COUNT];
+			// bumped every time pages are mapped
+			unsigned int Generation;
+			// the current write epoch, and the epoch each page was last written in
+			unsigned int Epoch;
+			unsigned int PageEpoch[MEMORY_PAGE_COUNT];
+		};
+
+	public:
+		static void Bind(State &state);
+		static void Map(State &state);
+
+	private:
+		static BYTE ReadIo(WORD address);
+		static void WriteIo(WORD address, BYTE data);
+
+	private:
+		static thread_local State *current;
 };
 
+// read memory
+inline BYTE Memory::ReadByte(WORD address)
+{
+	const BYTE *page = current->ReadPage[address >> MEMORY_PAGE_SHIFT];
+
+	// plain memory is read straight from the page
+	if (page != NULL) return page[address & MEMORY_PAGE_MASK];
+
+	return ReadIo(address);
+}
+
+// read word
+inline WORD Memory::ReadWord(WORD address)
+{
+	return ((ReadByte(address + 1) << 8) | ReadByte(address));
+}
+
+// read the pre-decoded instruction at an address (NULL if the page isn't decoded)
+inline const Cpu::Decoded *Memory::ReadCode(WORD address)
+{
+	const Cpu::Decoded *page = current->CodePage[address >> MEMORY_PAGE_SHIFT];
+
+	return (page != NULL) ? &page[address & MEMORY_PAGE_MASK] : NULL;
+}
+
+// has a page been written since an epoch (one returned by NextEpoch)?
+inline bool Memory::IsPageDirty(int page, unsigned int since)
+{
+	const unsigned int *written = current->PageEpoch;
+
+	// work ram is also written through its echo
+	if (page >= ((ECHO_RAM_START_ADDRESS - ECHO_RAM_OFFSET) >> MEMORY_PAGE_SHIFT) && page <= ((ECHO_RAM_END_ADDRESS - ECHO_RAM_OFFSET) >> MEMORY_PAGE_SHIFT))
+	{
+		if (written[page + (ECHO_RAM_OFFSET >> MEMORY_PAGE_SHIFT)] > since) return true;
+	}
+
+	return (page == IO_PAGE) || (written[page] > since);
+}
+
+// write memory
+inline void Memory::Write(WORD address, BYTE data)
+{
+	int index = (address >> MEMORY_PAGE_SHIFT);
+	BYTE *page = current->WritePage[index];
+
+	// the page has changed
+	current->PageEpoch[index] = current->Epoch;
+
+	// plain memory is written straight to the page
+	if (page != NULL)
+	{
+		page[address & MEMORY_PAGE_MASK] = data;
+		return;
+	}
+
+	WriteIo(address, data);
+}
+
 #endif
@@ -0,0 +1,63 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: movie.h
+*/
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+// includes
+#include <cstddef>
+#include <vector>
+#include "joypad.h"
+#include "typedefs.h"
+
+// definitions
+#define MOVIE_MAGIC "CBMV"
+#define MOVIE_VERSION 1
+
+// movie class (records the joypad input of the bound machine, and plays it back)
+//
+// A movie is the hash of the machine's state when recording started, every
+// press and release at the cycle it happened, and the hash of the state and
+// the cycle when recording stopped. Emulation is deterministic, so playing
+// the input back from the same start state has to reach the same end state
+// at the same cycle: a movie that doesn't is out of sync, which makes movies
+// regression tests. The inputs are stored as the cycles since the one before
+// (7 bits a byte) and a byte for the button, so a movie is a few bytes per
+// press. The start state itself isn't stored, playback checks it by hash.
+class Movie
+{
+	public:
+		Movie();
+		void StartRecording();
+		void Record(const Joypad::Input &input);
+		bool StopRecording(const char *fileName);
+		bool StartPlayback(const char *fileName);
+		int Play(int cycles);
+		bool StopPlayback();
+		bool IsRecording() const;
+		bool IsPlaying() const;
+		static unsigned long long Hash();
+
+	private:
+		enum Modes
+		{
+			IDLE, RECORDING, PLAYING
+		};
+
+	private:
+		int Mode;
+		// the clock and hash of the state the movie starts from
+		unsigned long long StartClock;
+		unsigned long long StartHash;
+		// the hash of the state the movie ends at, and its length in cycles
+		unsigned long long EndHash;
+		unsigned long long Length;
+		// the inputs (timestamped from the start of the movie), and the next to play
+		std::vector<Joypad::Input> Inputs;
+		size_t Next;
+};
+
+#endif
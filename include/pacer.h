@@ -0,0 +1,58 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: pacer.h
+*/
+
+#ifndef PACER_H
+#define PACER_H
+
+// includes
+#include <atomic>
+#include <chrono>
+#include "typedefs.h"
+
+// definitions
+#define PACER_REPORT_MILLISECONDS 500
+#define PACER_MAX_FRAMES_BEHIND 4
+
+// pacer class (keeps emulated time in step with the wall clock, and measures the speed achieved)
+//
+// The pacer counts the cycles ran since it was started and sleeps until the
+// wall clock has caught up with them, so the speed is exact whatever amount
+// a caller runs at a time (in real time, the lcd's frames come out at its
+// 59.73 Hz). A caller that falls too far behind starts again from now rather
+// than running fast to catch up.
+class Pacer
+{
+	public:
+		enum Modes
+		{
+			REAL_TIME, UNCAPPED, MULTIPLIER
+		};
+
+	public:
+		Pacer();
+		void SetMode(int mode, double multiplier = 1.0);
+		int GetMode() const;
+		double GetMultiplier() const;
+		void Restart();
+		void Pace(int cycles);
+		double GetSpeed() const;
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		int Mode;
+		double Multiplier;
+		// when the pacer was started, and the cycles ran since
+		Clock::time_point Start;
+		unsigned long long Cycles;
+		// the current report interval
+		Clock::time_point ReportStart;
+		unsigned long long ReportCycles;
+		// the speed over the last report interval (1.0 is the real hardware, read from any thread)
+		std::atomic<double> Speed;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: rewind.h
+*/
+
+#ifndef REWIND_H
+#define REWIND_H
+
+// includes
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "typedefs.h"
+
+// definitions
+#define REWIND_DEFAULT_BUDGET (64 * 1024 * 1024)
+#define REWIND_DEFAULT_KEYFRAME_INTERVAL 60
+
+// rewind class (a ring buffer of save states of the bound machine, to step back through)
+//
+// Every keyframe interval a full state is kept (a keyframe), and the states
+// in between are kept as the difference from it: the states are XORed with
+// the keyframe, so unchanged bytes become zero, and the result is stored as
+// runs of zeros and the bytes between them. Everything is encoded the same
+// way (a keyframe against nothing), so the zeros in a keyframe are squeezed
+// out too. Once the buffer is over its budget the oldest keyframe and its
+// deltas are dropped.
+class Rewind
+{
+	public:
+		Rewind(size_t budget = REWIND_DEFAULT_BUDGET, int keyframeInterval = REWIND_DEFAULT_KEYFRAME_INTERVAL);
+		void Push();
+		bool Pop();
+		void Clear();
+		int GetCount() const;
+		size_t GetSize() const;
+
+	private:
+		// a saved state, encoded
+		struct Snapshot
+		{
+			bool Keyframe;
+			std::vector<BYTE> Data;
+		};
+
+		static void Encode(const std::vector<BYTE> &state, const std::vector<BYTE> *base, std::vector<BYTE> &encoded);
+		static void Decode(const std::vector<BYTE> &encoded, const std::vector<BYTE> *base, std::vector<BYTE> &state);
+		void DecodeKeyframe();
+
+	private:
+		size_t Budget;
+		int KeyframeInterval;
+		std::deque<Snapshot> Snapshots;
+		// the bytes held by the snapshots
+		size_t Size;
+		// the newest keyframe, decoded (the deltas after it are against it)
+		std::vector<BYTE> Keyframe;
+		// the number of deltas after the newest keyframe
+		int Deltas;
+		// the last state pushed or popped (updated in place on each push, with the memory written since the epoch)
+		std::vector<BYTE> State;
+		unsigned int Epoch;
+		// scratch buffer (kept so pushing doesn't allocate)
+		std::vector<BYTE> Encoded;
+};
+
+#endif
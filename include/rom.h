@@ -8,19 +8,100 @@
 #define ROM_H
 
 // includes
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cpu.h"
 #include "typedefs.h"
 
-// rom class
+// definitions
+#define CARTRIDGE_TYPE_ADDRESS 0x0147
+#define ROM_SIZE_ADDRESS 0x0148
+#define RAM_SIZE_ADDRESS 0x0149
+#define ROM_BANK_SIZE 0x4000
+#define RAM_BANK_SIZE 0x2000
+#define SWITCHABLE_ROM_ADDRESS 0x4000
+#define CARTRIDGE_RAM_ADDRESS 0xA000
+#define MBC_NONE 0
+#define MBC_1 1
+#define MBC_3 3
+#define MBC_5 5
+
+// rom class (the cartridge)
+//
+// Rom images are mapped read-only from the file (mmap) and shared by every
+// machine in the process, along with their decoded code. A bank is decoded the
+// first time any machine maps it, so only the banks that get mapped are read.
+// Bank switching never copies: the banks are mapped into the page tables
+// straight from the image and the cartridge ram.
 class Rom
 {
 	public:
 		static bool Load(const char *fileName);
-		static void Reload();
+		static void Reset();
 		static void Close();
+		static void Map();
+		static void MapRom(WORD address, int bank);
+		static void MapRam(int bank);
+		static void Write(WORD address, BYTE data);
+		static BYTE ReadRam(WORD address);
+		static void WriteRam(WORD address, BYTE data);
 
 	public:
-		static BYTE cartridgeMem[0x200000];
-		static const char *currentRomFileName;		
+		// a read-only rom image, shared by every machine that loads the same file
+		struct Image
+		{
+			Image();
+			~Image();
+			const Cpu::Decoded *GetCode(int bank) const;
+			std::string FileName;
+			const BYTE *Data;
+			size_t Size;
+			// the file mapping (or a padded copy, if the file can't be mapped as is)
+			void *Mapping;
+			size_t MappingSize;
+			std::vector<BYTE> Buffer;
+			// the decoded code of each bank (empty until the bank is first mapped)
+			mutable std::vector<std::unique_ptr<Cpu::Decoded[]> > Code;
+			mutable std::mutex CodeLock;
+		};
+
+		// the rom state of a single machine (owned by GameBoy)
+		struct State
+		{
+			std::shared_ptr<const Image> CurrentImage;
+			// the cartridge
+			int Mbc;
+			int RomBankCount;
+			int RamBankCount;
+			std::vector<BYTE> Ram;
+			// the mapper registers
+			bool RamEnabled;
+			int RomBankLow;
+			int RomBankHigh;
+			int RamBank;
+			int BankingMode;
+			// the rom banks mapped at 0x0000 and 0x4000
+			int MappedBanks[2];
+			// the mbc3 real time clock (the registers are current as of the ClockBase cycle)
+			BYTE ClockLatch;
+			BYTE Clock[5];
+			BYTE LatchedClock[5];
+			unsigned long long ClockBase;
+		};
+
+		// for getting members which should be indirectly-publicly accessible
+		class Get
+		{
+			public:
+				static const char *FileName();
+		};
+
+	private:
+		static std::shared_ptr<const Image> LoadImage(const char *fileName);
+		static int GetMbc(BYTE cartridgeType);
+		static int GetRamSize(BYTE ramSize);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,39 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: saveState.h
+*/
+
+#ifndef SAVE_STATE_H
+#define SAVE_STATE_H
+
+// includes
+#include <cstddef>
+#include <vector>
+#include "typedefs.h"
+
+// definitions
+#define SAVE_STATE_MAGIC "CBOY"
+#define SAVE_STATE_VERSION 1
+
+// save state class (snapshots the complete state of the bound machine)
+//
+// A state is the magic, a version and a chunk per subsystem. A chunk is a
+// four character id, its size and the subsystem's fields in host byte order.
+// A state can also be updated in place, rewriting only the memory pages
+// written since it was last saved or updated (see Memory's write epochs).
+// A state only loads into a machine running the same rom, and loading checks
+// every chunk before any of it is applied, so a bad state leaves the machine
+// untouched. Caches (decoded tiles, idle loop detection, compiled code) are
+// rebuilt rather than saved.
+class SaveState
+{
+	public:
+		static void Save(std::vector<BYTE> &data);
+		static void Update(std::vector<BYTE> &data, unsigned int &epoch);
+		static bool Load(const BYTE *data, size_t size);
+		static bool SaveToFile(const char *fileName);
+		static bool LoadFromFile(const char *fileName);
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: scheduler.h
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// includes
+#include "typedefs.h"
+
+// definitions
+#define SCHEDULER_NEVER 0xFFFFFFFFFFFFFFFFULL
+
+// scheduler class (runs the hardware events of a machine at their cycle)
+//
+// Each event is scheduled at an absolute cycle timestamp and kept in a small
+// min-heap, so the cpu only compares the clock against the earliest one after
+// each instruction. An event is scheduled at most once; scheduling it again
+// moves it.
+class Scheduler
+{
+	public:
+		enum IDS
+		{
+			TIMER, LCD, DMA, JOYPAD, EVENT_COUNT
+		};
+
+	public:
+		// the scheduler state of a single machine (owned by GameBoy, all zero is empty)
+		struct State
+		{
+			// the number of cycles the machine has ran
+			unsigned long long Clock;
+			// the timestamp of the earliest event
+			unsigned long long NextEvent;
+			// the scheduled events, as a min-heap ordered by timestamp
+			int Heap[EVENT_COUNT];
+			int Count;
+			// the position of each event in the heap (plus one, zero if it isn't scheduled)
+			int Position[EVENT_COUNT];
+			unsigned long long Timestamp[EVENT_COUNT];
+		};
+
+	public:
+		static void Init();
+		static unsigned long long Now();
+		static void Schedule(int event, unsigned long long timestamp);
+		static void Cancel(int event);
+		static bool IsScheduled(int event);
+		static void Advance(State &state, int cycles);
+
+	private:
+		static void Dispatch(State &state);
+		static void Remove(State &state, int event);
+		static void SiftUp(State &state, int index);
+		static void SiftDown(State &state, int index);
+		static void Swap(State &state, int a, int b);
+};
+
+// advance the clock, running any events that are due
+inline void Scheduler::Advance(State &state, int cycles)
+{
+	state.Clock += cycles;
+
+	if (state.Clock >= state.NextEvent)
+	{
+		Dispatch(state);
+	}
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: snapshot.h
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// includes
+#include <memory>
+#include <vector>
+#include "cpu.h"
+#include "interrupt.h"
+#include "joypad.h"
+#include "lcd.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "typedefs.h"
+
+// snapshot class (a copy of the bound machine's state, kept in memory to put the machine back to)
+//
+// Unlike a save state, a snapshot is a plain copy of each subsystem's state:
+// nothing is encoded or checked, so it is cheap enough to take and restore
+// every frame (as run-ahead does). A snapshot only restores into the machine
+// it was taken from, while it runs the same rom. The lcd's frame count is
+// left as it is, as it counts the screens the host has been given.
+class Snapshot
+{
+	public:
+		Snapshot();
+		void Take();
+		void Restore();
+
+	private:
+		// the copied state (on the heap, it's too big for the stack)
+		struct Data
+		{
+			Cpu::State CpuState;
+			BYTE Mem[0x10000];
+			Timer::State TimerState;
+			Joypad::State JoypadState;
+			Lcd::State LcdState;
+			Interrupt::State InterruptState;
+			Scheduler::State SchedulerState;
+			bool BiosMapped;
+			// the cartridge (mapper registers, ram and clock)
+			bool RamEnabled;
+			int RomBankLow;
+			int RomBankHigh;
+			int RamBank;
+			int BankingMode;
+			BYTE ClockLatch;
+			BYTE Clock[5];
+			BYTE LatchedClock[5];
+			unsigned long long ClockBase;
+			std::vector<BYTE> Ram;
+		};
+
+	private:
+		std::unique_ptr<Data> Saved;
+		bool Taken;
+};
+
+#endif
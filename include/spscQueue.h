@@ -0,0 +1,56 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: spscQueue.h
+*/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+// includes
+#include <atomic>
+
+// spsc queue class (a fixed size, lock-free queue between one producer thread and one consumer thread)
+//
+// The producer only writes Head and the consumer only writes Tail, so each
+// side publishes with a release store the other side reads with an acquire
+// load. One slot is always left empty to tell a full queue from an empty one.
+template <typename T, int Size>
+class SpscQueue
+{
+	public:
+		SpscQueue() : Head(0), Tail(0) {}
+
+		// add an item (producer only), returns false if the queue is full
+		bool Push(const T &item)
+		{
+			int head = Head.load(std::memory_order_relaxed);
+			int next = (head + 1) % Size;
+
+			if (next == Tail.load(std::memory_order_acquire)) return false;
+
+			Items[head] = item;
+			Head.store(next, std::memory_order_release);
+			return true;
+		}
+
+		// take the oldest item (consumer only), returns false if the queue is empty
+		bool Pop(T &item)
+		{
+			int tail = Tail.load(std::memory_order_relaxed);
+
+			if (tail == Head.load(std::memory_order_acquire)) return false;
+
+			item = Items[tail];
+			Tail.store((tail + 1) % Size, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// kept on separate cache lines, as each is written by a different thread
+		alignas(64) std::atomic<int> Head;
+		alignas(64) std::atomic<int> Tail;
+		T Items[Size];
+};
+
+#endif
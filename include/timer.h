@@ -16,18 +16,36 @@ class Timer
 	public:
 		static void Init();
 		static void Reset();
-		static void Update(int clockCycles);
 		static BYTE GetClockFrequency();
 		static void SetClockFrequency();
 		static bool IsEnabled();
+		static BYTE GetDivider();
 		static void ResetDivider();
+		static BYTE GetTima();
+		static void SetTima(BYTE val);
+		static void SetControl(BYTE val);
+		static void Overflow(unsigned long long timestamp);
 
 	private:
-		static void UpdateDivider(int clockCycles);
+		static void Sync();
+		static void ScheduleOverflow();
 
-	private:
-		static int TimerCounter;
-		static int DividerCounter;
+	public:
+		// the timer state of a single machine (owned by GameBoy)
+		//
+		// DIV and TIMA aren't counted, they are worked out from the scheduler's
+		// clock when read. Only the next TIMA overflow is scheduled.
+		struct State
+		{
+			// the cycle DIV was last reset at
+			unsigned long long DividerBase;
+			// the cycle TIMA was last set or counted from
+			unsigned long long TimaBase;
+			// the value of TIMA at TimaBase
+			BYTE Tima;
+			// cycles between TIMA increments (0 while the timer is stopped)
+			int Period;
+		};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: tripleBuffer.h
+*/
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// includes
+#include <atomic>
+
+// triple buffer class (hands the newest value from one producer thread to one consumer thread, lock-free)
+//
+// The producer fills the back buffer and swaps it with the middle one, the
+// consumer swaps its front buffer with the middle one when a new value has
+// been published. Neither side ever waits, and the consumer always gets the
+// newest value (older unread ones are dropped).
+template <typename T>
+class TripleBuffer
+{
+	public:
+		TripleBuffer() : Middle(1), Back(2), Front(0) {}
+
+		// the buffer to fill (producer only)
+		T &GetBack()
+		{
+			return Buffers[Back];
+		}
+
+		// publish the back buffer (producer only)
+		void Publish()
+		{
+			Back = (Middle.exchange(Back | FRESH, std::memory_order_acq_rel) & INDEX);
+		}
+
+		// take the newest published buffer (consumer only), returns false if nothing new was published
+		bool Acquire()
+		{
+			if ((Middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+
+			Front = (Middle.exchange(Front, std::memory_order_acq_rel) & INDEX);
+			return true;
+		}
+
+		// the buffer last acquired (consumer only)
+		const T &GetFront() const
+		{
+			return Buffers[Front];
+		}
+
+	private:
+		// the middle buffer's index, with a flag set while it holds an unread value
+		enum Flags
+		{
+			INDEX = 3, FRESH = 4
+		};
+
+		T Buffers[3];
+		std::atomic<int> Middle;
+		int Back;
+		int Front;
+};
+
+#endif
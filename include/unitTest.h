@@ -13,6 +13,14 @@
 // unit test class
 class UnitTest 
 {
+	public:
+		// for getting members which should be indirectly-publicly accessible
+		class Get
+		{
+			public:
+				static int Failures();
+		};
+
 	public:
 		class Test
 		{
@@ -30,6 +38,9 @@ class UnitTest
 						static void And();
 						static void Or();
 						static void Xor();
+						static void RotateRight();
+						static void LoadHigh();
+						static void PendingFlags();
 				};
 
 				class SixteenBit
@@ -37,6 +48,38 @@ class UnitTest
 					public:
 						static void Add();
 				};
+
+				class Cartridge
+				{
+					public:
+						static void Mbc1();
+						static void Mbc3();
+						static void Mbc5();
+						static void Reload();
+						static void RealTimeClock();
+				};
+
+				class Timing
+				{
+					public:
+						static void Divider();
+						static void Counter();
+				};
+
+				class Machine
+				{
+					public:
+						static void SaveStates();
+						static void RewindStates();
+						static void MovieSync();
+						static void Recompiler();
+				};
+
+				class Screen
+				{
+					public:
+						static void ConvertLine();
+				};
 		};
 };
 
@@ -7,6 +7,7 @@
 // includes
 #include "include/bit.h"
 #include "include/cpu.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
 #include "include/log.h"
 #include "include/memory.h"
@@ -23,10 +24,21 @@ Interrupt::Type Interrupt::InterruptList[5] = {
 	Interrupt::VBlank, Interrupt::Lcd, Interrupt::Timer, Interrupt::Serial, Interrupt::Joypad
 };
 
-// master switch is false initially
-bool Interrupt::MasterSwitch = false;
-// was the cpu in halt state
-static bool wasHalted = false;
+// # Getters # //
+
+// master switch
+bool Interrupt::Get::MasterSwitch()
+{
+	return GameBoy::Current()->InterruptState.MasterSwitch;
+}
+
+// # Setters # //
+
+// master switch
+void Interrupt::Set::MasterSwitch(bool val)
+{
+	GameBoy::Current()->InterruptState.MasterSwitch = val;
+}
 
 // request interrupt
 void Interrupt::Request(int interruptId)
@@ -39,6 +51,7 @@ void Interrupt::Request(int interruptId)
 // should we service the interrupt?
 int Interrupt::ShouldService()
 {
+	State &state = GameBoy::Current()->InterruptState;
 	BYTE requestedInterrupt = Memory::ReadByte(INT_REQUEST_ADDRESS);
 	BYTE interruptsEnabled = Memory::ReadByte(INT_ENABLED_ADDRESS);
 
@@ -48,10 +61,10 @@ int Interrupt::ShouldService()
 		{
 			if (Bit::Get(requestedInterrupt, i) && Bit::Get(interruptsEnabled, i))
 			{
-				wasHalted = Cpu::Get::Halt();
+				state.WasHalted = Cpu::Get::Halt();
 				Cpu::Set::Halt(false);
 
-				if (MasterSwitch) return i; else return -1;
+				if (state.MasterSwitch) return i; else return -1;
 			}
 		}
 	}
@@ -62,12 +75,13 @@ int Interrupt::ShouldService()
 // service interrupt
 void Interrupt::Service()
 {
+	State &state = GameBoy::Current()->InterruptState;
 	int interruptId = ShouldService();
 
 	if (interruptId >= 0)
 	{
 		// interrupts take at least 20 cycles (+ 4 if in halt)
-		Cpu::Cycles += (wasHalted) ? 24 : 20;
+		Cpu::Set::Cycles((state.WasHalted) ? 24 : 20);
 		// reset the requested interrupt
 		BYTE requestedInterrupt = Memory::ReadByte(INT_REQUEST_ADDRESS);
 		Bit::Reset(requestedInterrupt, interruptId);
@@ -76,7 +90,7 @@ void Interrupt::Service()
 		Memory::Push(Cpu::Get::PC());
 		// execute the interrupt
 		Cpu::Set::PC(InterruptList[interruptId].address);
-		wasHalted = false;
-		MasterSwitch = false;
+		state.WasHalted = false;
+		state.MasterSwitch = false;
 	}
 }
@@ -0,0 +1,120 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: joypad.cpp
+*/
+
+// includes
+#include <string.h>
+#include "include/cpu.h"
+#include "include/gameboy.h"
+#include "include/interrupt.h"
+#include "include/joypad.h"
+#include "include/memory.h"
+#include "include/scheduler.h"
+
+// definitions
+#define SELECT_DIRECTIONS 0x10
+#define SELECT_BUTTONS 0x20
+
+// work out the P1 lines (low while a button of a selected group is held)
+BYTE Joypad::GetLines(BYTE select, BYTE held)
+{
+	BYTE lines = 0x0F;
+
+	// the directions are on P14, the buttons on P15 (both can be selected at once)
+	if (!(select & SELECT_DIRECTIONS)) lines &= ~(held & 0x0F);
+	if (!(select & SELECT_BUTTONS)) lines &= ~(held >> 4);
+
+	return lines;
+}
+
+// change the group select or the buttons held (a line going low requests the interrupt)
+void Joypad::Change(BYTE select, BYTE held)
+{
+	State &state = GameBoy::Current()->JoypadState;
+	BYTE *Mem = Memory::Get();
+	BYTE before = GetLines(Mem[JOYPAD_ADDRESS], state.Held);
+	BYTE after = GetLines(select, held);
+
+	Mem[JOYPAD_ADDRESS] = (0xC0 | (select & 0x30) | 0x0F);
+	state.Held = held;
+
+	if (before & ~after)
+	{
+		Interrupt::Request(Interrupt::JOYPAD);
+		Cpu::Set::Stop(false);
+	}
+}
+
+// init the joypad (nothing held or waiting, and both groups selected, as the bios leaves them)
+void Joypad::Init()
+{
+	State &state = GameBoy::Current()->JoypadState;
+
+	state.Held = 0;
+	state.PendingCount = 0;
+	Scheduler::Cancel(Scheduler::JOYPAD);
+	Memory::Get()[JOYPAD_ADDRESS] = 0xCF;
+}
+
+// queue a press or release (in order, and no earlier than now), returns false if too many are waiting
+bool Joypad::Queue(Input input)
+{
+	State &state = GameBoy::Current()->JoypadState;
+
+	if (state.PendingCount >= JOYPAD_MAX_PENDING || input.Button < 0 || input.Button >= BUTTON_COUNT) return false;
+
+	// the past can't be changed, and inputs are applied in the order they're queued
+	if (input.Timestamp < Scheduler::Now()) input.Timestamp = Scheduler::Now();
+	if (state.PendingCount > 0 && input.Timestamp < state.Pending[state.PendingCount - 1].Timestamp)
+	{
+		input.Timestamp = state.Pending[state.PendingCount - 1].Timestamp;
+	}
+
+	state.Pending[state.PendingCount] = input;
+	state.PendingCount += 1;
+
+	// the first input waiting is the next event
+	if (state.PendingCount == 1) Scheduler::Schedule(Scheduler::JOYPAD, input.Timestamp);
+
+	return true;
+}
+
+// read P1 (the group select bits and the lines)
+BYTE Joypad::Read()
+{
+	BYTE select = Memory::Get()[JOYPAD_ADDRESS];
+
+	return (0xC0 | (select & 0x30) | GetLines(select, GameBoy::Current()->JoypadState.Held));
+}
+
+// write P1 (only the group select bits can be written)
+void Joypad::Write(BYTE data)
+{
+	Change(data, GameBoy::Current()->JoypadState.Held);
+}
+
+// apply the inputs that are due
+void Joypad::Event(unsigned long long timestamp)
+{
+	State &state = GameBoy::Current()->JoypadState;
+	int applied = 0;
+
+	while (applied < state.PendingCount && state.Pending[applied].Timestamp <= timestamp)
+	{
+		const Input &input = state.Pending[applied];
+		BYTE held = state.Held;
+
+		if (input.Pressed) held |= (1 << input.Button); else held &= ~(1 << input.Button);
+
+		Change(Memory::Get()[JOYPAD_ADDRESS], held);
+		applied++;
+	}
+
+	// the rest wait for their cycle
+	state.PendingCount -= applied;
+	memmove(state.Pending, &state.Pending[applied], state.PendingCount * sizeof(Input));
+
+	if (state.PendingCount > 0) Scheduler::Schedule(Scheduler::JOYPAD, state.Pending[0].Timestamp);
+}
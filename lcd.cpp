@@ -5,55 +5,81 @@
 */
 
 // includes
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_opengl.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// the avx2 conversion is built whatever the target, and only used when the cpu has avx2
+#define LCD_USE_AVX2
+#endif
 #include "include/bit.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
 #include "include/lcd.h"
 #include "include/log.h"
 #include "include/memory.h"
+#include "include/scheduler.h"
 
 // definitions
 #define LCD_CLOCK_CYCLES 456
-// vars
-int Lcd::ScanlineCounter = LCD_CLOCK_CYCLES;
-BYTE Lcd::Screen[144][160][3] = {};
-static GLuint texture;
+#define OAM_CYCLES 80
+#define TRANSFER_CYCLES 172
+#define HBLANK_CYCLES (LCD_CLOCK_CYCLES - OAM_CYCLES - TRANSFER_CYCLES)
+#define VBLANK_SCANLINE 144
+#define LAST_SCANLINE 153
+
+// the rgba value of each shade (white, light grey, dark grey and black), as stored in memory on a little endian host
+static const unsigned int SHADES[4] = {0xFF0FBC9B, 0xFF0FAC8B, 0xFF306230, 0xFF0F380F};
+
+// # Getters # //
+
+// screen
+BYTE * Lcd::Get::Screen()
+{
+	return &GameBoy::Current()->LcdState.Screen[0][0][0];
+}
+
+// frame count
+unsigned int Lcd::Get::FrameCount()
+{
+	return GameBoy::Current()->LcdState.FrameCount;
+}
+
+// # Setters # //
+
+// the clock to draw scanlines from (emulation carries on the same, only the screen is left as it was)
+void Lcd::Set::DrawFrom(unsigned long long clock)
+{
+	GameBoy::Current()->LcdState.DrawFrom = clock;
+}
 
 // init the lcd
 void Lcd::Init()
 {
 	// set the screen to white
 	Reset();
-
-	// setup opengl for the game window
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glGenTextures(1, &texture); // create texture
-	glBindTexture(GL_TEXTURE_2D, texture); // specify that the texture is 2D
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glEnable(GL_TEXTURE_2D);
-
-	// update the texture
-	UpdateTexture();
 }
 
 // reset the lcd
 void Lcd::Reset()
 {
+	State &state = GameBoy::Current()->LcdState;
+
+	// decode every tile again
+	InvalidateTiles();
+
 	// set the screen to white
 	for (int y = 0; y < 144; y++)
 	{
 		for (int x = 0; x < 160; x++)
 		{
-			Screen[y][x][0] = 155;
-			Screen[y][x][1] = 188;
-			Screen[y][x][2] = 15;
+			memcpy(state.Screen[y][x], &SHADES[0], 4);
 		}
 	}
 
-	ScanlineCounter = LCD_CLOCK_CYCLES;
+	state.FrameCount += 1;
+
+	// restart from the first scanline
+	if (IsLCDEnabled()) TurnOn(); else TurnOff();
 }
 
 // check if the LCD is enabled
@@ -62,225 +88,284 @@ bool Lcd::IsLCDEnabled()
 	return Bit::Get(Memory::ReadByte(LCDC_ADDRESS), 7);
 }
 
-// set the LCD status
-int Lcd::SetLCDStatus()
+// turn the lcd on (starts searching oam on the first scanline)
+void Lcd::TurnOn()
 {
-	// get the current mode of the LCD
-	BYTE stat = Memory::ReadByte(STAT_ADDRESS);
-	// get the current scanline value
-	BYTE currentScanline = Memory::ReadByte(LY_ADDRESS);
-	// should we request an interrupt?
-	bool requestInterrupt = false;
-	// the current LCD mode
-	BYTE currentMode = (stat & 0x3);
-	// the next LCD mode
-	BYTE nextMode = 0;
-	// LCD mode ranges
-	int modeRange[4] = {265, 144, LCD_CLOCK_CYCLES - 80, LCD_CLOCK_CYCLES - 80 - 172};
-
-	// set the mode to 1 if the LCD is off
-	if (!IsLCDEnabled())
+	Memory::Get()[LY_ADDRESS] = 0x00;
+	SetMode(OAM);
+	CheckCoincidence();
+	Scheduler::Schedule(Scheduler::LCD, Scheduler::Now() + OAM_CYCLES);
+}
+
+// turn the lcd off (the scanline and mode are held at 0)
+void Lcd::TurnOff()
+{
+	BYTE *Mem = Memory::Get();
+
+	// reset the scanline
+	Mem[LY_ADDRESS] = 0x00;
+	// set mode 0 and clear the coincidence flag
+	Mem[STAT_ADDRESS] = ((Mem[STAT_ADDRESS] & 0xF8) | 0x80);
+	Scheduler::Cancel(Scheduler::LCD);
+}
+
+// set the lcd mode
+void Lcd::SetMode(BYTE mode)
+{
+	BYTE *Mem = Memory::Get();
+	BYTE stat = ((Mem[STAT_ADDRESS] & 0xFC) | mode | 0x80);
+
+	Mem[STAT_ADDRESS] = stat;
+
+	// request the hblank, vblank or oam interrupt, if enabled (stat bits 3, 4 and 5)
+	if (mode != TRANSFER && Bit::Get(stat, 3 + mode))
 	{
-		// reset the scanline counter
-		ScanlineCounter = LCD_CLOCK_CYCLES;
-		// reset the scanline
-		Memory::Mem[LY_ADDRESS] = 0x00;
-		// set mode 1
-		Bit::Set(stat, 0);
-		Bit::Reset(stat, 1);
-		// 
-		stat &= 0xF8;
-		// write the mode to memory
-		Memory::Write(STAT_ADDRESS, stat);
-		return 0;
+		Interrupt::Request(Interrupt::IDS::LCD);
 	}
+}
 
-	// ## handle modes ##
+// handle the coincidence flag
+void Lcd::CheckCoincidence()
+{
+	BYTE *Mem = Memory::Get();
+	BYTE stat = Mem[STAT_ADDRESS];
 
-	// vblank
-	if (currentScanline >= modeRange[1])
+	if (Mem[LY_ADDRESS] == Mem[LY_CP_ADDRESS])
 	{
-		// set the next mode
-		nextMode = 1;
-		// set the mode
-		Bit::Set(stat, 0);
-		Bit::Reset(stat, 1);
-		// check if we should request an interrupt
-		requestInterrupt = Bit::Get(stat, 4);
+		// if bit 6 is set, request an interrupt (when LY starts matching)
+		if (!Bit::Get(stat, 2) && Bit::Get(stat, 6))
+		{
+			Interrupt::Request(Interrupt::IDS::LCD);
+		}
+
+		// set bit 2 on the stat register
+		Bit::Set(stat, 2);
 	}
 	else
 	{
-		// mode 2
-		if (ScanlineCounter >= modeRange[2])
-		{
-			// set the next mode
-			nextMode = 2;
-			// set the mode
-			Bit::Set(stat, 1);
-			Bit::Reset(stat, 0);
-			// check if we should request an interrupt
-			requestInterrupt = Bit::Get(stat, 5);
-		}
-		// mode 3
-		else if (ScanlineCounter >= modeRange[3])
-		{
-			// set the next mode
-			nextMode = 3;
-			// set the mode
-			Bit::Set(stat, 1);
-			Bit::Set(stat, 0);
-		}
-		// mode 0
-		else
+		// reset bit 2
+		Bit::Reset(stat, 2);
+	}
+
+	Mem[STAT_ADDRESS] = stat;
+}
+
+
+// get a decoded tile (decoding it again if its vram was written)
+static const BYTE (*GetTile(Lcd::State &state, int tile))[8]
+{
+	unsigned int bit = (1u << (tile & 31));
+
+	if (state.TileDirty[tile / 32] & bit)
+	{
+		const BYTE *data = &Memory::Get()[TILE_DATA_START_ADDRESS + (tile * 16)];
+
+		// pixel 0 of a row is bit 7 of its two bytes, pixel 1 is bit 6 etc..
+		for (int row = 0; row < 8; row++)
 		{
-			// set the next mode
-			nextMode = 0;
-			// set the mode
-			Bit::Reset(stat, 1);
-			Bit::Reset(stat, 0);
-			// check if we should request an interrupt
-			requestInterrupt = Bit::Get(stat, 3);
+			for (int x = 0; x < 8; x++)
+			{
+				int colourBit = (7 - x);
+				state.Tiles[tile][row][x] = ((((data[(row * 2) + 1] >> colourBit) & 1) << 1) | ((data[row * 2] >> colourBit) & 1));
+			}
 		}
+
+		state.TileDirty[tile / 32] &= ~bit;
 	}
 
-	// if we're in a new mode, request the appropriate interrupt
-	if (requestInterrupt && (nextMode != currentMode))
+	return state.Tiles[tile];
+}
+
+// mark the tile at an address as written
+void Lcd::InvalidateTile(WORD address)
+{
+	int tile = ((address - TILE_DATA_START_ADDRESS) / 16);
+
+	GameBoy::Current()->LcdState.TileDirty[tile / 32] |= (1u << (tile & 31));
+}
+
+// mark every tile as written
+void Lcd::InvalidateTiles()
+{
+	State &state = GameBoy::Current()->LcdState;
+
+	for (int i = 0; i < (TILE_COUNT / 32); i++)
 	{
-		Interrupt::Request(Interrupt::IDS::LCD);
+		state.TileDirty[i] = 0xFFFFFFFF;
 	}
+}
 
-	// handle the coincidence flag
-	if (Memory::ReadByte(LY_ADDRESS) == Memory::ReadByte(LY_CP_ADDRESS))
+// pack the screen into 2 bits per pixel (the shade of each pixel, for save states)
+void Lcd::PackScreen(BYTE *packed)
+{
+	State &state = GameBoy::Current()->LcdState;
+
+	memset(packed, 0, PACKED_SCREEN_SIZE);
+
+	for (int i = 0; i < (144 * 160); i++)
 	{
-		// set bit 2 on the stat register
-		Bit::Set(stat, 2);
+		unsigned int pixel;
+		memcpy(&pixel, &state.Screen[i / 160][i % 160][0], 4);
 
-		// if bit 6 is set, request an interrupt
-		if (Bit::Get(stat, 6))
+		for (int shade = 0; shade < 4; shade++)
 		{
-			Interrupt::Request(Interrupt::IDS::LCD);
+			if (pixel == SHADES[shade]) packed[i / 4] |= (shade << ((i % 4) * 2));
 		}
 	}
-	else
+}
+
+// unpack a screen packed by PackScreen
+void Lcd::UnpackScreen(const BYTE *packed)
+{
+	State &state = GameBoy::Current()->LcdState;
+
+	for (int i = 0; i < (144 * 160); i++)
 	{
-		// reset bit 2
-		Bit::Reset(stat, 2);
+		memcpy(&state.Screen[i / 160][i % 160][0], &SHADES[(packed[i / 4] >> ((i % 4) * 2)) & 3], 4);
 	}
 
-	Memory::Write(STAT_ADDRESS, stat | 0x80);
+	// the front end shows the screen again
+	state.FrameCount += 1;
+}
 
-	return 0;
+// convert a scanline of colour numbers to rgba through a palette a pixel at a time (colours holds the rgba value of colour numbers 0-3)
+static void ConvertLineScalar(const BYTE *colourNumbers, const unsigned int colours[4], BYTE *out)
+{
+	for (int x = 0; x < 160; x++)
+	{
+		memcpy(&out[x * 4], &colours[colourNumbers[x] & 3], 4);
+	}
 }
 
-// get the color from the palette
-static int GetColour(WORD address, BYTE colourNum)
+#if defined(__SSE2__)
+// convert a scanline 4 pixels at a time (selecting each colour where the colour number matches it)
+static void ConvertLineSse2(const BYTE *colourNumbers, const unsigned int colours[4], BYTE *out)
 {
-	// get the palette data
-	BYTE palette = Memory::ReadByte(address);
-	BYTE hi = 0;
-	BYTE lo = 0;
+	__m128i zero = _mm_setzero_si128();
+	__m128i palette[4], number[4];
 
-	// which bits of the colour palette does the colour id map to?
-	switch (colourNum) 
+	for (int i = 0; i < 4; i++)
 	{
-		case 0: hi = 1; lo = 0; break;
-		case 1: hi = 3; lo = 2; break; 
-		case 2: hi = 5; lo = 4; break; 
-		case 3: hi = 7; lo = 6; break;
+		palette[i] = _mm_set1_epi32(colours[i]);
+		number[i] = _mm_set1_epi32(i);
 	}
 
-	// return the color
-	return (Bit::Get(palette, hi) << 1 | Bit::Get(palette, lo));
+	for (int x = 0; x < 160; x += 4)
+	{
+		int packed;
+		memcpy(&packed, &colourNumbers[x], 4);
+		__m128i index = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		__m128i pixels = _mm_and_si128(_mm_cmpeq_epi32(index, number[0]), palette[0]);
+
+		for (int i = 1; i < 4; i++)
+		{
+			pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(index, number[i]), palette[i]));
+		}
+
+		_mm_storeu_si128((__m128i *)&out[x * 4], pixels);
+	}
 }
+#endif
 
-// draw tiles
-int Lcd::DrawTiles()
+#if defined(LCD_USE_AVX2)
+// convert a scanline 8 pixels at a time (the palette repeated in both halves, indexed by the colour number)
+__attribute__((target("avx2"))) static void ConvertLineAvx2(const BYTE *colourNumbers, const unsigned int colours[4], BYTE *out)
 {
-	// get the required values 
-	BYTE lcdControl = Memory::ReadByte(LCDC_ADDRESS);
-	WORD tileData = Bit::Get(lcdControl, 4) ? 0x8000 : 0x8800;
-	WORD tileMemory = Bit::Get(lcdControl, 3) ? 0x9C00 : 0x9800;
-	BYTE scanline = Memory::ReadByte(LY_ADDRESS);
-	BYTE scrollY = Memory::ReadByte(SCROLL_Y_ADDRESS);
-	BYTE scrollX = Memory::ReadByte(SCROLL_X_ADDRESS);
-	BYTE yPos = scrollY + scanline;
-	BYTE xPos = 0;
-	BYTE tileDataSize = 16;
-	WORD tileCol = 0;
-	WORD tileRow = 0;
-	WORD tileAddress = 0;
-	WORD tileLocation = 0;
-	BYTE tileYLine = 0;
-	bool usingUnsignedTileId = Bit::Get(lcdControl, 4);
-	BYTE pixelData1 = 0;
-	BYTE pixelData2 = 0;
-	BYTE r = 0;
-	BYTE g = 0;
-	BYTE b = 0;
+	__m256i palette = _mm256_setr_epi32(colours[0], colours[1], colours[2], colours[3], colours[0], colours[1], colours[2], colours[3]);
 
-	// draw the scanline
-	for (int x = 0; x < 160; x++)
+	for (int x = 0; x < 160; x += 8)
 	{
-		xPos = x + scrollX;
-		tileCol = (xPos / 8);
-		tileRow = (((BYTE)(yPos / 8)) * 32);
-		tileYLine = yPos % 8;
-		tileYLine *= 2;
-		SIGNED_WORD tileNum = 0;
-		tileAddress = tileMemory + tileRow + tileCol;
-		tileLocation = tileData;
-
-		// get the tile number and location
-		if (usingUnsignedTileId)
-		{
-			tileNum = (BYTE)Memory::ReadByte(tileAddress);
-			tileLocation += (tileNum * tileDataSize);
-		}
-		else
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&colourNumbers[x]));
+		_mm256_storeu_si256((__m256i *)&out[x * 4], _mm256_permutevar8x32_epi32(palette, index));
+	}
+}
+#endif
+
+// get the conversion of a scanline (NULL if the host doesn't support it)
+static void (*GetConversion(int conversion))(const BYTE *, const unsigned int *, BYTE *)
+{
+	switch(conversion)
+	{
+		case Lcd::CONVERT_SCALAR: return ConvertLineScalar;
+#if defined(__SSE2__)
+		case Lcd::CONVERT_SSE2: return ConvertLineSse2;
+#endif
+#if defined(LCD_USE_AVX2)
+		case Lcd::CONVERT_AVX2:
 		{
-			tileNum = (SIGNED_BYTE)Memory::ReadByte(tileAddress);
-			tileLocation += ((tileNum + 128) * tileDataSize);
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) return ConvertLineAvx2;
 		}
+		break;
+#endif
+	}
+
+	return NULL;
+}
+
+// get the fastest conversion of a scanline the host supports
+static void (*GetFastestConversion())(const BYTE *, const unsigned int *, BYTE *)
+{
+	for (int conversion = Lcd::CONVERSION_COUNT - 1; conversion > Lcd::CONVERT_SCALAR; conversion--)
+	{
+		if (GetConversion(conversion) != NULL) return GetConversion(conversion);
+	}
 
-		// get the pixel data
-		pixelData1 = Memory::ReadByte(tileLocation + tileYLine);
-		pixelData2 = Memory::ReadByte(tileLocation + tileYLine + 1);
+	return ConvertLineScalar;
+}
 
-		// pixel 0 in the tile is it 7 of data 1 and data2.
-		// Pixel 1 is bit 6 etc..
-		int colourBit = xPos % 8;
-		colourBit -= 7;
-		colourBit *= -1;
+// convert a scanline of colour numbers to rgba through a palette with one of the conversions, returns false if the host doesn't support it
+bool Lcd::ConvertLine(const BYTE *colourNumbers, const unsigned int colours[4], BYTE *out, int conversion)
+{
+	void (*convert)(const BYTE *, const unsigned int *, BYTE *) = GetConversion(conversion);
 
-		// combine data 2 and data 1 to get the colour id for this pixel 
-		// in the tile
-		int colourNumber = Bit::Get(pixelData2, colourBit);
-		colourNumber = ((colourNumber << 1) | Bit::Get(pixelData1, colourBit));
+	if (convert == NULL) return false;
 
-		// get the color from the palette
-		int color = GetColour(BK_PALETTE_ADDRESS, colourNumber);
+	convert(colourNumbers, colours, out);
 
-		// set the rgb value depending on the color
-		switch(color)
-		{
-			case 0: r = 155; g = 188; b = 15; break; // 00 - white
-			case 1: r = 139; g = 172; b = 15; break; // 01 - light grey
-			case 2: r = 48; g = 98; b = 48; break; // 02 - dark grey
-			case 3: r = 15; g = 56; b = 15; break; // 03 - black
-		}
+	return true;
+}
 
-		// check the scanline
-		int yBounds = Memory::ReadByte(LY_ADDRESS);
+// draw tiles
+int Lcd::DrawTiles()
+{
+	State &state = GameBoy::Current()->LcdState;
+	BYTE *Mem = Memory::Get();
+	// get the required values
+	BYTE lcdControl = Mem[LCDC_ADDRESS];
+	WORD tileMemory = Bit::Get(lcdControl, 3) ? 0x9C00 : 0x9800;
+	bool usingUnsignedTileId = Bit::Get(lcdControl, 4);
+	BYTE scanline = Mem[LY_ADDRESS];
+	BYTE scrollX = Mem[SCROLL_X_ADDRESS];
+	BYTE yPos = Mem[SCROLL_Y_ADDRESS] + scanline;
+	WORD tileRow = tileMemory + (((BYTE)(yPos / 8)) * 32);
+	BYTE tileYLine = (yPos % 8);
+	BYTE palette = Mem[BK_PALETTE_ADDRESS];
+	// the rgba value of each colour number
+	unsigned int colours[4];
+	// the colour numbers of the tile rows the scanline crosses
+	BYTE line[21 * 8];
+
+	// copy the row of each tile (21, as the scroll can leave one partly off screen)
+	for (int i = 0; i < 21; i++)
+	{
+		BYTE tileNum = Mem[tileRow + (((scrollX / 8) + i) & 31)];
+		// tiles 0-255 from 0x8000, or -128-127 from 0x9000
+		int tile = usingUnsignedTileId ? tileNum : (256 + (SIGNED_BYTE)tileNum);
 
-		// if the scanline is within the screens visible bounds
-		if ((yBounds >= 0) && (yBounds < 144) && (x >= 0) && (x <= 159))
-		{
-			Screen[yBounds][xPos][0] = r;
-			Screen[yBounds][xPos][1] = g;
-			Screen[yBounds][xPos][2] = b;
-		}
+		memcpy(&line[i * 8], GetTile(state, tile)[tileYLine], 8);
+	}
+
+	// build the palette
+	for (int i = 0; i < 4; i++)
+	{
+		colours[i] = SHADES[(palette >> (i * 2)) & 3];
 	}
 
+	// draw the scanline through the palette (with the fastest conversion, picked once)
+	static void (*const convertLine)(const BYTE *, const unsigned int *, BYTE *) = GetFastestConversion();
+	convertLine(&line[scrollX % 8], colours, &state.Screen[scanline][0][0]);
+
 	return 0;
 }
 
@@ -315,62 +400,73 @@ void Lcd::DrawScanline()
 	}
 }
 
-// update the LCD
-int Lcd::Update(int cycles)
+// move the lcd on to its next mode
+void Lcd::Event(unsigned long long timestamp)
 {
-	// set the Lcd status
-	SetLCDStatus();
-
-	// if the screen isn't enabled, return
-	if (!IsLCDEnabled()) return 0;
+	BYTE *Mem = Memory::Get();
 
-	ScanlineCounter -= cycles;
-
-	if (ScanlineCounter <= 0)
+	switch(Mem[STAT_ADDRESS] & 0x3)
 	{
-		Memory::Mem[LY_ADDRESS] += 1;
-		BYTE currentScanline = Memory::ReadByte(LY_ADDRESS);
-
-		// we can draw the scanline
-		if (currentScanline < 144)
+		// oam search is over, transfer the scanline
+		case OAM:
 		{
-			DrawScanline();
-			UpdateTexture();
+			SetMode(TRANSFER);
+			Scheduler::Schedule(Scheduler::LCD, timestamp + TRANSFER_CYCLES);
 		}
-		// we've hit vblank
-		if (currentScanline == 144)
+		break;
+
+		// the scanline has been transferred, draw it (unless it won't be shown)
+		case TRANSFER:
 		{
-			// request the vblank interrupt
-			Interrupt::Request(Interrupt::VBLANK);
+			if (timestamp >= GameBoy::Current()->LcdState.DrawFrom) DrawScanline();
+			SetMode(HBLANK);
+			Scheduler::Schedule(Scheduler::LCD, timestamp + HBLANK_CYCLES);
 		}
-		// time to reset the scanline
-		if (currentScanline > 153)
+		break;
+
+		// move on to the next scanline
+		case HBLANK:
 		{
-			// reset the scanline
-			Memory::Mem[LY_ADDRESS] = 0x00;
-			// update the texture
-			//UpdateTexture();
+			Mem[LY_ADDRESS] += 1;
+
+			// we've hit vblank
+			if (Mem[LY_ADDRESS] == VBLANK_SCANLINE)
+			{
+				// the frame is finished
+				GameBoy::Current()->LcdState.FrameCount += 1;
+				// request the vblank interrupt
+				Interrupt::Request(Interrupt::VBLANK);
+				SetMode(VBLANK);
+				Scheduler::Schedule(Scheduler::LCD, timestamp + LCD_CLOCK_CYCLES);
+			}
+			else
+			{
+				SetMode(OAM);
+				Scheduler::Schedule(Scheduler::LCD, timestamp + OAM_CYCLES);
+			}
+
+			CheckCoincidence();
 		}
+		break;
 
-		ScanlineCounter += LCD_CLOCK_CYCLES;
+		// move on to the next vblank scanline
+		case VBLANK:
+		{
+			// time to reset the scanline
+			if (Mem[LY_ADDRESS] == LAST_SCANLINE)
+			{
+				Mem[LY_ADDRESS] = 0x00;
+				SetMode(OAM);
+				Scheduler::Schedule(Scheduler::LCD, timestamp + OAM_CYCLES);
+			}
+			else
+			{
+				Mem[LY_ADDRESS] += 1;
+				Scheduler::Schedule(Scheduler::LCD, timestamp + LCD_CLOCK_CYCLES);
+			}
+
+			CheckCoincidence();
+		}
+		break;
 	}
-
-	return 0;
-}
-
-// update the texture
-void Lcd::UpdateTexture()
-{
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 160, 144, 0, GL_RGB, GL_UNSIGNED_BYTE, Screen);
-}
-
-// render the LCD
-void Lcd::Render()
-{
-	glBegin(GL_QUADS);
-	glTexCoord2f(0, 0); glVertex2f(0, 0);
-	glTexCoord2f(0, 1); glVertex2f(0, 144);
-	glTexCoord2f(1, 1); glVertex2f(160, 144);
-	glTexCoord2f(1, 0); glVertex2f(160, 0);
-	glEnd();
 }
@@ -10,8 +10,8 @@
 #include "include/cpu.h"
 #include "include/log.h"
 
-// open log output file
-FILE *logOutput = fopen("run.log","w");
+// log output file (opened on first use)
+static FILE *logOutput = NULL;
 
 // normal/standard log output
 void Log::Normal(const char *fmt, ...)
@@ -71,6 +71,10 @@ void Log::UnimplementedOpcode(BYTE opcode)
 // log to file
 void Log::ToFile(WORD pc, BYTE opcode)
 {
+	// open the log output file
+	if (logOutput == NULL) logOutput = fopen("run.log", "w");
+	if (logOutput == NULL) return;
+
 	//fprintf(logOutput, "%04X: 0x%02X\n", pc, opcode);
 	fprintf(logOutput, "%04X:%04X:%04X:%04X:%04X:%04X:%04X\n", pc, opcode, Cpu::Get::AF()->reg, Cpu::Get::BC()->reg, Cpu::Get::DE()->reg, Cpu::Get::HL()->reg, Cpu::Get::SP()->reg);
 }
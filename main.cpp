@@ -8,6 +8,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
 #include "imgui/imgui.h"
@@ -16,12 +21,24 @@
 #include "tinyfiledialogs/tinyfiledialogs.h"
 #include "include/bios.h"
 #include "include/cpu.h"
+#include "include/debugger.h"
+#include "include/display.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
+#include "include/joypad.h"
 #include "include/lcd.h"
 #include "include/log.h"
 #include "include/memory.h"
+#include "include/movie.h"
+#include "include/pacer.h"
+#include "include/rewind.h"
 #include "include/rom.h"
+#include "include/saveState.h"
+#include "include/scheduler.h"
+#include "include/snapshot.h"
+#include "include/spscQueue.h"
 #include "include/timer.h"
+#include "include/tripleBuffer.h"
 #include "include/unitTest.h"
 
 #define DO_UNIT_TESTS false
@@ -31,12 +48,22 @@
 // emulator name
 #define EMULATOR_NAME "cBoy: GameBoy Emulator"
 // emulator settings
-#define MAX_CYCLES 4194304 / 60 
+#define MAX_CYCLES FRAME_CYCLES
+#define STATE_FILE_NAME "state1.bin"
+// the movie, and the state it starts from
+#define MOVIE_FILE_NAME "movie1.bin"
+#define MOVIE_STATE_FILE_NAME "movie1.state"
+// the speeds the speed button cycles through (0 is uncapped)
+static const int SPEEDS[] = {1, 2, 4, 0};
+#define SPEED_COUNT (int)(sizeof(SPEEDS) / sizeof(SPEEDS[0]))
+// the frames to run ahead the run ahead button cycles through (0 is off)
+static const int RUN_AHEAD_FRAMES[] = {0, 1, 2};
+#define RUN_AHEAD_COUNT (int)(sizeof(RUN_AHEAD_FRAMES) / sizeof(RUN_AHEAD_FRAMES[0]))
 // are we in release mode?
 const bool RELEASE_MODE = false; 
-// should we step through instructions?
-static int stepThrough = true;
-// the breakpoint
+// should we step through instructions? (only changed by the emulation thread)
+static std::atomic<bool> stepThrough(true);
+// the breakpoint (only used by the emulation thread)
 static unsigned short breakpoint = 0;
 static bool stopAtBreakpoint = false;
 static char breakpointBuffer[256];
@@ -44,13 +71,59 @@ static bool debuggerActive = !RELEASE_MODE;
 // did we load the bios
 static bool didLoadBios = false;
 // number of instructions ran
-static int instructionsRan = 0;
+static std::atomic<int> instructionsRan(0);
+// keeps the emulation thread at the selected speed
+static Pacer pacer;
+// the selected speed (an index into SPEEDS)
+static int speed = 0;
+// the frames to rewind through (only used by the emulation thread)
+static Rewind rewindBuffer;
+static bool rewinding = false;
+// the selected run ahead (an index into RUN_AHEAD_FRAMES)
+static int runAhead = 0;
+// the frames to run ahead, and the machine to go back to (only used by the emulation thread)
+static int runAheadFrames = 0;
+static Snapshot runAheadSnapshot;
+// the movie being recorded or played back (only used by the emulation thread)
+static Movie movie;
+// is a movie being recorded or played back? (only changed by the emulation thread)
+static std::atomic<bool> movieRecording(false);
+static std::atomic<bool> moviePlaying(false);
 // has the user requested to quit the emulator?
-static bool shouldQuit = false;
+static std::atomic<bool> shouldQuit(false);
 // the SDL window
 static SDL_Window *window = NULL;
 // the SDL GL context
 static SDL_GLContext glContext = NULL;
+// the emulated machine
+static GameBoy gameBoy;
+// held while the machine is ran or changed, and while the ui reads it
+static std::mutex machineLock;
+// a finished frame
+struct Frame
+{
+	BYTE Screen[144][160][4];
+};
+// the frames the emulation thread hands to the ui thread
+static TripleBuffer<Frame> frames;
+// the commands the ui thread sends to the emulation thread
+enum Commands
+{
+	STEP, RUN, RUN_TO_BREAKPOINT, STOP, RESET, LOAD_ROM, SAVE_STATE, LOAD_STATE, SET_SPEED, SET_RUN_AHEAD, START_REWIND, STOP_REWIND, RECORD_MOVIE, PLAY_MOVIE, STOP_MOVIE
+};
+struct Command
+{
+	int Type;
+	// the breakpoint, the speed multiplier (0 is uncapped) or the frames to run ahead
+	WORD Address;
+	// the rom to load (allocated by the ui, freed by the emulation thread)
+	char *FileName;
+};
+static SpscQueue<Command, 64> commands;
+// the buttons the ui thread presses and releases (stamped with the cycle the emulation thread takes them at)
+static SpscQueue<Joypad::Input, 64> inputs;
+// the key of each joypad button (right, left, up, down, a, b, select and start)
+static const SDL_Keycode JOYPAD_KEYS[Joypad::BUTTON_COUNT] = {SDLK_d, SDLK_a, SDLK_w, SDLK_s, SDLK_x, SDLK_z, SDLK_RSHIFT, SDLK_RETURN};
 
 // init SDL
 static bool InitSDL()
@@ -134,19 +207,19 @@ static void Close()
 }
 
 // emulation loop
-static void EmulationLoop()
+static void EmulationLoop(int cycles = MAX_CYCLES)
 {
 	// reset Cpu cycles
-	Cpu::Cycles = 0;
+	gameBoy.CpuState.Cycles = 0;
 
-	// if we're not stepping through
-	if (!stepThrough)
+	// if we're stopping at a breakpoint, run an instruction at a time to catch it
+	if (!stepThrough && stopAtBreakpoint)
 	{
 		// execute if within the max cycles for this update
-		while (Cpu::Cycles < MAX_CYCLES)
+		while (Cpu::Get::Cycles() < cycles)
 		{
-			// determine if we should stop execution at a specific breakpoint
-			if (stopAtBreakpoint && Cpu::Get::PC() == breakpoint)
+			// determine if we should stop execution at the breakpoint
+			if (Cpu::Get::PC() == breakpoint)
 			{
 				// enable step through mode
 				stepThrough = true;
@@ -154,43 +227,26 @@ static void EmulationLoop()
 				break;
 			}
 
-			// store the current cycle
-			int currentCycle = Cpu::Get::Cycles();
-			// execute the next opcode
-			Cpu::ExecuteOpcode();
-			// get the value of the current cycle only
-			int cycles = (Cpu::Get::Cycles() - currentCycle);
-			// update timers
-			Timer::Update(cycles);
-			// update graphics
-			Lcd::Update(cycles);
-			// service interupts
-			Interrupt::Service();
+			// execute the next opcode and update the hardware
+			gameBoy.Step();
 			// increment the instructions ran
 			instructionsRan++;
 		}
 	}
+	// otherwise run the whole update at once (skipping halts and idle loops, and running compiled blocks)
+	else if (!stepThrough)
+	{
+		instructionsRan += gameBoy.RunCycles(cycles);
+	}
 	// stepping through
 	else
 	{
-		// store the current cycle
-		int currentCycle = Cpu::Get::Cycles();
-		// execute the next opcode
-		Cpu::ExecuteOpcode();
-		// get the value of the current cycle only
-		int cycles = (Cpu::Get::Cycles() - currentCycle);
-		// update timers
-		Timer::Update(cycles);
-		// update graphics
-		Lcd::Update(cycles);
-		// service interupts
-		Interrupt::Service();
+		// execute the next opcode and update the hardware
+		gameBoy.Step();
 		// increment the instructions ran
 		instructionsRan++;
 	}
 
-	// draw the screen
-	Lcd::Render();
 }
 
 // reset GameBoy
@@ -202,20 +258,273 @@ static void ResetGameBoy(bool reloadRom)
 	stepThrough = true;
 	// reset the instructions ran
 	instructionsRan = 0;
+	// clear the hardware events
+	Scheduler::Init();
 	// reset the timer
 	Timer::Reset();
 	// reset the memory
 	Memory::Init();
 	// init the cpu again
 	Cpu::Init(didLoadBios);
-	// reload the rom
+	// release the buttons
+	Joypad::Init();
+	// reset the cartridge
 	if (reloadRom)
 	{
-		Rom::Reload();
+		Rom::Reset();
 	}
 	// reset the lcd
 	Lcd::Reset();
-	Lcd::UpdateTexture();
+}
+
+// send a command to the emulation thread
+static void SendCommand(int type, WORD address = 0, char *fileName = NULL)
+{
+	Command command = {type, address, fileName};
+
+	// the queue is only full if the emulation thread has stalled, drop the command
+	if (!commands.Push(command))
+	{
+		Log::Warning("The emulation thread isn't taking commands, dropped command %d\n", type);
+		free(fileName);
+	}
+}
+
+// press or release the joypad button of a key (if it is one)
+static void SendInput(SDL_Keycode key, bool pressed)
+{
+	for (int button = 0; button < Joypad::BUTTON_COUNT; button++)
+	{
+		if (JOYPAD_KEYS[button] != key) continue;
+
+		Joypad::Input input = {0, button, pressed};
+
+		// the queue is only full if the emulation thread has stalled, drop the input
+		if (!inputs.Push(input)) Log::Warning("The emulation thread isn't taking input, dropped a button\n");
+	}
+}
+
+// stop recording (and save the movie) or playing back
+static void StopMovie()
+{
+	if (movie.IsRecording()) movie.StopRecording(MOVIE_FILE_NAME);
+	else if (movie.IsPlaying() && movie.StopPlayback()) Log::Normal("The movie played back in sync");
+
+	movieRecording = false;
+	moviePlaying = false;
+}
+
+// run a command sent by the ui thread (returns true if the cpu was stepped)
+static bool RunCommand(const Command &command)
+{
+	switch(command.Type)
+	{
+		case STEP:
+		{
+			// enable step through mode
+			stepThrough = true;
+			EmulationLoop();
+		}
+		return true;
+
+		case RUN:
+		{
+			// disable step through mode
+			stepThrough = false;
+		}
+		break;
+
+		case RUN_TO_BREAKPOINT:
+		{
+			breakpoint = command.Address;
+			// disable step through mode
+			stepThrough = false;
+			// we want to stop at the breakpoint
+			stopAtBreakpoint = true;
+		}
+		break;
+
+		case STOP:
+		{
+			// we no longer want to stop at the breakpoint
+			stopAtBreakpoint = false;
+			// enable step through mode
+			stepThrough = true;
+		}
+		break;
+
+		case RESET:
+		case LOAD_ROM:
+		{
+			// the movie ends where the machine was
+			StopMovie();
+			ResetGameBoy(command.Type == RESET);
+			// the frames to rewind through are of the old game
+			rewindBuffer.Clear();
+			// load the new game
+			if (command.Type == LOAD_ROM)
+			{
+				Rom::Load(command.FileName);
+				free(command.FileName);
+			}
+			// reload the bios
+			if (didLoadBios)
+			{
+				Bios::Reload();
+			}
+		}
+		break;
+
+		case SET_SPEED:
+		{
+			if (command.Address == 0) pacer.SetMode(Pacer::UNCAPPED);
+			else if (command.Address == 1) pacer.SetMode(Pacer::REAL_TIME);
+			else pacer.SetMode(Pacer::MULTIPLIER, command.Address);
+		}
+		break;
+
+		case SET_RUN_AHEAD: runAheadFrames = command.Address; break;
+		case START_REWIND: StopMovie(); rewinding = true; break;
+		case STOP_REWIND: rewinding = false; break;
+		case SAVE_STATE: SaveState::SaveToFile(STATE_FILE_NAME); break;
+		case LOAD_STATE: StopMovie(); SaveState::LoadFromFile(STATE_FILE_NAME); break;
+
+		// record from the current state (saved for the movie to start from)
+		case RECORD_MOVIE:
+		{
+			StopMovie();
+
+			if (SaveState::SaveToFile(MOVIE_STATE_FILE_NAME))
+			{
+				movie.StartRecording();
+				movieRecording = true;
+			}
+		}
+		break;
+
+		// play back from the state the movie started from
+		case PLAY_MOVIE:
+		{
+			StopMovie();
+
+			if (SaveState::LoadFromFile(MOVIE_STATE_FILE_NAME) && movie.StartPlayback(MOVIE_FILE_NAME))
+			{
+				moviePlaying = true;
+			}
+		}
+		break;
+
+		case STOP_MOVIE: StopMovie(); break;
+		default: break;
+	}
+
+	return false;
+}
+
+// publish the screen to the ui thread (once per finished frame, or the frame so far after a step)
+static void PublishFrame(bool partialFrame)
+{
+	static unsigned int publishedFrame = 0;
+	unsigned int frame = Lcd::Get::FrameCount();
+
+	if (!partialFrame && frame == publishedFrame) return;
+
+	publishedFrame = frame;
+	memcpy(frames.GetBack().Screen, Lcd::Get::Screen(), sizeof(Frame::Screen));
+	frames.Publish();
+}
+
+// show the screen from frames ahead of the machine, then put it back (hides the game's own input lag)
+static void RunAhead()
+{
+	runAheadSnapshot.Take();
+	gameBoy.RunFramesAhead(runAheadFrames);
+	PublishFrame(false);
+	runAheadSnapshot.Restore();
+}
+
+// the emulation thread (runs the machine at the hardware's speed, apart from the ui)
+static void EmulationThread()
+{
+	Command command;
+	Joypad::Input input;
+	// the input taken from the ui that didn't fit in the joypad's queue (it's queued on a later run)
+	bool inputWaiting = false;
+
+	// bind the machine to the emulation thread
+	gameBoy.Bind();
+
+	while (!shouldQuit)
+	{
+		bool stepped = false;
+
+		// run the machine
+		{
+			std::lock_guard<std::mutex> lock(machineLock);
+
+			// run the commands sent by the ui
+			while (commands.Pop(command))
+			{
+				stepped |= RunCommand(command);
+			}
+
+			// the buttons pressed and released since, from now (a movie being played back presses its own)
+			while (inputWaiting || inputs.Pop(input))
+			{
+				inputWaiting = false;
+				if (movie.IsPlaying()) continue;
+
+				input.Timestamp = Scheduler::Now();
+
+				// the joypad's queue is full, keep the input (and the ones after it) until it has room
+				if (!Joypad::Queue(input))
+				{
+					inputWaiting = true;
+					break;
+				}
+
+				movie.Record(input);
+			}
+
+			// the movie's buttons, and the cycles to its end
+			int cycles = MAX_CYCLES;
+
+			if (movie.IsPlaying() && (cycles = movie.Play(MAX_CYCLES)) == 0)
+			{
+				StopMovie();
+				cycles = MAX_CYCLES;
+			}
+
+			// step back a frame
+			if (!stepThrough && rewinding)
+			{
+				rewindBuffer.Pop();
+			}
+			// execute the emulation loop, and keep the frame to rewind to
+			else if (!stepThrough)
+			{
+				EmulationLoop(cycles);
+				rewindBuffer.Push();
+
+				// unless a breakpoint was hit
+				if (runAheadFrames > 0 && !stepThrough) RunAhead();
+			}
+
+			PublishFrame(stepped);
+		}
+
+		// wait for the next command
+		if (stepThrough)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			pacer.Restart();
+		}
+		// wait until the cycles ran (or rewound) are due
+		else
+		{
+			pacer.Pace(rewinding ? MAX_CYCLES : gameBoy.CpuState.Cycles);
+		}
+	}
 }
 
 // show the rom info window
@@ -249,7 +558,7 @@ static void ShowRomInfoWindow()
 	ImGuiExtensions::TextWithColors("{FF0000}Ram-Size: {FFFFFF}%02x", Memory::ReadByte(0x0149));
 	// rom file name + path
 	ImGuiExtensions::TextWithColors("{FF0000}Filename:");
-	ImGui::TextWrapped("%s", Rom::currentRomFileName);
+	ImGui::TextWrapped("%s", Rom::Get::FileName());
 	ImGui::End();
 }
 
@@ -275,15 +584,8 @@ static void ShowFileWindow()
 		// if the filename isn't null
 		if (fileName != NULL)
 		{
-			// reset the gameboy
-			ResetGameBoy(false);
-			// load the new game
-			Rom::Load(fileName);
-			// reload the bios
-			if (didLoadBios)
-			{
-				Bios::Reload();
-			}
+			// reset the gameboy and load the new game
+			SendCommand(LOAD_ROM, 0, strdup(fileName));
 		}
 	}
 
@@ -293,7 +595,7 @@ static void ShowFileWindow()
 	// if the "save state" button is clicked
 	if (ImGui::IsItemClicked())
 	{
-		Cpu::SaveState();
+		SendCommand(SAVE_STATE);
 	}
 
 	// load state button
@@ -302,7 +604,55 @@ static void ShowFileWindow()
 	// if the "load state" button is clicked
 	if (ImGui::IsItemClicked())
 	{
-		Cpu::LoadState();
+		SendCommand(LOAD_STATE);
+	}
+
+	// speed button (shows the selected speed and the speed achieved)
+	char speedLabel[64];
+
+	if (SPEEDS[speed] == 0) snprintf(speedLabel, sizeof(speedLabel), "Uncapped (%d%%)", (int)(pacer.GetSpeed() * 100));
+	else snprintf(speedLabel, sizeof(speedLabel), "Speed %dx (%d%%)", SPEEDS[speed], (int)(pacer.GetSpeed() * 100));
+
+	ImGui::Button(speedLabel, ImVec2(140, 0));
+
+	// if the "speed" button is clicked, move on to the next speed
+	if (ImGui::IsItemClicked())
+	{
+		speed = (speed + 1) % SPEED_COUNT;
+		SendCommand(SET_SPEED, SPEEDS[speed]);
+	}
+
+	// run ahead button
+	char runAheadLabel[64];
+
+	if (RUN_AHEAD_FRAMES[runAhead] == 0) snprintf(runAheadLabel, sizeof(runAheadLabel), "Run Ahead: Off");
+	else snprintf(runAheadLabel, sizeof(runAheadLabel), "Run Ahead: %d", RUN_AHEAD_FRAMES[runAhead]);
+
+	ImGui::Button(runAheadLabel, ImVec2(140, 0));
+
+	// if the "run ahead" button is clicked, move on to the next number of frames
+	if (ImGui::IsItemClicked())
+	{
+		runAhead = (runAhead + 1) % RUN_AHEAD_COUNT;
+		SendCommand(SET_RUN_AHEAD, RUN_AHEAD_FRAMES[runAhead]);
+	}
+
+	// record movie button
+	ImGui::Button(movieRecording ? "Stop Recording" : "Record Movie", ImVec2(140, 0));
+
+	// if the "record movie" button is clicked, start or stop recording
+	if (ImGui::IsItemClicked())
+	{
+		SendCommand(movieRecording ? STOP_MOVIE : RECORD_MOVIE);
+	}
+
+	// play movie button
+	ImGui::Button(moviePlaying ? "Stop Movie" : "Play Movie", ImVec2(140, 0));
+
+	// if the "play movie" button is clicked, start or stop playing back
+	if (ImGui::IsItemClicked())
+	{
+		SendCommand(moviePlaying ? STOP_MOVIE : PLAY_MOVIE);
 	}
 
 	// hide debugger button
@@ -331,9 +681,8 @@ static void ShowDebuggerControlsWindow()
 	// if the "step" button is clicked
 	if (ImGui::IsItemClicked())
 	{
-		// enable step through mode
-		stepThrough = true;
-		EmulationLoop();
+		// step forward once
+		SendCommand(STEP);
 	}
 
 	// run button
@@ -343,7 +692,7 @@ static void ShowDebuggerControlsWindow()
 	if (ImGui::IsItemClicked())
 	{
 		// disable step through mode
-		stepThrough = false;
+		SendCommand(RUN);
 	}
 
 	// run button
@@ -378,15 +727,11 @@ static void ShowDebuggerControlsWindow()
 		// if the "ok" button is clicked
 		if (ImGui::IsItemClicked())
 		{
-			// convert the breakpoint buffer to a short
-			breakpoint = (unsigned short)strtol(breakpointBuffer, NULL, 16);
 			// only enable the breakpoint if text has been entered
 			if (strlen(breakpointBuffer) > 0)
 			{
-				// disable step through mode
-				stepThrough = false;
-				// we want to stop at the breakpoint
-				stopAtBreakpoint = true;
+				// run until the breakpoint (converted to a short)
+				SendCommand(RUN_TO_BREAKPOINT, (WORD)strtol(breakpointBuffer, NULL, 16));
 				// close the popup
 				ImGui::CloseCurrentPopup();
 			}
@@ -440,10 +785,8 @@ static void ShowDebuggerControlsWindow()
 	// see if the "stop" button is clicked
 	if (ImGui::IsItemClicked())
 	{
-		// we no longer want to stop at the breakpoint
-		stopAtBreakpoint = false;
 		// enable step through mode
-		stepThrough = true;
+		SendCommand(STOP);
 	}
 
 	// reset button
@@ -452,16 +795,12 @@ static void ShowDebuggerControlsWindow()
 	// see if the "reset" button is clicked
 	if (ImGui::IsItemClicked())
 	{
-		ResetGameBoy(true);
-		// reload the bios
-		if (didLoadBios)
-		{
-			Bios::Reload();
-		}
+		// reset the gameboy
+		SendCommand(RESET);
 	}
 
 	// display the number of instructions ran
-	ImGuiExtensions::TextWithColors("  {FF0000}Ins Ran:"); ImGui::Indent(20.f); ImGui::Text("%d", instructionsRan); ImGui::Unindent(20.f);
+	ImGuiExtensions::TextWithColors("  {FF0000}Ins Ran:"); ImGui::Indent(20.f); ImGui::Text("%d", instructionsRan.load()); ImGui::Unindent(20.f);
 
 	// end window
 	ImGui::End();
@@ -498,12 +837,17 @@ static void StartMainLoop()
 						case SDLK_DOWN:
 							if (stepThrough)
 							{
-								EmulationLoop();
+								SendCommand(STEP);
 							}
 						break;
 
 						case SDLK_LEFT:
-							stepThrough = !stepThrough;
+							SendCommand(stepThrough ? RUN : STOP);
+						break;
+
+						case SDLK_BACKSPACE:
+							// rewind while backspace is held
+							if (!event.key.repeat) SendCommand(START_REWIND);
 						break;
 
 						case SDLK_ESCAPE:
@@ -511,9 +855,22 @@ static void StartMainLoop()
 						break;
 
 						default:
+							if (!event.key.repeat) SendInput(event.key.keysym.sym, true);
 						break;
 					}
 				break;
+
+				// key up event
+				case SDL_KEYUP:
+					if (event.key.keysym.sym == SDLK_BACKSPACE)
+					{
+						SendCommand(STOP_REWIND);
+					}
+					else
+					{
+						SendInput(event.key.keysym.sym, false);
+					}
+				break;
 			}
 		}
 
@@ -523,21 +880,32 @@ static void StartMainLoop()
 			// Use ImGui functions between here and Render()
 			ImGui_ImplSdlGL2_NewFrame(window);
 
-			// show the rom info window
-			ShowRomInfoWindow();
 			// show the debugger controls window
 			ShowDebuggerControlsWindow();
 			// show the file window
 			ShowFileWindow();
-			// show the debugger
-			Cpu::Debugger();
+
+			// the rom info and debugger read the machine
+			{
+				std::lock_guard<std::mutex> lock(machineLock);
+
+				// show the rom info window
+				ShowRomInfoWindow();
+				// show the debugger
+				Debugger::Show();
+			}
 
 			// ImGui functions end here
 			ImGui::Render();
 		}
 
-		// execute the emulation loop
-		if (!stepThrough) EmulationLoop();
+		// upload the newest frame (if the emulation thread finished one) and draw the screen
+		if (frames.Acquire())
+		{
+			Display::UpdateTexture(&frames.GetFront().Screen[0][0][0]);
+		}
+
+		Display::Render();
 
 		// flip buffers
 		SDL_GL_SwapWindow(window);
@@ -547,6 +915,9 @@ static void StartMainLoop()
 // main
 int main(int argc, char* args[])
 {
+	// bind the machine to the main thread
+	gameBoy.Bind();
+
 	// init SDL
 	if (InitSDL())
 	{
@@ -575,12 +946,12 @@ int main(int argc, char* args[])
 		// load bios
 		//didLoadBios = Bios::Load("bios.bin");
 
-		// init the Cpu
-		Cpu::Init(didLoadBios);
-		// init the timer
-		Timer::Init();
-		// init Lcd
-		Lcd::Init();
+		// init the machine
+		gameBoy.Init(didLoadBios);
+		// init the display
+		Display::Init();
+		// init the debugger
+		Debugger::Init();
 
 		// start unit tests
 		if (DO_UNIT_TESTS)
@@ -599,8 +970,15 @@ int main(int argc, char* args[])
 			UnitTest::Test::SixteenBit::Add();
 		}	
 
+		// start the emulation thread
+		std::thread emulation(EmulationThread);
+
 		// execute the main loop
 		StartMainLoop();
+
+		// stop the emulation thread
+		shouldQuit = true;
+		emulation.join();
 	}
 
 	// close
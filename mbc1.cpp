@@ -8,8 +8,61 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include "include/gameboy.h"
 #include "include/memory.h"
 #include "include/mbc1.h"
 #include "include/log.h"
+#include "include/rom.h"
 
-// TODO
+// map the banks selected by the registers
+void Mbc1::Map()
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	// in mode 1 the upper bits also select the bank at 0x0000 and the ram bank
+	Rom::MapRom(0x0000, (rom.BankingMode == 1) ? (rom.RomBankHigh << 5) : 0);
+	Rom::MapRom(SWITCHABLE_ROM_ADDRESS, (rom.RomBankHigh << 5) | rom.RomBankLow);
+	Rom::MapRam((rom.BankingMode == 1) ? rom.RomBankHigh : 0);
+}
+
+// write to the mbc1 registers
+void Mbc1::Write(WORD address, BYTE data)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	switch(address & 0x6000)
+	{
+		// ram enable
+		case 0x0000:
+		{
+			rom.RamEnabled = ((data & 0x0F) == 0x0A);
+			Rom::MapRam((rom.BankingMode == 1) ? rom.RomBankHigh : 0);
+		}
+		break;
+
+		// rom bank (lower 5 bits, bank 0 selects bank 1)
+		case 0x2000:
+		{
+			rom.RomBankLow = (data & 0x1F);
+			if (rom.RomBankLow == 0) rom.RomBankLow = 1;
+			Rom::MapRom(SWITCHABLE_ROM_ADDRESS, (rom.RomBankHigh << 5) | rom.RomBankLow);
+		}
+		break;
+
+		// ram bank or upper rom bank bits
+		case 0x4000:
+		{
+			rom.RomBankHigh = (data & 0x03);
+			Map();
+		}
+		break;
+
+		// banking mode
+		case 0x6000:
+		{
+			rom.BankingMode = (data & 0x01);
+			Map();
+		}
+		break;
+	}
+}
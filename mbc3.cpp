@@ -0,0 +1,140 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: mbc3.cpp
+*/
+
+// includes
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include "include/gameboy.h"
+#include "include/memory.h"
+#include "include/mbc3.h"
+#include "include/log.h"
+#include "include/rom.h"
+#include "include/scheduler.h"
+
+// bring the clock registers up to the current cycle
+void Mbc3::UpdateClock()
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+	unsigned long long now = Scheduler::Now();
+
+	// the clock doesn't run while halted (and the machine's clock may have been reset)
+	if ((rom.Clock[MBC3_CLOCK_DAY_HIGH] & MBC3_CLOCK_HALT) || now < rom.ClockBase)
+	{
+		rom.ClockBase = now;
+		return;
+	}
+
+	unsigned long long seconds = ((now - rom.ClockBase) / MBC3_CLOCK_CYCLES_PER_SECOND);
+
+	if (seconds == 0) return;
+
+	// the part of a second left over counts towards the next
+	rom.ClockBase += (seconds * MBC3_CLOCK_CYCLES_PER_SECOND);
+
+	// carry the seconds into the minutes, hours and days
+	unsigned long long total = (rom.Clock[0] + seconds);
+	rom.Clock[0] = (BYTE)(total % 60);
+	total = (rom.Clock[1] + (total / 60));
+	rom.Clock[1] = (BYTE)(total % 60);
+	total = (rom.Clock[2] + (total / 60));
+	rom.Clock[2] = (BYTE)(total % 24);
+	total = ((rom.Clock[3] | ((rom.Clock[MBC3_CLOCK_DAY_HIGH] & 0x01) << 8)) + (total / 24));
+
+	// the day counter is 9 bits, and sets the carry when it overflows (until the game clears it)
+	BYTE dayHigh = (rom.Clock[MBC3_CLOCK_DAY_HIGH] & ~0x01);
+	if (total > 0x1FF) dayHigh |= MBC3_CLOCK_DAY_CARRY;
+
+	rom.Clock[3] = (BYTE)(total & 0xFF);
+	rom.Clock[MBC3_CLOCK_DAY_HIGH] = (dayHigh | ((total >> 8) & 0x01));
+}
+
+// map the banks selected by the registers
+void Mbc3::Map()
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	Rom::MapRom(0x0000, 0);
+	Rom::MapRom(SWITCHABLE_ROM_ADDRESS, rom.RomBankLow);
+	// the clock registers are read and written through the handlers
+	Rom::MapRam((rom.RamBank < MBC3_CLOCK_REGISTER_START) ? rom.RamBank : -1);
+}
+
+// write to the mbc3 registers
+void Mbc3::Write(WORD address, BYTE data)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	switch(address & 0x6000)
+	{
+		// ram and clock enable
+		case 0x0000:
+		{
+			rom.RamEnabled = ((data & 0x0F) == 0x0A);
+			Rom::MapRam((rom.RamBank < MBC3_CLOCK_REGISTER_START) ? rom.RamBank : -1);
+		}
+		break;
+
+		// rom bank (7 bits, bank 0 selects bank 1)
+		case 0x2000:
+		{
+			rom.RomBankLow = (data & 0x7F);
+			if (rom.RomBankLow == 0) rom.RomBankLow = 1;
+			Rom::MapRom(SWITCHABLE_ROM_ADDRESS, rom.RomBankLow);
+		}
+		break;
+
+		// ram bank or clock register
+		case 0x4000:
+		{
+			rom.RamBank = data;
+			Rom::MapRam((rom.RamBank < MBC3_CLOCK_REGISTER_START) ? rom.RamBank : -1);
+		}
+		break;
+
+		// latch the clock (writing 0 then 1)
+		case 0x6000:
+		{
+			if (rom.ClockLatch == 0x00 && data == 0x01)
+			{
+				UpdateClock();
+				memcpy(rom.LatchedClock, rom.Clock, sizeof(rom.Clock));
+			}
+
+			rom.ClockLatch = data;
+		}
+		break;
+	}
+}
+
+// read the selected clock register (or disabled ram)
+BYTE Mbc3::ReadRam(WORD /*address*/)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	if (rom.RamEnabled && rom.RamBank >= MBC3_CLOCK_REGISTER_START && rom.RamBank <= MBC3_CLOCK_REGISTER_END)
+	{
+		return rom.LatchedClock[rom.RamBank - MBC3_CLOCK_REGISTER_START];
+	}
+
+	return 0xFF;
+}
+
+// write the selected clock register
+void Mbc3::WriteRam(WORD /*address*/, BYTE data)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	if (rom.RamEnabled && rom.RamBank >= MBC3_CLOCK_REGISTER_START && rom.RamBank <= MBC3_CLOCK_REGISTER_END)
+	{
+		// the other registers keep counting from where they were (writing the seconds restarts the second)
+		UpdateClock();
+		if (rom.RamBank == MBC3_CLOCK_REGISTER_START) rom.ClockBase = Scheduler::Now();
+
+		rom.Clock[rom.RamBank - MBC3_CLOCK_REGISTER_START] = data;
+		rom.LatchedClock[rom.RamBank - MBC3_CLOCK_REGISTER_START] = data;
+	}
+}
@@ -0,0 +1,70 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: mbc5.cpp
+*/
+
+// includes
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include "include/gameboy.h"
+#include "include/memory.h"
+#include "include/mbc5.h"
+#include "include/log.h"
+#include "include/rom.h"
+
+// map the banks selected by the registers
+void Mbc5::Map()
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	Rom::MapRom(0x0000, 0);
+	Rom::MapRom(SWITCHABLE_ROM_ADDRESS, (rom.RomBankHigh << 8) | rom.RomBankLow);
+	Rom::MapRam(rom.RamBank);
+}
+
+// write to the mbc5 registers
+void Mbc5::Write(WORD address, BYTE data)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+
+	switch(address & 0x7000)
+	{
+		// ram enable
+		case 0x0000:
+		case 0x1000:
+		{
+			rom.RamEnabled = ((data & 0x0F) == 0x0A);
+			Rom::MapRam(rom.RamBank);
+		}
+		break;
+
+		// rom bank (lower 8 bits, bank 0 can be selected)
+		case 0x2000:
+		{
+			rom.RomBankLow = data;
+			Rom::MapRom(SWITCHABLE_ROM_ADDRESS, (rom.RomBankHigh << 8) | rom.RomBankLow);
+		}
+		break;
+
+		// rom bank (9th bit)
+		case 0x3000:
+		{
+			rom.RomBankHigh = (data & 0x01);
+			Rom::MapRom(SWITCHABLE_ROM_ADDRESS, (rom.RomBankHigh << 8) | rom.RomBankLow);
+		}
+		break;
+
+		// ram bank
+		case 0x4000:
+		case 0x5000:
+		{
+			rom.RamBank = (data & 0x0F);
+			Rom::MapRam(rom.RamBank);
+		}
+		break;
+
+		default: break;
+	}
+}
@@ -6,28 +6,157 @@
 
 // includes
 #include <cstdio>
+#include "include/bios.h"
 #include "include/cpu.h"
+#include "include/gameboy.h"
+#include "include/joypad.h"
 #include "include/memory.h"
 #include "include/log.h"
 #include "include/lcd.h"
 #include "include/timer.h"
 #include "include/rom.h"
+#include "include/scheduler.h"
 
-// initialize vars
-BYTE Memory::Mem[0x10000] = {0};
+// the memory bound to this thread
+thread_local Memory::State * Memory::current = NULL;
+
+// get the memory of the current machine
+BYTE * Memory::Get()
+{
+	return current->Mem;
+}
+
+// bind the memory of a machine to the calling thread
+void Memory::Bind(State &state)
+{
+	current = &state;
+}
+
+// build the page tables of a machine
+void Memory::Map(State &state)
+{
+	// everything is plain memory to begin with
+	for (int page = 0; page < MEMORY_PAGE_COUNT; page++)
+	{
+		state.ReadPage[page] = &state.Mem[page << MEMORY_PAGE_SHIFT];
+		state.WritePage[page] = &state.Mem[page << MEMORY_PAGE_SHIFT];
+		state.CodePage[page] = NULL;
+	}
+
+	// echo ram mirrors work ram
+	for (int page = (ECHO_RAM_START_ADDRESS >> MEMORY_PAGE_SHIFT); page <= (ECHO_RAM_END_ADDRESS >> MEMORY_PAGE_SHIFT); page++)
+	{
+		state.ReadPage[page] = &state.Mem[(page << MEMORY_PAGE_SHIFT) - ECHO_RAM_OFFSET];
+		state.WritePage[page] = &state.Mem[(page << MEMORY_PAGE_SHIFT) - ECHO_RAM_OFFSET];
+	}
+
+	// tile data is written through the handlers (so the lcd knows which tiles changed)
+	for (int page = (TILE_DATA_START_ADDRESS >> MEMORY_PAGE_SHIFT); page <= (TILE_DATA_END_ADDRESS >> MEMORY_PAGE_SHIFT); page++)
+	{
+		state.WritePage[page] = NULL;
+	}
+
+	// oam (protected memory) is written through the handlers
+	state.WritePage[0xFE] = NULL;
+	// the i/o registers are read and written through the handlers
+	state.ReadPage[0xFF] = NULL;
+	state.WritePage[0xFF] = NULL;
+	// the memory map changed
+	state.Generation += 1;
+}
+
+// map a range of pages for reading (NULL sends the range to the handlers)
+void Memory::MapRead(WORD address, int size, const BYTE *data)
+{
+	for (int offset = 0; offset < size; offset += (1 << MEMORY_PAGE_SHIFT))
+	{
+		current->ReadPage[(address + offset) >> MEMORY_PAGE_SHIFT] = (data != NULL) ? (data + offset) : NULL;
+		// any decoded code is of the old data
+		current->CodePage[(address + offset) >> MEMORY_PAGE_SHIFT] = NULL;
+	}
+
+	// the memory map changed
+	current->Generation += 1;
+}
+
+// map a range of pages for writing (NULL sends the range to the handlers)
+void Memory::MapWrite(WORD address, int size, BYTE *data)
+{
+	for (int offset = 0; offset < size; offset += (1 << MEMORY_PAGE_SHIFT))
+	{
+		current->WritePage[(address + offset) >> MEMORY_PAGE_SHIFT] = (data != NULL) ? (data + offset) : NULL;
+	}
+
+	// the memory map changed
+	current->Generation += 1;
+}
+
+// map the pre-decoded code of a range of pages (after it is mapped for reading)
+void Memory::MapCode(WORD address, int size, const Cpu::Decoded *code)
+{
+	for (int offset = 0; offset < size; offset += (1 << MEMORY_PAGE_SHIFT))
+	{
+		current->CodePage[(address + offset) >> MEMORY_PAGE_SHIFT] = (code != NULL) ? (code + offset) : NULL;
+	}
+
+	// the memory map changed
+	current->Generation += 1;
+}
+
+// start a new write epoch, returns the one that ended (the pages written from now on are dirty since it)
+unsigned int Memory::NextEpoch()
+{
+	unsigned int epoch = current->Epoch;
+	current->Epoch += 1;
+	return epoch;
+}
+
+// mark every page as written (when memory is replaced wholesale)
+void Memory::MarkAllPagesDirty()
+{
+	// in a new epoch, so the pages are dirty since any epoch handed out
+	current->Epoch += 1;
+
+	for (int i = 0; i < MEMORY_PAGE_COUNT; i++)
+	{
+		current->PageEpoch[i] = current->Epoch;
+	}
+}
 
 // init memory
 void Memory::Init()
 {
+	BYTE *Mem = Get();
+
 	for (int i = 0; i < 0x10000; i++)
 	{
 		Mem[i] = 0x00;
 	}
+
+	// every page has changed
+	MarkAllPagesDirty();
+
+	// rebuild the page tables
+	Map(*current);
 }
 
-// read memory
-BYTE Memory::ReadByte(WORD address)
+// read memory (for pages that need handling)
+BYTE Memory::ReadIo(WORD address)
 {
+	BYTE *Mem = Get();
+
+	// echo ram
+	if (address >= ECHO_RAM_START_ADDRESS && address <= ECHO_RAM_END_ADDRESS)
+	{
+		return Mem[address - ECHO_RAM_OFFSET];
+	}
+
+	// cartridge ram (disabled, missing or the mbc3 clock)
+	if (address >= 0xA000 && address <= 0xBFFF)
+	{
+		return Rom::ReadRam(address);
+	}
+
 	BYTE val = Mem[address];
 
 	// handle special cases
@@ -54,26 +183,32 @@ BYTE Memory::ReadByte(WORD address)
 			val = 0xFF;
 		break;
 
+		// the joypad lines are worked out from the buttons held
+		case JOYPAD_ADDRESS: val = Joypad::Read(); break;
+
+		// the divider and timer counter are worked out from the clock
+		case DIVIDER_ADDRESS: val = Timer::GetDivider(); break;
+		case TIMA_ADDRESS: val = Timer::GetTima(); break;
+
 		default: break;
 	}
 
 	return val;
 }
 
-// read word
-WORD Memory::ReadWord(WORD address)
+// write memory (for pages that need handling)
+void Memory::WriteIo(WORD address, BYTE data)
 {
-	return ((ReadByte(address + 1) << 8) | ReadByte(address));
-}
+	BYTE *Mem = Get();
 
-// write memory
-void Memory::Write(WORD address, BYTE data)
-{
 	//Log::Critical("Writing %02X to address %04X", data, address);
 	
 	// handle memory writing
 	switch(address)
 	{
+		// select the joypad's directions or buttons
+		case JOYPAD_ADDRESS: Joypad::Write(data); break;
+
 		// Get serial port output
 		case SERIAL_PORT_ADDRESS:
 		{
@@ -82,17 +217,11 @@ void Memory::Write(WORD address, BYTE data)
 		}
 		break;
 
-		// DMA
+		// DMA (the transfer completes DMA_CYCLES later)
 		case DMA_ADDRESS:
 		{
-			// get the address
-			WORD address = (data << 8);
-
-			// write the data
-			for (WORD i = 0; i < 0xA0; i++)
-			{
-				Mem[0xFE00 + i] = ReadByte(address + i);
-			}
+			Mem[address] = data;
+			Scheduler::Schedule(Scheduler::DMA, Scheduler::Now() + DMA_CYCLES);
 		}
 		break;
 
@@ -100,53 +229,73 @@ void Memory::Write(WORD address, BYTE data)
 		case INT_REQUEST_ADDRESS: Mem[address] = (data | 0xE0); break;
 
 		// update timer settings
-		case TAC_ADDRESS:
+		case TAC_ADDRESS: Timer::SetControl(data); break;
+
+		// the timer counter (counts on from the written value)
+		case TIMA_ADDRESS: Timer::SetTima(data); break;
+
+		// reset divider if written to
+		case DIVIDER_ADDRESS: Timer::ResetDivider(); break;
+
+		// turn the lcd on or off
+		case LCDC_ADDRESS:
 		{
-			BYTE currentFrequency = Timer::GetClockFrequency();
-			// write the new TAC data (upper 5 bits are fixed to one)
-			Mem[address] = (data | 0xF8);
-			BYTE newFrequency = Timer::GetClockFrequency();
+			BYTE currentLCDC = Mem[address];
+			Mem[address] = data;
 
-			if (newFrequency != currentFrequency)
+			if ((currentLCDC ^ data) & 0x80)
 			{
-				Timer::SetClockFrequency();
+				if (data & 0x80) Lcd::TurnOn(); else Lcd::TurnOff();
 			}
 		}
 		break;
 
-		// reset divider if written to
-		case DIVIDER_ADDRESS: Mem[address] = 0; break;
+		// the mode and coincidence bits of STAT are read-only
+		case STAT_ADDRESS: Mem[address] = ((data & 0x78) | (Mem[address] & 0x07) | 0x80); break;
 
 		// LY is read-only
 		case LY_ADDRESS: break;
 
+		// LYC (recheck the coincidence flag)
+		case LY_CP_ADDRESS:
+		{
+			Mem[address] = data;
+			if (Lcd::IsLCDEnabled()) Lcd::CheckCoincidence();
+		}
+		break;
+
 		// disable writes to protected memory
 		case PROTECTED_MEM_START_ADDRESS ... PROTECTED_MEM_END_ADDRESS: break;
 
 		// unmapped
 		case UNMAPPED_MEM_START_ADDRESS ... UNMAPPED_MEM_END_ADDRESS:
 		{
-			// copy rom back over bios
-			if (data == 0x1) Rom::Reload();
+			// remove the bios
+			if (data == 0x1) Bios::Remove();
 		}
 		break;
 
-		// echo ram (1)
-		case ECHO_RAM_1_START_ADDRESS ... ECHO_RAM_1_END_ADDRESS:
+		// echo ram
+		case ECHO_RAM_START_ADDRESS ... ECHO_RAM_END_ADDRESS:
 		{
-			Mem[address] = data;
-			Mem[address + 0x2000] = data;
+			Mem[address - ECHO_RAM_OFFSET] = data;
 		}
 		break;
 
-		// echo ram (2)
-		case ECHO_RAM_2_START_ADDRESS ... ECHO_RAM_2_END_ADDRESS:
+		// tile data (the lcd's decoded copy of the tile is now stale)
+		case TILE_DATA_START_ADDRESS ... TILE_DATA_END_ADDRESS:
 		{
 			Mem[address] = data;
-			Mem[address - 0x2000] = data;
+			Lcd::InvalidateTile(address);
 		}
 		break;
 
+		// cartridge (mapper) registers
+		case 0x0000 ... 0x7FFF: Rom::Write(address, data); break;
+
+		// cartridge ram (disabled, missing or the mbc3 clock)
+		case 0xA000 ... 0xBFFF: Rom::WriteRam(address, data); break;
+
 		// write
 		default:
 		{
@@ -156,6 +305,23 @@ void Memory::Write(WORD address, BYTE data)
 	}
 }
 
+// finish a DMA transfer (copies 0xA0 bytes into OAM)
+void Memory::FinishDma()
+{
+	BYTE *Mem = Get();
+	// get the address
+	WORD address = (Mem[DMA_ADDRESS] << 8);
+
+	// write the data
+	for (WORD i = 0; i < 0xA0; i++)
+	{
+		Mem[0xFE00 + i] = ReadByte(address + i);
+	}
+
+	// oam has changed
+	current->PageEpoch[0xFE] = current->Epoch;
+}
+
 // push
 void Memory::Push(WORD data)
 {
@@ -0,0 +1,365 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: movie.cpp
+*/
+
+// includes
+#include <stdio.h>
+#include <string.h>
+#include "include/cpu.h"
+#include "include/gameboy.h"
+#include "include/lcd.h"
+#include "include/log.h"
+#include "include/movie.h"
+#include "include/scheduler.h"
+
+// definitions
+#define HEADER_SIZE 36
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+// the inputs are queued up to a frame before they're due (so a run that overshoots its end doesn't make one late)
+#define QUEUE_AHEAD_CYCLES LCD_FRAME_CYCLES
+
+// mix bytes into a hash (fnv-1a)
+static void Mix(unsigned long long &hash, const void *data, size_t size)
+{
+	const BYTE *bytes = (const BYTE *)data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = ((hash ^ bytes[i]) * FNV_PRIME);
+	}
+}
+
+// mix a value into a hash
+template <typename T>
+static void Mix(unsigned long long &hash, T value)
+{
+	Mix(hash, &value, sizeof(T));
+}
+
+// append a number (7 bits a byte, the top bit set on every byte but the last)
+static void PutNumber(std::vector<BYTE> &data, unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back((BYTE)(value | 0x80));
+		value >>= 7;
+	}
+
+	data.push_back((BYTE)value);
+}
+
+// take a number, returns false if it runs past the end
+static bool GetNumber(const BYTE *&data, const BYTE *end, unsigned long long &value)
+{
+	value = 0;
+
+	for (int shift = 0; data < end && shift < 64; shift += 7)
+	{
+		BYTE byte = *data++;
+		value |= ((unsigned long long)(byte & 0x7F) << shift);
+		if ((byte & 0x80) == 0) return true;
+	}
+
+	return false;
+}
+
+// create a movie (neither recording nor playing)
+Movie::Movie() : Mode(IDLE), StartClock(0), StartHash(0), EndHash(0), Length(0), Next(0)
+{
+}
+
+// hash the state of the bound machine (only what decides how it runs on, and the screen)
+//
+// Caches and counters of the current run are left out, as are the timestamps
+// of the events that aren't scheduled, so machines that got to the same state
+// differently hash the same.
+unsigned long long Movie::Hash()
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	unsigned long long hash = FNV_OFFSET;
+
+	// the cpu (with F made current)
+	Cpu::State &cpu = gameBoy->CpuState;
+	Mix(hash, Cpu::Get::AF()->reg);
+	Mix(hash, cpu.PC);
+	Mix(hash, cpu.SP.reg);
+	Mix(hash, cpu.BC.reg);
+	Mix(hash, cpu.DE.reg);
+	Mix(hash, cpu.HL.reg);
+	Mix(hash, cpu.Operation.PendingInterruptEnabled);
+	Mix(hash, cpu.Operation.Stop);
+	Mix(hash, cpu.Operation.Halt);
+	Mix(hash, cpu.InterruptCounter);
+	Mix(hash, gameBoy->InterruptState.MasterSwitch);
+
+	// the timer
+	Timer::State &timer = gameBoy->TimerState;
+	Mix(hash, timer.DividerBase);
+	Mix(hash, timer.TimaBase);
+	Mix(hash, timer.Tima);
+	Mix(hash, timer.Period);
+
+	// the joypad
+	Joypad::State &joypad = gameBoy->JoypadState;
+	Mix(hash, joypad.Held);
+	Mix(hash, joypad.PendingCount);
+
+	for (int i = 0; i < joypad.PendingCount; i++)
+	{
+		Mix(hash, joypad.Pending[i].Timestamp);
+		Mix(hash, joypad.Pending[i].Button);
+		Mix(hash, joypad.Pending[i].Pressed);
+	}
+
+	// the hardware events
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	Mix(hash, scheduler.Clock);
+
+	for (int event = 0; event < Scheduler::EVENT_COUNT; event++)
+	{
+		Mix(hash, Scheduler::IsScheduled(event) ? scheduler.Timestamp[event] : SCHEDULER_NEVER);
+	}
+
+	// the cartridge
+	Rom::State &rom = gameBoy->RomState;
+	Mix(hash, rom.RamEnabled);
+	Mix(hash, rom.RomBankLow);
+	Mix(hash, rom.RomBankHigh);
+	Mix(hash, rom.RamBank);
+	Mix(hash, rom.BankingMode);
+	Mix(hash, rom.ClockLatch);
+	Mix(hash, rom.Clock, sizeof(rom.Clock));
+	Mix(hash, rom.LatchedClock, sizeof(rom.LatchedClock));
+	Mix(hash, rom.ClockBase);
+	Mix(hash, rom.Ram.data(), rom.Ram.size());
+	Mix(hash, gameBoy->BiosState.Mapped);
+
+	// the memory and the screen
+	BYTE screen[PACKED_SCREEN_SIZE];
+	Lcd::PackScreen(screen);
+	Mix(hash, gameBoy->MemoryState.Mem, sizeof(gameBoy->MemoryState.Mem));
+	Mix(hash, screen, PACKED_SCREEN_SIZE);
+
+	return hash;
+}
+
+// start recording the bound machine from its current state
+void Movie::StartRecording()
+{
+	Mode = RECORDING;
+	StartClock = Scheduler::Now();
+	StartHash = Hash();
+	Inputs.clear();
+}
+
+// record an input queued on the bound machine
+void Movie::Record(const Joypad::Input &input)
+{
+	if (Mode != RECORDING) return;
+
+	Joypad::Input recorded = input;
+	recorded.Timestamp -= StartClock;
+	Inputs.push_back(recorded);
+}
+
+// stop recording and write the movie to a file
+bool Movie::StopRecording(const char *fileName)
+{
+	if (Mode != RECORDING) return false;
+
+	Mode = IDLE;
+	EndHash = Hash();
+	Length = (Scheduler::Now() - StartClock);
+
+	// the header
+	std::vector<BYTE> data(HEADER_SIZE);
+	unsigned int version = MOVIE_VERSION;
+	unsigned int count = (unsigned int)Inputs.size();
+	memcpy(&data[0], MOVIE_MAGIC, 4);
+	memcpy(&data[4], &version, 4);
+	memcpy(&data[8], &StartHash, 8);
+	memcpy(&data[16], &EndHash, 8);
+	memcpy(&data[24], &Length, 8);
+	memcpy(&data[32], &count, 4);
+
+	// the inputs (the cycles since the one before, then the button with bit 7 set if it was pressed)
+	unsigned long long last = 0;
+
+	for (size_t i = 0; i < Inputs.size(); i++)
+	{
+		PutNumber(data, Inputs[i].Timestamp - last);
+		data.push_back((BYTE)(Inputs[i].Button | (Inputs[i].Pressed ? 0x80 : 0)));
+		last = Inputs[i].Timestamp;
+	}
+
+	FILE *fp = fopen(fileName, "wb");
+
+	if (fp == NULL)
+	{
+		Log::Error("Could not create movie %s", fileName);
+		return false;
+	}
+
+	bool written = (fwrite(data.data(), 1, data.size(), fp) == data.size());
+	written &= (fclose(fp) == 0);
+
+	if (!written) Log::Error("Could not write movie %s", fileName);
+
+	return written;
+}
+
+// start playing a movie back on the bound machine, returns false if it can't be read or starts from another state
+bool Movie::StartPlayback(const char *fileName)
+{
+	FILE *fp = fopen(fileName, "rb");
+
+	if (fp == NULL)
+	{
+		Log::Error("Could not open movie %s", fileName);
+		return false;
+	}
+
+	std::vector<BYTE> data;
+	BYTE buffer[0x4000];
+	size_t read;
+
+	while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + read);
+	}
+
+	fclose(fp);
+
+	// check the header
+	unsigned int version = 0;
+	unsigned int count = 0;
+
+	if (data.size() < HEADER_SIZE || memcmp(data.data(), MOVIE_MAGIC, 4) != 0)
+	{
+		Log::Error("Not a movie");
+		return false;
+	}
+
+	memcpy(&version, &data[4], 4);
+
+	if (version != MOVIE_VERSION)
+	{
+		Log::Error("Unsupported movie version %u (expected %u)", version, MOVIE_VERSION);
+		return false;
+	}
+
+	unsigned long long startHash, endHash, length;
+	memcpy(&startHash, &data[8], 8);
+	memcpy(&endHash, &data[16], 8);
+	memcpy(&length, &data[24], 8);
+	memcpy(&count, &data[32], 4);
+
+	// the inputs
+	std::vector<Joypad::Input> inputs;
+	const BYTE *position = &data[HEADER_SIZE];
+	const BYTE *end = data.data() + data.size();
+	unsigned long long timestamp = 0;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned long long delta;
+
+		if (!GetNumber(position, end, delta) || position >= end || (*position & 0x7F) >= Joypad::BUTTON_COUNT)
+		{
+			Log::Error("Truncated or corrupt movie");
+			return false;
+		}
+
+		timestamp += delta;
+		Joypad::Input input = {timestamp, (*position & 0x7F), (*position & 0x80) != 0};
+		inputs.push_back(input);
+		position++;
+	}
+
+	// the machine has to be in the state the movie was recorded from
+	if (Hash() != startHash)
+	{
+		Log::Error("The movie starts from a different state");
+		return false;
+	}
+
+	Mode = PLAYING;
+	StartClock = Scheduler::Now();
+	StartHash = startHash;
+	EndHash = endHash;
+	Length = length;
+	Inputs.swap(inputs);
+	Next = 0;
+
+	return true;
+}
+
+// queue the inputs due soon, returns the cycles to run next (no more than asked, and 0 once the movie is over)
+int Movie::Play(int cycles)
+{
+	if (Mode != PLAYING) return 0;
+
+	unsigned long long now = Scheduler::Now() - StartClock;
+
+	// a run ends after the cycle asked for, the inputs of the next one are queued too
+	while (Next < Inputs.size() && Inputs[Next].Timestamp < (now + cycles + QUEUE_AHEAD_CYCLES))
+	{
+		Joypad::Input input = Inputs[Next];
+		input.Timestamp += StartClock;
+
+		// wait for room (the input is applied late if it doesn't come in time, and the movie goes out of sync)
+		if (!Joypad::Queue(input)) break;
+
+		Next++;
+	}
+
+	if (now >= Length) return 0;
+
+	return (Length - now) < (unsigned long long)cycles ? (int)(Length - now) : cycles;
+}
+
+// stop playing, returns true if the movie ended at the cycle and state it was recorded at
+bool Movie::StopPlayback()
+{
+	if (Mode != PLAYING) return false;
+
+	Mode = IDLE;
+
+	unsigned long long length = (Scheduler::Now() - StartClock);
+
+	// stopped before the end (nothing to check)
+	if (length < Length)
+	{
+		Log::Warning("The movie was stopped at cycle %llu of %llu", length, Length);
+		return false;
+	}
+
+	if (length != Length)
+	{
+		Log::Error("The movie ended at cycle %llu, it was recorded to %llu", length, Length);
+		return false;
+	}
+
+	if (Hash() != EndHash)
+	{
+		Log::Error("The movie is out of sync (the end state is different)");
+		return false;
+	}
+
+	return true;
+}
+
+// is a movie being recorded?
+bool Movie::IsRecording() const
+{
+	return (Mode == RECORDING);
+}
+
+// is a movie being played back?
+bool Movie::IsPlaying() const
+{
+	return (Mode == PLAYING);
+}
@@ -0,0 +1,88 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: pacer.cpp
+*/
+
+// includes
+#include <thread>
+#include "include/gameboy.h"
+#include "include/lcd.h"
+#include "include/pacer.h"
+
+// create the pacer (in real time)
+Pacer::Pacer() : Mode(REAL_TIME), Multiplier(1.0), Cycles(0), ReportCycles(0), Speed(0.0)
+{
+	Restart();
+}
+
+// set the mode (the multiplier is only used by the multiplier mode)
+void Pacer::SetMode(int mode, double multiplier)
+{
+	Mode = mode;
+	Multiplier = (multiplier > 0) ? multiplier : 1.0;
+	Restart();
+}
+
+// get the mode
+int Pacer::GetMode() const
+{
+	return Mode;
+}
+
+// get the multiplier
+double Pacer::GetMultiplier() const
+{
+	return Multiplier;
+}
+
+// start pacing again from now (after a pause)
+void Pacer::Restart()
+{
+	Start = Clock::now();
+	Cycles = 0;
+	ReportStart = Start;
+	ReportCycles = 0;
+}
+
+// account for the cycles ran, waiting until they are due
+void Pacer::Pace(int cycles)
+{
+	Clock::time_point now = Clock::now();
+
+	Cycles += cycles;
+	ReportCycles += cycles;
+
+	// measure the speed
+	std::chrono::duration<double> reportElapsed = (now - ReportStart);
+
+	if (reportElapsed >= std::chrono::milliseconds(PACER_REPORT_MILLISECONDS))
+	{
+		Speed = ((double)ReportCycles / CLOCK_SPEED) / reportElapsed.count();
+		ReportStart = now;
+		ReportCycles = 0;
+	}
+
+	// run as fast as possible
+	if (Mode == UNCAPPED) return;
+
+	// when the cycles ran are due
+	double rate = (Mode == MULTIPLIER) ? (CLOCK_SPEED * Multiplier) : CLOCK_SPEED;
+	Clock::time_point due = Start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(Cycles / rate));
+
+	// too far behind, don't try to catch up
+	if ((now - due) > std::chrono::duration<double>((LCD_FRAME_CYCLES * PACER_MAX_FRAMES_BEHIND) / rate))
+	{
+		Start = now;
+		Cycles = 0;
+		return;
+	}
+
+	std::this_thread::sleep_until(due);
+}
+
+// get the speed measured over the last report interval (1.0 is the real hardware)
+double Pacer::GetSpeed() const
+{
+	return Speed;
+}
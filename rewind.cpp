@@ -0,0 +1,235 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: rewind.cpp
+*/
+
+// includes
+#include <string.h>
+#include "include/rewind.h"
+#include "include/saveState.h"
+
+// append a number (7 bits a byte, the top bit set on every byte but the last)
+static void PutNumber(std::vector<BYTE> &data, size_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back((BYTE)(value | 0x80));
+		value >>= 7;
+	}
+
+	data.push_back((BYTE)value);
+}
+
+// take a number
+static size_t GetNumber(const BYTE *&data)
+{
+	size_t value = 0;
+
+	for (int shift = 0; ; shift += 7)
+	{
+		BYTE byte = *data++;
+		value |= ((size_t)(byte & 0x7F) << shift);
+		if ((byte & 0x80) == 0) break;
+	}
+
+	return value;
+}
+
+// create the buffer (the budget is in bytes, the interval in snapshots)
+Rewind::Rewind(size_t budget, int keyframeInterval) : Budget(budget), KeyframeInterval(keyframeInterval), Size(0), Deltas(0), Epoch(0)
+{
+	if (KeyframeInterval < 1) KeyframeInterval = 1;
+}
+
+// skip the unchanged bytes from a position (8 at a time while they match), returns where they end
+static size_t SkipUnchanged(const BYTE *state, const BYTE *base, size_t position, size_t size)
+{
+	static const BYTE zeros[8] = {0};
+
+	while ((position + 8) <= size && memcmp(&state[position], base ? &base[position] : zeros, 8) == 0) position += 8;
+	while (position < size && state[position] == (base ? base[position] : 0)) position++;
+
+	return position;
+}
+
+// encode a state as runs of unchanged bytes and the changed bytes between them (a NULL base encodes against zeros)
+void Rewind::Encode(const std::vector<BYTE> &state, const std::vector<BYTE> *base, std::vector<BYTE> &encoded)
+{
+	size_t size = state.size();
+	size_t position = 0;
+
+	encoded.clear();
+	PutNumber(encoded, size);
+
+	while (position < size)
+	{
+		// the unchanged bytes
+		size_t start = position;
+		position = SkipUnchanged(state.data(), base ? base->data() : NULL, position, size);
+		PutNumber(encoded, position - start);
+
+		// the changed bytes (a single unchanged byte doesn't end them, it costs less than a new run)
+		start = position;
+		while (position < size)
+		{
+			if (state[position] == (base ? (*base)[position] : 0))
+			{
+				if ((position + 1) >= size || state[position + 1] == (base ? (*base)[position + 1] : 0)) break;
+			}
+
+			position++;
+		}
+
+		PutNumber(encoded, position - start);
+
+		for (size_t i = start; i < position; i++)
+		{
+			encoded.push_back(state[i] ^ (base ? (*base)[i] : 0));
+		}
+	}
+}
+
+// decode a state encoded by Encode against the same base
+void Rewind::Decode(const std::vector<BYTE> &encoded, const std::vector<BYTE> *base, std::vector<BYTE> &state)
+{
+	const BYTE *data = encoded.data();
+	const BYTE *end = data + encoded.size();
+	size_t size = GetNumber(data);
+	size_t position = 0;
+
+	if (base) state.assign(base->begin(), base->end()); else state.assign(size, 0);
+
+	while (data < end)
+	{
+		position += GetNumber(data);
+		size_t count = GetNumber(data);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			state[position++] ^= *data++;
+		}
+	}
+}
+
+// decode the newest keyframe left in the buffer
+void Rewind::DecodeKeyframe()
+{
+	Deltas = 0;
+
+	for (std::deque<Snapshot>::reverse_iterator snapshot = Snapshots.rbegin(); snapshot != Snapshots.rend(); ++snapshot)
+	{
+		if (snapshot->Keyframe)
+		{
+			Decode(snapshot->Data, NULL, Keyframe);
+			return;
+		}
+
+		Deltas++;
+	}
+
+	Keyframe.clear();
+}
+
+// save the bound machine into the buffer
+void Rewind::Push()
+{
+	// only the memory written since the last push is saved again
+	SaveState::Update(State, Epoch);
+
+	// a keyframe every interval (or when the state's size changes, as the deltas can't span that)
+	bool keyframe = (Keyframe.empty() || Deltas >= (KeyframeInterval - 1) || Keyframe.size() != State.size());
+
+	Encode(State, keyframe ? NULL : &Keyframe, Encoded);
+
+	Snapshot snapshot;
+	snapshot.Keyframe = keyframe;
+	snapshot.Data.assign(Encoded.begin(), Encoded.end());
+	Size += snapshot.Data.size();
+	Snapshots.push_back(std::move(snapshot));
+
+	if (keyframe)
+	{
+		Keyframe = State;
+		Deltas = 0;
+	}
+	else
+	{
+		Deltas++;
+	}
+
+	// drop the oldest keyframe and its deltas while over budget (the newest keyframe is always kept)
+	while (Size > Budget)
+	{
+		size_t next = 1;
+		while (next < Snapshots.size() && !Snapshots[next].Keyframe) next++;
+		if (next >= Snapshots.size()) break;
+
+		for (size_t i = 0; i < next; i++)
+		{
+			Size -= Snapshots.front().Data.size();
+			Snapshots.pop_front();
+		}
+	}
+}
+
+// load the newest snapshot into the bound machine and remove it, returns false if the buffer is empty
+bool Rewind::Pop()
+{
+	if (Snapshots.empty()) return false;
+
+	Snapshot &snapshot = Snapshots.back();
+	bool loaded;
+
+	if (snapshot.Keyframe)
+	{
+		loaded = SaveState::Load(Keyframe.data(), Keyframe.size());
+	}
+	else
+	{
+		Decode(snapshot.Data, &Keyframe, State);
+		loaded = SaveState::Load(State.data(), State.size());
+	}
+
+	Size -= snapshot.Data.size();
+
+	// the deltas before a keyframe are against the keyframe before them
+	if (snapshot.Keyframe)
+	{
+		Snapshots.pop_back();
+		DecodeKeyframe();
+	}
+	else
+	{
+		Snapshots.pop_back();
+		Deltas--;
+	}
+
+	// a snapshot that doesn't load (of another rom) empties the buffer
+	if (!loaded) Clear();
+
+	return loaded;
+}
+
+// empty the buffer
+void Rewind::Clear()
+{
+	Snapshots.clear();
+	Size = 0;
+	Keyframe.clear();
+	Deltas = 0;
+	// the next push saves the machine in full
+	State.clear();
+}
+
+// get the number of snapshots held
+int Rewind::GetCount() const
+{
+	return (int)Snapshots.size();
+}
+
+// get the bytes held by the snapshots
+size_t Rewind::GetSize() const
+{
+	return Size;
+}
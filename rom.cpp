@@ -8,21 +8,99 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define ROM_USE_MMAP
+#endif
+#include "include/bios.h"
+#include "include/gameboy.h"
+#include "include/mbc1.h"
+#include "include/mbc3.h"
+#include "include/mbc5.h"
 #include "include/memory.h"
 #include "include/rom.h"
 #include "include/log.h"
+#include "include/scheduler.h"
 
-// The current rom name
-const char *Rom::currentRomFileName = NULL;
-//BYTE Rom::cartridgeMem[0x200000] = {0}; 
+// a rom file's device, inode, size and modification time (seconds and nanoseconds), so a rewritten file is loaded again
+typedef std::tuple<unsigned long long, unsigned long long, long long, long long, long long> FileIdentity;
 
-// load a rom
-bool Rom::Load(const char *fileName)
+// loaded rom images, shared between machines
+static std::map<FileIdentity, std::weak_ptr<const Rom::Image> > images;
+static std::mutex imagesLock;
+
+// get the identity of an open file, returns false if it can't be told
+static bool GetFileIdentity(FILE *file, FileIdentity &identity)
+{
+	struct stat info;
+	long long nanoseconds = 0;
+
+	if (fstat(fileno(file), &info) != 0) return false;
+
+#if defined(__linux__)
+	nanoseconds = info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+	nanoseconds = info.st_mtimespec.tv_nsec;
+#endif
+
+	identity = FileIdentity(info.st_dev, info.st_ino, info.st_size, info.st_mtime, nanoseconds);
+
+	return true;
+}
+
+// # Getters # //
+
+// the current rom name
+const char * Rom::Get::FileName()
+{
+	const Image *image = GameBoy::Current()->RomState.CurrentImage.get();
+
+	return (image != NULL) ? image->FileName.c_str() : NULL;
+}
+
+// create an empty rom image
+Rom::Image::Image() : Data(NULL), Size(0), Mapping(NULL), MappingSize(0)
 {
-	// the result of the load
-	bool loadResult = false;
-	// set the cartridge memory
-	//memset(cartridgeMem, 0, sizeof(cartridgeMem));
+}
+
+// destroy a rom image
+Rom::Image::~Image()
+{
+#if defined(ROM_USE_MMAP)
+	if (Mapping != NULL) munmap(Mapping, MappingSize);
+#endif
+}
+
+// get the decoded code of a bank, decoding it the first time (instructions don't run across banks, as the next bank may not be mapped after it)
+const Cpu::Decoded *Rom::Image::GetCode(int bank) const
+{
+	std::lock_guard<std::mutex> lock(CodeLock);
+
+	if (!Code[bank])
+	{
+		Code[bank].reset(new Cpu::Decoded[ROM_BANK_SIZE]);
+		Cpu::Decode(&Data[bank * ROM_BANK_SIZE], ROM_BANK_SIZE, Code[bank].get());
+	}
+
+	return Code[bank].get();
+}
+
+// load a rom image (or reuse it, if another machine already loaded the same file, unchanged)
+std::shared_ptr<const Rom::Image> Rom::LoadImage(const char *fileName)
+{
+	std::lock_guard<std::mutex> lock(imagesLock);
+	std::shared_ptr<const Image> image;
+
+	// forget the images no machine uses any more
+	for (auto it = images.begin(); it != images.end();)
+	{
+		if (it->second.expired()) it = images.erase(it);
+		else ++it;
+	}
 
 	// open the gb rom
 	FILE *gbRom = fopen(fileName, "rb");
@@ -30,48 +108,267 @@ bool Rom::Load(const char *fileName)
 	// ensure the file exists
 	if (gbRom)
 	{
-		Log::Normal("loaded rom '%s' successfully", fileName);
-		// the rom was loaded successfully
-		loadResult = true;
-		// read the rom into memory
-		//fread(&Memory::Get()[0x00], 1, 0x3FFF, gbRom);
-		fread(&Memory::Mem[0x00], 1, 0x8000, gbRom);
-
-		// Set the current rom name
-		currentRomFileName = fileName;
-
-		/*
-		// print the rom name
-		printf("Rom Name: ");
-		for (unsigned short i = 0x0134; i < 0x0143; i++)
+		FileIdentity identity;
+		bool identified = GetFileIdentity(gbRom, identity);
+
+		auto loaded = identified ? images.find(identity) : images.end();
+
+		// the image is already loaded
+		if (loaded != images.end() && (image = loaded->second.lock()))
+		{
+			fclose(gbRom);
+			return image;
+		}
+
+		std::shared_ptr<Image> newImage = std::make_shared<Image>();
+		newImage->FileName = fileName;
+
+		// get the size of the rom
+		fseek(gbRom, 0, SEEK_END);
+		long size = ftell(gbRom);
+		fseek(gbRom, 0, SEEK_SET);
+
+#if defined(ROM_USE_MMAP)
+		// map the rom straight from the file (any rom made of whole banks)
+		if (size >= (ROM_BANK_SIZE * 2) && (size % ROM_BANK_SIZE) == 0)
+		{
+			void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(gbRom), 0);
+
+			if (mapping != MAP_FAILED)
+			{
+				newImage->Mapping = mapping;
+				newImage->MappingSize = size;
+				newImage->Data = (const BYTE *)mapping;
+				newImage->Size = size;
+			}
+		}
+#endif
+
+		// otherwise read the rom, padded to whole banks (at least two) so every bank can be mapped
+		if (newImage->Data == NULL)
+		{
+			size_t banks = (((size > 0) ? size : 0) + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE;
+			newImage->Buffer.assign(((banks < 2) ? 2 : banks) * ROM_BANK_SIZE, 0xFF);
+			newImage->Data = &newImage->Buffer[0];
+			newImage->Size = newImage->Buffer.size();
+
+			if (size > 0 && fread(&newImage->Buffer[0], 1, size, gbRom) != (size_t)size)
+			{
+				newImage.reset();
+			}
+		}
+
+		// close the rom (the mapping stays valid)
+		fclose(gbRom);
+
+		// the banks are decoded as they're mapped
+		if (newImage)
 		{
-			printf("%c", Memory::Get()[i]);
+			newImage->Code.resize(newImage->Size / ROM_BANK_SIZE);
 		}
-		printf("\n");
 
-		// print the rom cartridge type
-		printf("Rom Cartridge Type: %02x | Rom-Size: %02x | Ram-Size: %02x\n", Memory::Get()[0x0147], Memory::Get()[0x0148], Memory::Get()[0x0149]);
-		*/
+		image = newImage;
+		if (identified && image) images[identity] = image;
 	}
-	else
+
+	return image;
+}
+
+// load a rom
+bool Rom::Load(const char *fileName)
+{
+	// load (or share) the rom image
+	std::shared_ptr<const Image> image = LoadImage(fileName);
+
+	// ensure the file exists
+	if (!image)
 	{
 		Log::Critical("FAILED TO LOAD rom '%s'", fileName);
+		return false;
+	}
+
+	Log::Normal("loaded rom '%s' successfully", fileName);
+	// set the current rom
+	State &rom = GameBoy::Current()->RomState;
+	rom.CurrentImage = image;
+	// read the cartridge header
+	rom.Mbc = GetMbc(image->Data[CARTRIDGE_TYPE_ADDRESS]);
+	rom.RomBankCount = (int)(image->Size / ROM_BANK_SIZE);
+	rom.Ram.assign(GetRamSize(image->Data[RAM_SIZE_ADDRESS]), 0x00);
+	rom.RamBankCount = (int)(rom.Ram.size() / RAM_BANK_SIZE);
+	// power on the cartridge
+	Reset();
+
+	/*
+	// print the rom name
+	printf("Rom Name: ");
+	for (unsigned short i = 0x0134; i < 0x0143; i++)
+	{
+		printf("%c", Memory::Get()[i]);
 	}
+	printf("\n");
 
-	// close the rom
-	fclose(gbRom);
-	
-	return loadResult;
+	// print the rom cartridge type
+	printf("Rom Cartridge Type: %02x | Rom-Size: %02x | Ram-Size: %02x\n", Memory::Get()[0x0147], Memory::Get()[0x0148], Memory::Get()[0x0149]);
+	*/
+
+	return true;
+}
+
+// get the mapper from the cartridge type
+int Rom::GetMbc(BYTE cartridgeType)
+{
+	switch(cartridgeType)
+	{
+		case 0x00: case 0x08: case 0x09: return MBC_NONE;
+		case 0x01 ... 0x03: return MBC_1;
+		case 0x0F ... 0x13: return MBC_3;
+		case 0x19 ... 0x1E: return MBC_5;
+
+		default:
+		{
+			Log::Critical("cartridge type %02X is not supported, running it without a mapper", cartridgeType);
+		}
+		break;
+	}
+
+	return MBC_NONE;
+}
+
+// get the cartridge ram size (mapped ram is always at least one whole bank)
+int Rom::GetRamSize(BYTE ramSize)
+{
+	switch(ramSize)
+	{
+		case 0x01: case 0x02: return RAM_BANK_SIZE;
+		case 0x03: return (RAM_BANK_SIZE * 4);
+		case 0x04: return (RAM_BANK_SIZE * 16);
+		case 0x05: return (RAM_BANK_SIZE * 8);
+		default: break;
+	}
+
+	return 0;
+}
+
+// reset the cartridge to its power on state
+void Rom::Reset()
+{
+	State &rom = GameBoy::Current()->RomState;
+
+	rom.RamEnabled = false;
+	rom.RomBankLow = 1;
+	rom.RomBankHigh = 0;
+	rom.RamBank = 0;
+	rom.BankingMode = 0;
+	rom.ClockLatch = 0;
+	memset(rom.Clock, 0, sizeof(rom.Clock));
+	memset(rom.LatchedClock, 0, sizeof(rom.LatchedClock));
+	rom.ClockBase = Scheduler::Now();
+
+	// map the banks
+	Map();
+}
+
+// map the cartridge into the page tables
+void Rom::Map()
+{
+	State &rom = GameBoy::Current()->RomState;
+
+	if (!rom.CurrentImage) return;
+
+	// rom is read-only, writes go to the mapper
+	Memory::MapWrite(0x0000, (ROM_BANK_SIZE * 2), NULL);
+
+	switch(rom.Mbc)
+	{
+		case MBC_1: Mbc1::Map(); break;
+		case MBC_3: Mbc3::Map(); break;
+		case MBC_5: Mbc5::Map(); break;
+
+		// no mapper, 32kb of rom and plain ram
+		default:
+		{
+			MapRom(0x0000, 0);
+			MapRom(SWITCHABLE_ROM_ADDRESS, 1);
+			Memory::MapRead(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, &Memory::Get()[CARTRIDGE_RAM_ADDRESS]);
+			Memory::MapWrite(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, &Memory::Get()[CARTRIDGE_RAM_ADDRESS]);
+		}
+		break;
+	}
+}
+
+// map a rom bank at 0x0000 or 0x4000
+void Rom::MapRom(WORD address, int bank)
+{
+	State &rom = GameBoy::Current()->RomState;
+	bank %= rom.RomBankCount;
+
+	const Image &image = *rom.CurrentImage;
+
+	Memory::MapRead(address, ROM_BANK_SIZE, &image.Data[bank * ROM_BANK_SIZE]);
+	Memory::MapCode(address, ROM_BANK_SIZE, image.GetCode(bank));
+	rom.MappedBanks[address / ROM_BANK_SIZE] = bank;
+
+	// the bios sits on top of the bank at 0x0000 until it is removed
+	if (address == 0x0000) Bios::Map();
+}
+
+// map a cartridge ram bank at 0xA000 (a negative bank leaves the ram to the handlers)
+void Rom::MapRam(int bank)
+{
+	State &rom = GameBoy::Current()->RomState;
+
+	if (rom.RamEnabled && rom.RamBankCount > 0 && bank >= 0)
+	{
+		BYTE *data = &rom.Ram[(bank % rom.RamBankCount) * RAM_BANK_SIZE];
+		Memory::MapRead(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, data);
+		Memory::MapWrite(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, data);
+	}
+	else
+	{
+		Memory::MapRead(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, NULL);
+		Memory::MapWrite(CARTRIDGE_RAM_ADDRESS, RAM_BANK_SIZE, NULL);
+	}
+}
+
+// write to the mapper registers
+void Rom::Write(WORD address, BYTE data)
+{
+	switch(GameBoy::Current()->RomState.Mbc)
+	{
+		case MBC_1: Mbc1::Write(address, data); break;
+		case MBC_3: Mbc3::Write(address, data); break;
+		case MBC_5: Mbc5::Write(address, data); break;
+		default: break;
+	}
 }
 
-// reload a rom
-void Rom::Reload()
+// read unmapped cartridge ram
+BYTE Rom::ReadRam(WORD address)
 {
-	Rom::Load(currentRomFileName);
+	if (GameBoy::Current()->RomState.Mbc == MBC_3)
+	{
+		return Mbc3::ReadRam(address);
+	}
+
+	return 0xFF;
+}
+
+// write unmapped cartridge ram
+void Rom::WriteRam(WORD address, BYTE data)
+{
+	if (GameBoy::Current()->RomState.Mbc == MBC_3)
+	{
+		Mbc3::WriteRam(address, data);
+	}
 }
 
 // close a rom
 void Rom::Close()
 {
+	GameBoy *gameBoy = GameBoy::Current();
 
+	// unmap the cartridge before dropping the image
+	Memory::Map(gameBoy->MemoryState);
+	gameBoy->RomState.CurrentImage.reset();
 }
@@ -0,0 +1,662 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: saveState.cpp
+*/
+
+// includes
+#include <stdio.h>
+#include <string.h>
+#include "include/bios.h"
+#include "include/gameboy.h"
+#include "include/joypad.h"
+#include "include/lcd.h"
+#include "include/log.h"
+#include "include/memory.h"
+#include "include/rom.h"
+#include "include/saveState.h"
+
+// definitions
+#define HEADER_SIZE 8
+#define CHUNK_HEADER_SIZE 8
+// the part of the rom header that identifies the game (the title to the global checksum)
+#define ROM_HEADER_ADDRESS 0x0134
+#define ROM_HEADER_SIZE 0x1C
+// the size of the rom identity at the start of the rom chunk
+#define ROM_IDENTITY_SIZE (sizeof(unsigned long long) + ROM_HEADER_SIZE)
+
+// the chunks of a state, in the order they are saved
+enum Chunks
+{
+	CHUNK_ROM, CHUNK_CPU, CHUNK_INT, CHUNK_TIME, CHUNK_JOYP, CHUNK_SCHD, CHUNK_BIOS, CHUNK_MEM, CHUNK_LCD, CHUNK_COUNT
+};
+
+static const char *CHUNK_IDS[CHUNK_COUNT] = {"ROM ", "CPU ", "INT ", "TIME", "JOYP", "SCHD", "BIOS", "MEM ", "LCD "};
+
+// a state being written (appended, or updated in place over the previous state)
+struct Writer
+{
+	std::vector<BYTE> &Data;
+	size_t Position;
+	// only the memory pages (and cartridge ram) written since the previous state's epoch are written again
+	bool Incremental;
+	unsigned int Since;
+};
+
+// a chunk being read
+struct Reader
+{
+	const BYTE *Data;
+	size_t Size;
+	size_t Position;
+};
+
+// # Writing # //
+
+// write bytes
+static void Put(Writer &writer, const void *value, size_t size)
+{
+	if ((writer.Position + size) > writer.Data.size()) writer.Data.resize(writer.Position + size);
+
+	memcpy(&writer.Data[writer.Position], value, size);
+	writer.Position += size;
+}
+
+// write a value
+template <typename T>
+static void Put(Writer &writer, T value)
+{
+	Put(writer, &value, sizeof(T));
+}
+
+// leave bytes as they are (only when updating)
+static void Skip(Writer &writer, size_t size)
+{
+	writer.Position += size;
+}
+
+// start a chunk, returns where its size goes
+static size_t BeginChunk(Writer &writer, const char *id)
+{
+	Put(writer, id, 4);
+	Put(writer, (unsigned int)0);
+	return writer.Position - 4;
+}
+
+// finish a chunk (fills in its size)
+static void EndChunk(Writer &writer, size_t position)
+{
+	unsigned int size = (unsigned int)(writer.Position - position - 4);
+	memcpy(&writer.Data[position], &size, 4);
+}
+
+// # Reading # //
+
+// take bytes
+static void Get(Reader &reader, void *value, size_t size)
+{
+	memcpy(value, &reader.Data[reader.Position], size);
+	reader.Position += size;
+}
+
+// take a value
+template <typename T>
+static T Get(Reader &reader)
+{
+	T value;
+	Get(reader, &value, sizeof(T));
+	return value;
+}
+
+// find a chunk (the chunks have already been checked to be in bounds)
+static Reader FindChunk(const BYTE *data, size_t size, const char *id)
+{
+	Reader reader = {NULL, 0, 0};
+	size_t position = HEADER_SIZE;
+
+	while (position < size)
+	{
+		unsigned int chunkSize;
+		memcpy(&chunkSize, &data[position + 4], 4);
+
+		if (memcmp(&data[position], id, 4) == 0)
+		{
+			reader.Data = &data[position + CHUNK_HEADER_SIZE];
+			reader.Size = chunkSize;
+			return reader;
+		}
+
+		position += (CHUNK_HEADER_SIZE + chunkSize);
+	}
+
+	return reader;
+}
+
+// # Subsystems # //
+
+// the size of a chunk of the bound machine's state (fixed, but for the cartridge ram, which comes with the rom)
+static size_t GetChunkSize(int chunk)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	const Rom::State &rom = gameBoy->RomState;
+	const Cpu::State &cpu = gameBoy->CpuState;
+	const Interrupt::State &interrupt = gameBoy->InterruptState;
+	const Timer::State &timer = gameBoy->TimerState;
+	const Joypad::State &joypad = gameBoy->JoypadState;
+	const Scheduler::State &scheduler = gameBoy->SchedulerState;
+	const Bios::State &bios = gameBoy->BiosState;
+	const Joypad::Input &input = joypad.Pending[0];
+
+	switch(chunk)
+	{
+		case CHUNK_ROM:
+		{
+			return ROM_IDENTITY_SIZE + sizeof(rom.RamEnabled) + sizeof(rom.RomBankLow) + sizeof(rom.RomBankHigh) + sizeof(rom.RamBank) +
+				sizeof(rom.BankingMode) + sizeof(rom.ClockLatch) + sizeof(rom.Clock) + sizeof(rom.LatchedClock) + sizeof(rom.ClockBase) +
+				sizeof(unsigned int) + rom.Ram.size();
+		}
+
+		case CHUNK_CPU:
+		{
+			return sizeof(cpu.PC) + sizeof(cpu.SP.reg) + sizeof(cpu.AF.reg) + sizeof(cpu.BC.reg) + sizeof(cpu.DE.reg) + sizeof(cpu.HL.reg) +
+				sizeof(cpu.Operation.PendingInterruptEnabled) + sizeof(cpu.Operation.Stop) + sizeof(cpu.Operation.Halt) +
+				sizeof(cpu.Flags.Operation) + sizeof(cpu.Flags.Val) + sizeof(cpu.Flags.Val2) + sizeof(cpu.Flags.Carry) + sizeof(cpu.Flags.Result) +
+				sizeof(cpu.Cycles) + sizeof(cpu.Operand) + sizeof(cpu.InterruptCounter);
+		}
+
+		case CHUNK_INT: return sizeof(interrupt.MasterSwitch) + sizeof(interrupt.WasHalted);
+		case CHUNK_TIME: return sizeof(timer.DividerBase) + sizeof(timer.TimaBase) + sizeof(timer.Tima) + sizeof(timer.Period);
+		case CHUNK_JOYP: return sizeof(joypad.Held) + sizeof(joypad.PendingCount) + (JOYPAD_MAX_PENDING * (sizeof(input.Timestamp) + sizeof(input.Button) + sizeof(input.Pressed)));
+		case CHUNK_SCHD: return sizeof(scheduler.Clock) + sizeof(scheduler.NextEvent) + sizeof(scheduler.Count) + sizeof(scheduler.Heap) + sizeof(scheduler.Position) + sizeof(scheduler.Timestamp);
+		case CHUNK_BIOS: return sizeof(bios.Mapped) + sizeof(bios.Data);
+		case CHUNK_MEM: return sizeof(gameBoy->MemoryState.Mem);
+		case CHUNK_LCD: return PACKED_SCREEN_SIZE;
+	}
+
+	return 0;
+}
+
+// the rom identity (its size and header, so a state only loads into the same game)
+static void PutRomIdentity(Writer &writer)
+{
+	Rom::State &rom = GameBoy::Current()->RomState;
+	BYTE header[ROM_HEADER_SIZE] = {0};
+	unsigned long long romSize = 0;
+
+	if (rom.CurrentImage && rom.CurrentImage->Size >= (ROM_HEADER_ADDRESS + ROM_HEADER_SIZE))
+	{
+		romSize = rom.CurrentImage->Size;
+		memcpy(header, &rom.CurrentImage->Data[ROM_HEADER_ADDRESS], ROM_HEADER_SIZE);
+	}
+
+	Put(writer, romSize);
+	Put(writer, header, ROM_HEADER_SIZE);
+}
+
+// save the state of every subsystem
+static void PutChunks(Writer &writer)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	size_t chunk;
+
+	// the rom identity and the cartridge (mapper registers, ram and clock)
+	Rom::State &rom = gameBoy->RomState;
+	chunk = BeginChunk(writer, "ROM ");
+	PutRomIdentity(writer);
+	Put(writer, rom.RamEnabled);
+	Put(writer, rom.RomBankLow);
+	Put(writer, rom.RomBankHigh);
+	Put(writer, rom.RamBank);
+	Put(writer, rom.BankingMode);
+	Put(writer, rom.ClockLatch);
+	Put(writer, rom.Clock, sizeof(rom.Clock));
+	Put(writer, rom.LatchedClock, sizeof(rom.LatchedClock));
+	Put(writer, rom.ClockBase);
+	Put(writer, (unsigned int)rom.Ram.size());
+
+	// the cartridge ram can only have changed if its pages were written
+	bool ramDirty = !writer.Incremental;
+
+	for (int page = (CARTRIDGE_RAM_ADDRESS >> MEMORY_PAGE_SHIFT); page < ((CARTRIDGE_RAM_ADDRESS + RAM_BANK_SIZE) >> MEMORY_PAGE_SHIFT); page++)
+	{
+		ramDirty |= Memory::IsPageDirty(page, writer.Since);
+	}
+
+	if (ramDirty) Put(writer, rom.Ram.data(), rom.Ram.size()); else Skip(writer, rom.Ram.size());
+	EndChunk(writer, chunk);
+
+	// the cpu
+	Cpu::State &cpu = gameBoy->CpuState;
+	chunk = BeginChunk(writer, "CPU ");
+	Put(writer, cpu.PC);
+	Put(writer, cpu.SP.reg);
+	Put(writer, cpu.AF.reg);
+	Put(writer, cpu.BC.reg);
+	Put(writer, cpu.DE.reg);
+	Put(writer, cpu.HL.reg);
+	Put(writer, cpu.Operation.PendingInterruptEnabled);
+	Put(writer, cpu.Operation.Stop);
+	Put(writer, cpu.Operation.Halt);
+	Put(writer, cpu.Flags.Operation);
+	Put(writer, cpu.Flags.Val);
+	Put(writer, cpu.Flags.Val2);
+	Put(writer, cpu.Flags.Carry);
+	Put(writer, cpu.Flags.Result);
+	Put(writer, cpu.Cycles);
+	Put(writer, cpu.Operand);
+	Put(writer, cpu.InterruptCounter);
+	EndChunk(writer, chunk);
+
+	// the interrupts
+	Interrupt::State &interrupt = gameBoy->InterruptState;
+	chunk = BeginChunk(writer, "INT ");
+	Put(writer, interrupt.MasterSwitch);
+	Put(writer, interrupt.WasHalted);
+	EndChunk(writer, chunk);
+
+	// the timer
+	Timer::State &timer = gameBoy->TimerState;
+	chunk = BeginChunk(writer, "TIME");
+	Put(writer, timer.DividerBase);
+	Put(writer, timer.TimaBase);
+	Put(writer, timer.Tima);
+	Put(writer, timer.Period);
+	EndChunk(writer, chunk);
+
+	// the joypad (the group select is in memory), and the inputs waiting for their cycle
+	Joypad::State &joypad = gameBoy->JoypadState;
+	chunk = BeginChunk(writer, "JOYP");
+	Put(writer, joypad.Held);
+	Put(writer, joypad.PendingCount);
+
+	for (int i = 0; i < JOYPAD_MAX_PENDING; i++)
+	{
+		// the slots not in use are written empty
+		Joypad::Input input = (i < joypad.PendingCount) ? joypad.Pending[i] : Joypad::Input();
+		Put(writer, input.Timestamp);
+		Put(writer, input.Button);
+		Put(writer, input.Pressed);
+	}
+
+	EndChunk(writer, chunk);
+
+	// the hardware events
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	chunk = BeginChunk(writer, "SCHD");
+	Put(writer, scheduler.Clock);
+	Put(writer, scheduler.NextEvent);
+	Put(writer, scheduler.Count);
+	Put(writer, scheduler.Heap, sizeof(scheduler.Heap));
+	Put(writer, scheduler.Position, sizeof(scheduler.Position));
+	Put(writer, scheduler.Timestamp, sizeof(scheduler.Timestamp));
+	EndChunk(writer, chunk);
+
+	// the bios
+	Bios::State &bios = gameBoy->BiosState;
+	chunk = BeginChunk(writer, "BIOS");
+	Put(writer, bios.Mapped);
+	Put(writer, bios.Data, sizeof(bios.Data));
+	EndChunk(writer, chunk);
+
+	// the memory (the page tables are rebuilt)
+	chunk = BeginChunk(writer, "MEM ");
+
+	for (int page = 0; page < MEMORY_PAGE_COUNT; page++)
+	{
+		if (!writer.Incremental || Memory::IsPageDirty(page, writer.Since)) Put(writer, &gameBoy->MemoryState.Mem[page << MEMORY_PAGE_SHIFT], (1 << MEMORY_PAGE_SHIFT));
+		else Skip(writer, (1 << MEMORY_PAGE_SHIFT));
+	}
+
+	EndChunk(writer, chunk);
+
+	// the screen (the lcd's registers are in memory, and its next event in the scheduler)
+	BYTE screen[PACKED_SCREEN_SIZE];
+	Lcd::PackScreen(screen);
+	chunk = BeginChunk(writer, "LCD ");
+	Put(writer, screen, PACKED_SCREEN_SIZE);
+	EndChunk(writer, chunk);
+}
+
+// load the state of every subsystem (the chunks have already been checked)
+static void GetChunks(const BYTE *data, size_t size)
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	Reader reader;
+
+	// the cartridge
+	Rom::State &rom = gameBoy->RomState;
+	reader = FindChunk(data, size, "ROM ");
+	reader.Position = ROM_IDENTITY_SIZE;
+	rom.RamEnabled = Get<bool>(reader);
+	rom.RomBankLow = Get<int>(reader);
+	rom.RomBankHigh = Get<int>(reader);
+	rom.RamBank = Get<int>(reader);
+	rom.BankingMode = Get<int>(reader);
+	rom.ClockLatch = Get<BYTE>(reader);
+	Get(reader, rom.Clock, sizeof(rom.Clock));
+	Get(reader, rom.LatchedClock, sizeof(rom.LatchedClock));
+	rom.ClockBase = Get<unsigned long long>(reader);
+	rom.Ram.resize(Get<unsigned int>(reader));
+	if (!rom.Ram.empty()) Get(reader, rom.Ram.data(), rom.Ram.size());
+
+	// the cpu (the idle loop being watched is forgotten)
+	Cpu::State &cpu = gameBoy->CpuState;
+	reader = FindChunk(data, size, "CPU ");
+	cpu.PC = Get<WORD>(reader);
+	cpu.SP.reg = Get<WORD>(reader);
+	cpu.AF.reg = Get<WORD>(reader);
+	cpu.BC.reg = Get<WORD>(reader);
+	cpu.DE.reg = Get<WORD>(reader);
+	cpu.HL.reg = Get<WORD>(reader);
+	cpu.Operation.PendingInterruptEnabled = Get<bool>(reader);
+	cpu.Operation.Stop = Get<bool>(reader);
+	cpu.Operation.Halt = Get<bool>(reader);
+	cpu.Flags.Operation = Get<BYTE>(reader);
+	cpu.Flags.Val = Get<BYTE>(reader);
+	cpu.Flags.Val2 = Get<BYTE>(reader);
+	cpu.Flags.Carry = Get<BYTE>(reader);
+	cpu.Flags.Result = Get<BYTE>(reader);
+	cpu.Cycles = Get<int>(reader);
+	cpu.Operand = Get<WORD>(reader);
+	cpu.InterruptCounter = Get<int>(reader);
+	cpu.Loop = Cpu::IdleLoop();
+
+	// the interrupts
+	Interrupt::State &interrupt = gameBoy->InterruptState;
+	reader = FindChunk(data, size, "INT ");
+	interrupt.MasterSwitch = Get<bool>(reader);
+	interrupt.WasHalted = Get<bool>(reader);
+
+	// the timer
+	Timer::State &timer = gameBoy->TimerState;
+	reader = FindChunk(data, size, "TIME");
+	timer.DividerBase = Get<unsigned long long>(reader);
+	timer.TimaBase = Get<unsigned long long>(reader);
+	timer.Tima = Get<BYTE>(reader);
+	timer.Period = Get<int>(reader);
+
+	// the joypad
+	Joypad::State &joypad = gameBoy->JoypadState;
+	reader = FindChunk(data, size, "JOYP");
+	joypad.Held = Get<BYTE>(reader);
+	joypad.PendingCount = Get<int>(reader);
+
+	for (int i = 0; i < JOYPAD_MAX_PENDING; i++)
+	{
+		joypad.Pending[i].Timestamp = Get<unsigned long long>(reader);
+		joypad.Pending[i].Button = Get<int>(reader);
+		joypad.Pending[i].Pressed = Get<bool>(reader);
+	}
+
+	// the hardware events
+	Scheduler::State &scheduler = gameBoy->SchedulerState;
+	reader = FindChunk(data, size, "SCHD");
+	scheduler.Clock = Get<unsigned long long>(reader);
+	scheduler.NextEvent = Get<unsigned long long>(reader);
+	scheduler.Count = Get<int>(reader);
+	Get(reader, scheduler.Heap, sizeof(scheduler.Heap));
+	Get(reader, scheduler.Position, sizeof(scheduler.Position));
+	Get(reader, scheduler.Timestamp, sizeof(scheduler.Timestamp));
+
+	// the bios
+	Bios::State &bios = gameBoy->BiosState;
+	reader = FindChunk(data, size, "BIOS");
+	bios.Mapped = Get<bool>(reader);
+	Get(reader, bios.Data, sizeof(bios.Data));
+
+	// the memory
+	reader = FindChunk(data, size, "MEM ");
+	Get(reader, gameBoy->MemoryState.Mem, sizeof(gameBoy->MemoryState.Mem));
+
+	// the screen
+	reader = FindChunk(data, size, "LCD ");
+	Lcd::UnpackScreen(reader.Data);
+}
+
+// # Save states # //
+
+// save the bound machine (the data is replaced, its capacity is reused)
+void SaveState::Save(std::vector<BYTE> &data)
+{
+	Writer writer = {data, 0, false, 0};
+	unsigned int version = SAVE_STATE_VERSION;
+
+	data.clear();
+	Put(writer, SAVE_STATE_MAGIC, 4);
+	Put(writer, version);
+	PutChunks(writer);
+}
+
+// update a state saved (or updated) from the bound machine, rewriting only what changed since its epoch (which is moved on)
+//
+// Each state kept up to date has its own epoch, starting at 0 (as the data
+// starts empty, the first update saves it in full). Data that doesn't hold a
+// state of the same rom is saved in full.
+void SaveState::Update(std::vector<BYTE> &data, unsigned int &epoch)
+{
+	std::vector<BYTE> identity;
+	Writer identityWriter = {identity, 0, false, 0};
+	PutRomIdentity(identityWriter);
+
+	// the state starts with the header and the rom chunk's identity
+	size_t identityPosition = (HEADER_SIZE + CHUNK_HEADER_SIZE);
+	bool incremental = (data.size() >= (identityPosition + identity.size()));
+	incremental = incremental && memcmp(data.data(), SAVE_STATE_MAGIC, 4) == 0;
+	incremental = incremental && memcmp(&data[identityPosition], identity.data(), identity.size()) == 0;
+
+	if (incremental)
+	{
+		size_t size = data.size();
+		Writer writer = {data, HEADER_SIZE, true, epoch};
+		PutChunks(writer);
+
+		// the layout changed after all (it can't with the same rom), save it in full
+		if (writer.Position != size) Save(data);
+	}
+	else
+	{
+		Save(data);
+	}
+
+	epoch = Memory::NextEpoch();
+}
+
+// load a state into the bound machine, returns false (leaving the machine as it was) if the state doesn't fit it
+bool SaveState::Load(const BYTE *data, size_t size)
+{
+	unsigned int version;
+
+	// check the header
+	if (size < HEADER_SIZE || memcmp(data, SAVE_STATE_MAGIC, 4) != 0)
+	{
+		Log::Error("Not a save state");
+		return false;
+	}
+
+	memcpy(&version, &data[4], 4);
+
+	if (version != SAVE_STATE_VERSION)
+	{
+		Log::Error("Unsupported save state version %u (expected %u)", version, SAVE_STATE_VERSION);
+		return false;
+	}
+
+	// check the chunks are in bounds
+	for (size_t position = HEADER_SIZE; position < size;)
+	{
+		unsigned int chunkSize;
+
+		if ((size - position) < CHUNK_HEADER_SIZE)
+		{
+			Log::Error("Truncated save state");
+			return false;
+		}
+
+		memcpy(&chunkSize, &data[position + 4], 4);
+		position += CHUNK_HEADER_SIZE;
+
+		if ((size - position) < chunkSize)
+		{
+			Log::Error("Truncated save state");
+			return false;
+		}
+
+		position += chunkSize;
+	}
+
+	// the state of this machine has the same chunks at the same sizes (only the cartridge ram can vary, with the rom)
+	for (int chunk = 0; chunk < CHUNK_COUNT; chunk++)
+	{
+		Reader reader = FindChunk(data, size, CHUNK_IDS[chunk]);
+
+		if (reader.Data == NULL || reader.Size != GetChunkSize(chunk))
+		{
+			Log::Error("Save state chunk %.4s is missing or the wrong size", CHUNK_IDS[chunk]);
+			return false;
+		}
+	}
+
+	// the rom identity has to match
+	std::vector<BYTE> identity;
+	Writer identityWriter = {identity, 0, false, 0};
+	PutRomIdentity(identityWriter);
+	Reader rom = FindChunk(data, size, "ROM ");
+
+	if (memcmp(rom.Data, identity.data(), ROM_IDENTITY_SIZE) != 0)
+	{
+		Log::Error("The save state is of a different rom");
+		return false;
+	}
+
+	// the mapper registers have to fit in the registers (the banks they select are wrapped to the rom and ram)
+	rom.Position = (ROM_IDENTITY_SIZE + sizeof(bool));
+	int romBankLow = Get<int>(rom);
+	int romBankHigh = Get<int>(rom);
+	int ramBank = Get<int>(rom);
+	int bankingMode = Get<int>(rom);
+	bool registersValid = (romBankLow >= 0 && romBankLow <= 0xFF && romBankHigh >= 0 && romBankHigh <= 0x03 && ramBank >= 0 && ramBank <= 0xFF && bankingMode >= 0 && bankingMode <= 1);
+
+	// and the cartridge ram is the size the rom has
+	Rom::State &romState = GameBoy::Current()->RomState;
+	rom.Position += (sizeof(romState.ClockLatch) + sizeof(romState.Clock) + sizeof(romState.LatchedClock) + sizeof(romState.ClockBase));
+
+	if (!registersValid || Get<unsigned int>(rom) != romState.Ram.size())
+	{
+		Log::Error("The save state's cartridge is corrupt");
+		return false;
+	}
+
+	// the joypad can't have more inputs waiting than it holds, or press buttons it doesn't have
+	Reader joypad = FindChunk(data, size, "JOYP");
+	joypad.Position = sizeof(BYTE);
+	int pendingCount = Get<int>(joypad);
+	bool joypadValid = (pendingCount >= 0 && pendingCount <= JOYPAD_MAX_PENDING);
+
+	for (int i = 0; joypadValid && i < pendingCount; i++)
+	{
+		Get<unsigned long long>(joypad);
+		int button = Get<int>(joypad);
+		Get<bool>(joypad);
+		joypadValid = (button >= 0 && button < Joypad::BUTTON_COUNT);
+	}
+
+	if (!joypadValid)
+	{
+		Log::Error("The save state's joypad is corrupt");
+		return false;
+	}
+
+	// the scheduler's heap has to hold each scheduled event once, where its position says it is
+	Reader schedulerReader = FindChunk(data, size, "SCHD");
+	Scheduler::State scheduler;
+	scheduler.Clock = Get<unsigned long long>(schedulerReader);
+	scheduler.NextEvent = Get<unsigned long long>(schedulerReader);
+	scheduler.Count = Get<int>(schedulerReader);
+	Get(schedulerReader, scheduler.Heap, sizeof(scheduler.Heap));
+	Get(schedulerReader, scheduler.Position, sizeof(scheduler.Position));
+	Get(schedulerReader, scheduler.Timestamp, sizeof(scheduler.Timestamp));
+	bool schedulerValid = (scheduler.Count >= 0 && scheduler.Count <= Scheduler::EVENT_COUNT);
+
+	for (int event = 0; schedulerValid && event < Scheduler::EVENT_COUNT; event++)
+	{
+		int position = scheduler.Position[event];
+		schedulerValid = (position >= 0 && position <= scheduler.Count && (position == 0 || scheduler.Heap[position - 1] == event));
+	}
+
+	for (int i = 0; schedulerValid && i < scheduler.Count; i++)
+	{
+		int event = scheduler.Heap[i];
+		schedulerValid = (event >= 0 && event < Scheduler::EVENT_COUNT && scheduler.Position[event] == (i + 1));
+
+		// and no event is overdue by more than a frame (catching up on it would take forever)
+		schedulerValid = schedulerValid && (scheduler.Timestamp[event] + LCD_FRAME_CYCLES) >= scheduler.Clock;
+	}
+
+	// the next event is the earliest
+	if (schedulerValid) schedulerValid = (scheduler.NextEvent == ((scheduler.Count > 0) ? scheduler.Timestamp[scheduler.Heap[0]] : SCHEDULER_NEVER));
+
+	if (!schedulerValid)
+	{
+		Log::Error("The save state's scheduler is corrupt");
+		return false;
+	}
+
+	GetChunks(data, size);
+
+	// all of memory was replaced
+	Memory::MarkAllPagesDirty();
+
+	// rebuild the page tables, map the cartridge (and bios) back in, and decode every tile again
+	Memory::Map(GameBoy::Current()->MemoryState);
+	Rom::Map();
+	Lcd::InvalidateTiles();
+
+	return true;
+}
+
+// save the bound machine to a file
+bool SaveState::SaveToFile(const char *fileName)
+{
+	std::vector<BYTE> data;
+	Save(data);
+
+	FILE *fp = fopen(fileName, "wb");
+
+	if (fp == NULL)
+	{
+		Log::Error("Could not create save state %s", fileName);
+		return false;
+	}
+
+	bool written = (fwrite(data.data(), 1, data.size(), fp) == data.size());
+	written &= (fclose(fp) == 0);
+
+	if (!written) Log::Error("Could not write save state %s", fileName);
+
+	return written;
+}
+
+// load a state from a file into the bound machine
+bool SaveState::LoadFromFile(const char *fileName)
+{
+	FILE *fp = fopen(fileName, "rb");
+
+	if (fp == NULL)
+	{
+		Log::Error("Could not open save state %s", fileName);
+		return false;
+	}
+
+	std::vector<BYTE> data;
+	BYTE buffer[0x4000];
+	size_t count;
+
+	while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + count);
+	}
+
+	fclose(fp);
+
+	return Load(data.data(), data.size());
+}
@@ -0,0 +1,171 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: scheduler.cpp
+*/
+
+// includes
+#include "include/gameboy.h"
+#include "include/joypad.h"
+#include "include/lcd.h"
+#include "include/memory.h"
+#include "include/scheduler.h"
+#include "include/timer.h"
+
+// init the scheduler (clears every event and restarts the clock)
+void Scheduler::Init()
+{
+	State &state = GameBoy::Current()->SchedulerState;
+
+	state.Clock = 0;
+	state.NextEvent = SCHEDULER_NEVER;
+	state.Count = 0;
+
+	for (int i = 0; i < EVENT_COUNT; i++)
+	{
+		state.Position[i] = 0;
+		state.Timestamp[i] = SCHEDULER_NEVER;
+	}
+}
+
+// the current cycle
+unsigned long long Scheduler::Now()
+{
+	return GameBoy::Current()->SchedulerState.Clock;
+}
+
+// schedule an event (or move it, if it is already scheduled)
+void Scheduler::Schedule(int event, unsigned long long timestamp)
+{
+	State &state = GameBoy::Current()->SchedulerState;
+
+	if (state.Position[event] == 0)
+	{
+		// add the event to the end of the heap
+		state.Heap[state.Count] = event;
+		state.Count += 1;
+		state.Position[event] = state.Count;
+		state.Timestamp[event] = timestamp;
+		SiftUp(state, state.Count - 1);
+	}
+	else
+	{
+		// move the event up or down the heap
+		int index = state.Position[event] - 1;
+		bool earlier = (timestamp < state.Timestamp[event]);
+		state.Timestamp[event] = timestamp;
+		if (earlier) SiftUp(state, index); else SiftDown(state, index);
+	}
+
+	state.NextEvent = state.Timestamp[state.Heap[0]];
+}
+
+// cancel an event
+void Scheduler::Cancel(int event)
+{
+	State &state = GameBoy::Current()->SchedulerState;
+
+	if (state.Position[event] != 0)
+	{
+		Remove(state, event);
+		state.NextEvent = (state.Count > 0) ? state.Timestamp[state.Heap[0]] : SCHEDULER_NEVER;
+	}
+}
+
+// is an event scheduled?
+bool Scheduler::IsScheduled(int event)
+{
+	return GameBoy::Current()->SchedulerState.Position[event] != 0;
+}
+
+// run every event that is due
+void Scheduler::Dispatch(State &state)
+{
+	while (state.Count > 0 && state.Timestamp[state.Heap[0]] <= state.Clock)
+	{
+		int event = state.Heap[0];
+		unsigned long long timestamp = state.Timestamp[event];
+
+		// events reschedule themselves from the cycle they were due at
+		Remove(state, event);
+
+		switch(event)
+		{
+			case TIMER: Timer::Overflow(timestamp); break;
+			case LCD: Lcd::Event(timestamp); break;
+			case DMA: Memory::FinishDma(); break;
+			case JOYPAD: Joypad::Event(timestamp); break;
+			default: break;
+		}
+	}
+
+	state.NextEvent = (state.Count > 0) ? state.Timestamp[state.Heap[0]] : SCHEDULER_NEVER;
+}
+
+// remove an event from the heap
+void Scheduler::Remove(State &state, int event)
+{
+	int index = state.Position[event] - 1;
+	int last = state.Count - 1;
+
+	// move the last event into the hole
+	if (index != last)
+	{
+		Swap(state, index, last);
+	}
+
+	state.Count -= 1;
+	state.Position[event] = 0;
+
+	if (index != last)
+	{
+		SiftUp(state, index);
+		SiftDown(state, index);
+	}
+}
+
+// move an event up the heap until its parent is earlier
+void Scheduler::SiftUp(State &state, int index)
+{
+	while (index > 0)
+	{
+		int parent = (index - 1) / 2;
+
+		if (state.Timestamp[state.Heap[parent]] <= state.Timestamp[state.Heap[index]]) break;
+
+		Swap(state, parent, index);
+		index = parent;
+	}
+}
+
+// move an event down the heap until its children are later
+void Scheduler::SiftDown(State &state, int index)
+{
+	while (true)
+	{
+		int child = (index * 2) + 1;
+
+		if (child >= state.Count) break;
+
+		// pick the earlier child
+		if ((child + 1) < state.Count && state.Timestamp[state.Heap[child + 1]] < state.Timestamp[state.Heap[child]])
+		{
+			child += 1;
+		}
+
+		if (state.Timestamp[state.Heap[index]] <= state.Timestamp[state.Heap[child]]) break;
+
+		Swap(state, index, child);
+		index = child;
+	}
+}
+
+// swap two heap entries
+void Scheduler::Swap(State &state, int a, int b)
+{
+	int event = state.Heap[a];
+	state.Heap[a] = state.Heap[b];
+	state.Heap[b] = event;
+	state.Position[state.Heap[a]] = a + 1;
+	state.Position[state.Heap[b]] = b + 1;
+}
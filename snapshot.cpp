@@ -0,0 +1,86 @@
+/*
+	Project: cBoy: A Gameboy emulator written in C++
+	Author: Danny Glover - https://github.com/DannyGlover
+	File: snapshot.cpp
+*/
+
+// includes
+#include <string.h>
+#include "include/gameboy.h"
+#include "include/memory.h"
+#include "include/rom.h"
+#include "include/snapshot.h"
+
+// create an empty snapshot
+Snapshot::Snapshot() : Saved(new Data()), Taken(false)
+{
+}
+
+// copy the state of the bound machine
+void Snapshot::Take()
+{
+	GameBoy *gameBoy = GameBoy::Current();
+	Rom::State &rom = gameBoy->RomState;
+
+	Saved->CpuState = gameBoy->CpuState;
+	memcpy(Saved->Mem, gameBoy->MemoryState.Mem, sizeof(Saved->Mem));
+	Saved->TimerState = gameBoy->TimerState;
+	Saved->JoypadState = gameBoy->JoypadState;
+	Saved->LcdState = gameBoy->LcdState;
+	Saved->InterruptState = gameBoy->InterruptState;
+	Saved->SchedulerState = gameBoy->SchedulerState;
+	Saved->BiosMapped = gameBoy->BiosState.Mapped;
+
+	// the cartridge
+	Saved->RamEnabled = rom.RamEnabled;
+	Saved->RomBankLow = rom.RomBankLow;
+	Saved->RomBankHigh = rom.RomBankHigh;
+	Saved->RamBank = rom.RamBank;
+	Saved->BankingMode = rom.BankingMode;
+	Saved->ClockLatch = rom.ClockLatch;
+	memcpy(Saved->Clock, rom.Clock, sizeof(rom.Clock));
+	memcpy(Saved->LatchedClock, rom.LatchedClock, sizeof(rom.LatchedClock));
+	Saved->ClockBase = rom.ClockBase;
+	Saved->Ram.assign(rom.Ram.begin(), rom.Ram.end());
+
+	Taken = true;
+}
+
+// put the bound machine back to the state last taken
+void Snapshot::Restore()
+{
+	if (!Taken) return;
+
+	GameBoy *gameBoy = GameBoy::Current();
+	Rom::State &rom = gameBoy->RomState;
+	unsigned int frameCount = gameBoy->LcdState.FrameCount;
+
+	gameBoy->CpuState = Saved->CpuState;
+	// the dirty pages are left set (the pages written since were written back)
+	memcpy(gameBoy->MemoryState.Mem, Saved->Mem, sizeof(Saved->Mem));
+	gameBoy->TimerState = Saved->TimerState;
+	gameBoy->JoypadState = Saved->JoypadState;
+	// the decoded tiles come back with the vram they were decoded from
+	gameBoy->LcdState = Saved->LcdState;
+	// the frame count carries on (the screen shown from ahead isn't handed out again)
+	gameBoy->LcdState.FrameCount = frameCount;
+	gameBoy->InterruptState = Saved->InterruptState;
+	gameBoy->SchedulerState = Saved->SchedulerState;
+	gameBoy->BiosState.Mapped = Saved->BiosMapped;
+
+	// the cartridge
+	rom.RamEnabled = Saved->RamEnabled;
+	rom.RomBankLow = Saved->RomBankLow;
+	rom.RomBankHigh = Saved->RomBankHigh;
+	rom.RamBank = Saved->RamBank;
+	rom.BankingMode = Saved->BankingMode;
+	rom.ClockLatch = Saved->ClockLatch;
+	memcpy(rom.Clock, Saved->Clock, sizeof(rom.Clock));
+	memcpy(rom.LatchedClock, Saved->LatchedClock, sizeof(rom.LatchedClock));
+	rom.ClockBase = Saved->ClockBase;
+	rom.Ram.assign(Saved->Ram.begin(), Saved->Ram.end());
+
+	// rebuild the page tables, and map the cartridge (and bios) back in
+	Memory::Map(gameBoy->MemoryState);
+	Rom::Map();
+}
@@ -6,22 +6,37 @@
 
 // includes
 #include "include/bit.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
 #include "include/memory.h"
 #include "include/log.h"
+#include "include/scheduler.h"
 #include "include/timer.h"
 
+// definitions
+#define DIVIDER_PERIOD 256
+
 // vars
-int Timer::TimerCounter = 0;
-int Timer::DividerCounter = 0;
 static const int FREQUENCIES[4] = {1024, 16, 64, 256};
-static int didTimaOverflow = false;
+
+// count the TIMA increments between two cycles (TIMA counts on the divider's clock)
+static unsigned long long CountTicks(const Timer::State &state, unsigned long long from, unsigned long long to)
+{
+	if (state.Period == 0) return 0;
+
+	return ((to - state.DividerBase) / state.Period) - ((from - state.DividerBase) / state.Period);
+}
 
 // init timer
 void Timer::Init()
 {
-	TimerCounter = FREQUENCIES[0];
-	DividerCounter = 0;
+	State &state = GameBoy::Current()->TimerState;
+
+	// restart the divider
+	state.DividerBase = Scheduler::Now();
+	state.TimaBase = state.DividerBase;
+	// start (or stop) the timer
+	SetClockFrequency();
 }
 
 //reset timer
@@ -49,55 +64,125 @@ BYTE Timer::GetClockFrequency()
 	return (Memory::ReadByte(TAC_ADDRESS) & 0x3);
 }
 
-// set the clock frequency
+// set the clock frequency from TAC (the next overflow is rescheduled)
 void Timer::SetClockFrequency()
 {
-	TimerCounter = FREQUENCIES[GetClockFrequency()];
+	State &state = GameBoy::Current()->TimerState;
+
+	state.Period = IsEnabled() ? FREQUENCIES[GetClockFrequency()] : 0;
+	ScheduleOverflow();
 }
 
-// update divider
-void Timer::UpdateDivider(int clockCycles)
+// schedule the next TIMA overflow
+void Timer::ScheduleOverflow()
 {
-	DividerCounter += clockCycles;
+	State &state = GameBoy::Current()->TimerState;
 
-	if (DividerCounter > 255)
+	// the timer is stopped
+	if (state.Period == 0)
 	{
-		Memory::Mem[DIVIDER_ADDRESS] += 1;
-		DividerCounter -= 256;
+		Scheduler::Cancel(Scheduler::TIMER);
+		return;
 	}
+
+	// the first increment after TimaBase, then one per period until TIMA wraps
+	unsigned long long firstTick = state.DividerBase + ((((state.TimaBase - state.DividerBase) / state.Period) + 1) * state.Period);
+	unsigned long long ticks = (0x100 - state.Tima);
+
+	Scheduler::Schedule(Scheduler::TIMER, firstTick + ((ticks - 1) * state.Period));
+}
+
+// bring TIMA up to the current cycle
+void Timer::Sync()
+{
+	State &state = GameBoy::Current()->TimerState;
+	unsigned long long now = Scheduler::Now();
+
+	state.Tima += (BYTE)CountTicks(state, state.TimaBase, now);
+	state.TimaBase = now;
+}
+
+// get DIV
+BYTE Timer::GetDivider()
+{
+	State &state = GameBoy::Current()->TimerState;
+
+	return (BYTE)((Scheduler::Now() - state.DividerBase) / DIVIDER_PERIOD);
 }
 
-// update the timer
-void Timer::Update(int clockCycles)
+// get TIMA
+BYTE Timer::GetTima()
 {
-	UpdateDivider(clockCycles);
+	State &state = GameBoy::Current()->TimerState;
 
-	if (IsEnabled())
+	return state.Tima + (BYTE)CountTicks(state, state.TimaBase, Scheduler::Now());
+}
+
+// set TIMA
+void Timer::SetTima(BYTE val)
+{
+	State &state = GameBoy::Current()->TimerState;
+
+	state.Tima = val;
+	state.TimaBase = Scheduler::Now();
+	ScheduleOverflow();
+}
+
+// set TAC
+void Timer::SetControl(BYTE val)
+{
+	BYTE *Mem = Memory::Get();
+	BYTE currentTAC = Mem[TAC_ADDRESS];
+
+	// count TIMA up to now at the old frequency
+	Sync();
+	// write the new TAC data (upper 5 bits are fixed to one)
+	Mem[TAC_ADDRESS] = (val | 0xF8);
+
+	// restart the timer if it was started, stopped or its frequency changed
+	if (Mem[TAC_ADDRESS] != currentTAC)
+	{
+		SetClockFrequency();
+	}
+}
+
+// reset the divider (writing to DIV)
+void Timer::ResetDivider()
+{
+	State &state = GameBoy::Current()->TimerState;
+	bool overflow = false;
+
+	// count TIMA up to now
+	Sync();
+
+	// TIMA counts on a falling edge of the divider, so resetting it while the edge's bit is set counts once more
+	if (state.Period != 0 && ((Scheduler::Now() - state.DividerBase) & (state.Period >> 1)))
 	{
-		TimerCounter -= clockCycles;
-
-		if (TimerCounter <= 0)
-		{
-			// get the TIMA reg's current value
-			BYTE currentTIMA = Memory::ReadByte(TIMA_ADDRESS);
-
-			// TIMA overflow
-			if (currentTIMA == 0x00)
-			{
-				didTimaOverflow = true;
-			}
-
-			// write the new value to the tima reg
-			Memory::Write(TIMA_ADDRESS, currentTIMA + 1);
-
-			if (didTimaOverflow)
-			{
-				Memory::Write(TIMA_ADDRESS, Memory::ReadByte(TMA_ADDRESS));
-				Interrupt::Request(Interrupt::IDS::TIMER);
-				didTimaOverflow = false;
-			}
-
-			SetClockFrequency();
-		}
+		overflow = (state.Tima == 0xFF);
+		state.Tima += 1;
 	}
+
+	// restart the divider
+	state.DividerBase = Scheduler::Now();
+	state.TimaBase = state.DividerBase;
+
+	if (overflow)
+	{
+		Overflow(state.TimaBase);
+	}
+	else
+	{
+		ScheduleOverflow();
+	}
+}
+
+// TIMA overflowed, reload it from TMA
+void Timer::Overflow(unsigned long long timestamp)
+{
+	State &state = GameBoy::Current()->TimerState;
+
+	state.Tima = Memory::Get()[TMA_ADDRESS];
+	state.TimaBase = timestamp;
+	Interrupt::Request(Interrupt::IDS::TIMER);
+	ScheduleOverflow();
 }
@@ -5,18 +5,60 @@
 */
 
 // includes
+#include <cstdio>
+#include <cstring>
+#include <vector>
 #include "include/bit.h"
 #include "include/cpu.h"
 #include "include/ops.h"
 #include "include/flags.h"
+#include "include/gameboy.h"
 #include "include/interrupt.h"
+#include "include/lcd.h"
 #include "include/log.h"
+#include "include/mbc3.h"
 #include "include/memory.h"
+#include "include/movie.h"
+#include "include/rewind.h"
+#include "include/rom.h"
+#include "include/saveState.h"
+#include "include/scheduler.h"
 #include "include/unitTest.h"
 
+// definitions
+// where each test rom bank holds its own number (low byte, then high byte)
+#define TEST_ROM_BANK_NUMBER_OFFSET 0x2000
+#define TEST_ROM_ENTRY_POINT 0x0100
+
+// vars
+// the number of checks that failed
+static int failures = 0;
+// a test program that keeps counting A into work ram: LD HL,C000; INC A; LD (HL+),A; BIT 5,H; JR Z,-6; JR -11
+static const BYTE COUNTING_PROGRAM[] = {0x21, 0x00, 0xC0, 0x3C, 0x22, 0xCB, 0x6C, 0x28, 0xFA, 0x18, 0xF5};
+// a test program that keeps reading the buttons into work ram: LD A,10; LDH (00),A; LD HL,C000; LDH A,(00); LD (HL+),A; BIT 5,H; JR Z,-7; JR -12
+static const BYTE JOYPAD_PROGRAM[] = {0x3E, 0x10, 0xE0, 0x00, 0x21, 0x00, 0xC0, 0xF0, 0x00, 0x22, 0xCB, 0x6C, 0x28, 0xF9, 0x18, 0xF4};
+// a test program (for an mbc5 rom) that maps bank 0 at 0x4000 too, and keeps calling the same code through both windows
+// 0x0100: LD A,0; LD (2000),A; LD SP,DFF0; LD DE,C000
+// 0x010B: CALL 0150; CALL 4150; LD A,D; CP C4; JR NZ,-11; LD DE,C000; JR -16
+// 0x0150: LD A,B; ADD A,C; LD B,A; INC C; CALL 0160; RET
+// 0x0160: POP HL; PUSH HL; LD A,H; LD (DE),A; INC DE; LD A,B; LD (DE),A; INC DE; RET (records where it was called from)
+static const BYTE WINDOWS_PROGRAM[] =
+{
+	0x3E, 0x00, 0xEA, 0x00, 0x20, 0x31, 0xF0, 0xDF, 0x11, 0x00, 0xC0,
+	0xCD, 0x50, 0x01, 0xCD, 0x50, 0x41, 0x7A, 0xFE, 0xC4, 0x20, 0xF5, 0x11, 0x00, 0xC0, 0x18, 0xF0,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x78, 0x81, 0x47, 0x0C, 0xCD, 0x60, 0x01, 0xC9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xE1, 0xE5, 0x7C, 0x12, 0x13, 0x78, 0x12, 0x13, 0xC9
+};
+
+// a test set of shades (each byte distinct, so a pixel of the wrong colour or a misplaced byte shows)
+static const unsigned int TEST_SHADES[4] = {0x01020304, 0x05060708, 0x090A0B0C, 0x0D0E0F10};
+
 // handy macros
 #define testPassed(name, phase) Log::Normal("%s Test phase %d passed", name, phase);
-#define assert(expected, got, testName, testPhase) if (expected != got){ Log::Critical("%s - Test phase %d failed. Expected output of %02X, got %02X", testName, testPhase, expected, got); return;} else testPassed(testName, testPhase);
+#define assert(expected, got, testName, testPhase) if (expected != got){ failures++; Log::Critical("%s - Test phase %d failed. Expected output of %02X, got %02X", testName, testPhase, expected, got); return;} else testPassed(testName, testPhase);
 
 // check for valid flags
 static void assertFlags(BYTE fZ, BYTE fN, BYTE fH, BYTE fC, const char *testName, unsigned int testPhase)
@@ -29,11 +71,96 @@ static void assertFlags(BYTE fZ, BYTE fN, BYTE fH, BYTE fC, const char *testName
 	// if any of the flag values don't match, we failed the test
 	if ((flagZ_Val != fZ) || (flagN_Val != fN) || (flagH_Val != fH) || (flagC_Val != fC))
 	{
+		failures++;
 		Log::Critical("%s - Test phase %d: flag test failed. Expected Flags of Z:%d, N:%d, H:%d, C:%d - Got: Z:%d, N:%d, H:%d, C:%d", testName, testPhase, fZ, fN, fH, fC, flagZ_Val, flagN_Val, flagH_Val, flagC_Val);
 		return;
 	}
 }
 
+// a machine of its own for a test (the machine bound before it is bound again after)
+class TestMachine
+{
+	public:
+		TestMachine() : previous(GameBoy::Current())
+		{
+			gameBoy.Bind();
+		}
+
+		~TestMachine()
+		{
+			if (previous != NULL) previous->Bind();
+		}
+
+	public:
+		GameBoy gameBoy;
+
+	private:
+		GameBoy *previous;
+};
+
+// write a test rom (each bank holding its number, and the program at the entry point) to a temporary file, and run it on the current machine
+static bool LoadTestRom(const char *name, BYTE cartridgeType, BYTE romSize, BYTE ramSize, int banks, const BYTE *program = NULL, size_t programSize = 0)
+{
+	std::vector<BYTE> data(banks * ROM_BANK_SIZE, 0x00);
+	char fileName[FILENAME_MAX];
+
+	for (int bank = 0; bank < banks; bank++)
+	{
+		data[bank * ROM_BANK_SIZE + TEST_ROM_BANK_NUMBER_OFFSET] = (BYTE)(bank & 0xFF);
+		data[bank * ROM_BANK_SIZE + TEST_ROM_BANK_NUMBER_OFFSET + 1] = (BYTE)(bank >> 8);
+	}
+
+	for (size_t i = 0; i < programSize; i++)
+	{
+		data[TEST_ROM_ENTRY_POINT + i] = program[i];
+	}
+
+	// the cartridge header
+	data[CARTRIDGE_TYPE_ADDRESS] = cartridgeType;
+	data[ROM_SIZE_ADDRESS] = romSize;
+	data[RAM_SIZE_ADDRESS] = ramSize;
+
+	snprintf(fileName, sizeof(fileName), "%s/cboy-test-%s.gb", P_tmpdir, name);
+	FILE *file = fopen(fileName, "wb");
+
+	if (file == NULL)
+	{
+		failures++;
+		Log::Critical("%s - couldn't write the test rom", name);
+		return false;
+	}
+
+	bool written = (fwrite(&data[0], 1, data.size(), file) == data.size());
+	fclose(file);
+
+	// (the image stays loaded once the file is gone)
+	bool loaded = (written && Rom::Load(fileName));
+	remove(fileName);
+
+	if (!loaded)
+	{
+		failures++;
+		Log::Critical("%s - couldn't load the test rom", name);
+		return false;
+	}
+
+	GameBoy::Current()->Init(false);
+
+	return true;
+}
+
+// get the number of the rom bank mapped at an address
+static WORD ReadBankNumber(WORD address)
+{
+	return (Memory::ReadByte(address + TEST_ROM_BANK_NUMBER_OFFSET) | (Memory::ReadByte(address + TEST_ROM_BANK_NUMBER_OFFSET + 1) << 8));
+}
+
+// get the number of checks that failed
+int UnitTest::Get::Failures()
+{
+	return failures;
+}
+
 // # Eight Bit Tests # //
 
 // test eight bit add
@@ -142,14 +269,14 @@ void UnitTest::Test::EightBit::AddCarry()
 	Memory::Write(0x00, 0x88);
 	// set A to 0xFF
 	Cpu::Set::AF(0xFF << 8 | Cpu::Get::AF()->lo);
-	// set B to 0x00
+	// set B to 0x02
 	Cpu::Set::BC(0x02 << 8 | Cpu::Get::BC()->lo);
 	// execute the opcode
 	Cpu::ExecuteOpcode();
-	// check if the test passed
+	// check if the test passed (0xFF + 0x02 + the carry from phase 2)
 	assert(0x02, Cpu::Get::AF()->hi, testName, 3);
 	// check if the flags were ok
-	assertFlags(0, 0, 1, 0, testName, 3); // flag H should be set
+	assertFlags(0, 0, 1, 1, testName, 3); // flags H and C should be set
 }
 
 // test eight bit sub
@@ -604,6 +731,164 @@ void UnitTest::Test::EightBit::Xor()
 	assertFlags(1, 0, 0, 0, testName, 3); // flag Z should be set
 }
 
+// test eight bit rotate right through carry
+void UnitTest::Test::EightBit::RotateRight()
+{
+	// the test name
+	const char *testName = "Test::EightBit::RotateRight()";
+
+	// # PHASE 1 # //
+
+	// set the carry flag
+	Flags::Set::C();
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0xCB 0x18 (RR B)
+	Memory::Write(0x00, 0xCB);
+	Memory::Write(0x01, 0x18);
+	// set B to 0x02
+	Cpu::Set::BC(0x02 << 8 | Cpu::Get::BC()->lo);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed (the carry goes into bit 7)
+	assert(0x81, Cpu::Get::BC()->hi, testName, 1);
+	// check if the flags were ok
+	assertFlags(0, 0, 0, 0, testName, 1); // no flags should be set
+
+	// # PHASE 2 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0x1F (RRA)
+	Memory::Write(0x00, 0x1F);
+	// set A to 0x01
+	Cpu::Set::AF(0x01 << 8 | Cpu::Get::AF()->lo);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed (bit 0 goes into the carry)
+	assert(0x00, Cpu::Get::AF()->hi, testName, 2);
+	// check if the flags were ok
+	assertFlags(0, 0, 0, 1, testName, 2); // flag C should be set (RRA never sets Z)
+}
+
+// test eight bit loads from and to 0xFF00 + C
+void UnitTest::Test::EightBit::LoadHigh()
+{
+	// the test name
+	const char *testName = "Test::EightBit::LoadHigh()";
+
+	// # PHASE 1 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0xE2 (LD (FF00 + C),A)
+	Memory::Write(0x00, 0xE2);
+	// set A to 0x5A
+	Cpu::Set::AF(0x5A << 8 | Cpu::Get::AF()->lo);
+	// set C to 0x80
+	Cpu::Set::BC(Cpu::Get::BC()->hi << 8 | 0x80);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed (the write goes to 0xFF80)
+	assert(0x5A, Memory::ReadByte(0xFF80), testName, 1);
+
+	// # PHASE 2 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0xF2 (LD A,(FF00 + C))
+	Memory::Write(0x00, 0xF2);
+	// set A to 0x00
+	Cpu::Set::AF(0x00 << 8 | Cpu::Get::AF()->lo);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed (the read comes from 0xFF80)
+	assert(0x5A, Cpu::Get::AF()->hi, testName, 2);
+}
+
+// test the flags left pending by the alu, INC and DEC (F is only worked out when it's read)
+void UnitTest::Test::EightBit::PendingFlags()
+{
+	// the test name
+	const char *testName = "Test::EightBit::PendingFlags()";
+	Cpu::State &state = GameBoy::Current()->CpuState;
+
+	// # PHASE 1 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0x80 (ADD A,B)
+	Memory::Write(0x00, 0x80);
+	// set A to 0x0F
+	Cpu::Set::AF(0x0F << 8 | Cpu::Get::AF()->lo);
+	// set B to 0x01
+	Cpu::Set::BC(0x01 << 8 | Cpu::Get::BC()->lo);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed (the flags are left pending)
+	assert(PENDING_ALU + ALU_ADD, state.Flags.Operation, testName, 1);
+	// check if reading F works the flags out (flag H should be set)
+	assert(FLAG_MASK_H, (Cpu::Get::AF()->lo & 0xF0), testName, 1);
+	// check if they're no longer pending
+	assert(PENDING_NONE, state.Flags.Operation, testName, 1);
+
+	// # PHASE 2 # //
+
+	// set the carry flag
+	Flags::Set::C();
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instruction to 0x04 (INC B)
+	Memory::Write(0x00, 0x04);
+	// set B to 0xFF
+	Cpu::Set::BC(0xFF << 8 | Cpu::Get::BC()->lo);
+	// execute the opcode
+	Cpu::ExecuteOpcode();
+	// check if the test passed
+	assert(PENDING_INC, state.Flags.Operation, testName, 2);
+	assert(0x00, Cpu::Get::BC()->hi, testName, 2);
+	// check if the flags were ok
+	assertFlags(1, 0, 1, 1, testName, 2); // flags Z and H should be set, and C kept
+
+	// # PHASE 3 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instructions to 0x80 (ADD A,B) and 0x0D (DEC C)
+	Memory::Write(0x00, 0x80);
+	Memory::Write(0x01, 0x0D);
+	// set A to 0xFF
+	Cpu::Set::AF(0xFF << 8 | Cpu::Get::AF()->lo);
+	// set B and C to 0x01
+	Cpu::Set::BC(0x0101);
+	// execute the opcodes
+	Cpu::ExecuteOpcode();
+	Cpu::ExecuteOpcode();
+	// check if the test passed (DEC replaced the pending ADD without F being written)
+	assert(PENDING_DEC, state.Flags.Operation, testName, 3);
+	assert(0x00, Cpu::Get::BC()->lo, testName, 3);
+	// check if the flags were ok
+	assertFlags(1, 1, 0, 1, testName, 3); // flags Z and N should be set, and C kept from the ADD
+
+	// # PHASE 4 # //
+
+	// set pc to 0x00
+	Cpu::Set::PC(0x00);
+	// set the instructions to 0xFE 0x02 (CP A,d8) and 0x38 0x05 (JR C,r8)
+	Memory::Write(0x00, 0xFE);
+	Memory::Write(0x01, 0x02);
+	Memory::Write(0x02, 0x38);
+	Memory::Write(0x03, 0x05);
+	// set A to 0x01
+	Cpu::Set::AF(0x01 << 8 | Cpu::Get::AF()->lo);
+	// execute the opcodes
+	Cpu::ExecuteOpcode();
+	Cpu::ExecuteOpcode();
+	// check if the test passed (the jump is taken on the pending carry)
+	assert(0x09, Cpu::Get::PC(), testName, 4);
+	// check if the flags were ok
+	assertFlags(0, 1, 1, 1, testName, 4); // flags N, H and C should be set
+}
 
 // # Sixteen Bit Tests # //
 
@@ -648,3 +933,727 @@ void UnitTest::Test::SixteenBit::Add()
 	// check if the flags were ok
 	assertFlags(0, 0, 0, 0, testName, 2); // no flags should be set
 }
+
+
+// # Cartridge Tests # //
+
+// test mbc1 rom and ram bank switching
+void UnitTest::Test::Cartridge::Mbc1()
+{
+	// the test name
+	const char *testName = "Test::Cartridge::Mbc1()";
+	TestMachine machine;
+
+	// a 2MB rom with 32KB of ram
+	if (!LoadTestRom("mbc1", 0x03, 0x06, 0x03, 128)) return;
+
+	// # PHASE 1 # //
+
+	// check if bank 1 is mapped at power on
+	assert(0x01, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+	// select bank 5
+	Memory::Write(0x2000, 0x05);
+	assert(0x05, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+	// check if selecting bank 0 selects bank 1
+	Memory::Write(0x2000, 0x00);
+	assert(0x01, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+
+	// # PHASE 2 # //
+
+	// select bank 0x43 (the upper bits come from the ram bank register)
+	Memory::Write(0x4000, 0x02);
+	Memory::Write(0x2000, 0x03);
+	assert(0x43, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 2);
+	// check if only the lower 5 bits are the low register (so 0x20 selects bank 0x41)
+	Memory::Write(0x2000, 0x20);
+	assert(0x41, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 2);
+
+	// # PHASE 3 # //
+
+	// check if the upper bits switch the first bank in mode 1 (and not in mode 0)
+	assert(0x00, ReadBankNumber(0x0000), testName, 3);
+	Memory::Write(0x6000, 0x01);
+	assert(0x40, ReadBankNumber(0x0000), testName, 3);
+	Memory::Write(0x6000, 0x00);
+	assert(0x00, ReadBankNumber(0x0000), testName, 3);
+
+	// # PHASE 4 # //
+
+	// check if disabled ram reads 0xFF and ignores writes
+	Memory::Write(0xA000, 0x12);
+	assert(0xFF, Memory::ReadByte(0xA000), testName, 4);
+	// enable the ram
+	Memory::Write(0x0000, 0x0A);
+	Memory::Write(0xA000, 0x12);
+	assert(0x12, Memory::ReadByte(0xA000), testName, 4);
+
+	// # PHASE 5 # //
+
+	// select ram bank 1 (in mode 1)
+	Memory::Write(0x6000, 0x01);
+	Memory::Write(0x4000, 0x01);
+	assert(0x00, Memory::ReadByte(0xA000), testName, 5);
+	Memory::Write(0xA000, 0x34);
+	// check if each bank kept its own data
+	Memory::Write(0x4000, 0x00);
+	assert(0x12, Memory::ReadByte(0xA000), testName, 5);
+	Memory::Write(0x4000, 0x01);
+	assert(0x34, Memory::ReadByte(0xA000), testName, 5);
+}
+
+// test mbc3 rom and ram bank switching
+void UnitTest::Test::Cartridge::Mbc3()
+{
+	// the test name
+	const char *testName = "Test::Cartridge::Mbc3()";
+	TestMachine machine;
+
+	// a 2MB rom with 32KB of ram and a clock
+	if (!LoadTestRom("mbc3", 0x10, 0x06, 0x03, 128)) return;
+
+	// # PHASE 1 # //
+
+	// select bank 0x7F (7 bits)
+	Memory::Write(0x2000, 0x7F);
+	assert(0x7F, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+	// check if selecting bank 0 selects bank 1
+	Memory::Write(0x2000, 0x00);
+	assert(0x01, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+
+	// # PHASE 2 # //
+
+	// enable the ram, and write to the end of bank 2
+	Memory::Write(0x0000, 0x0A);
+	Memory::Write(0x4000, 0x02);
+	Memory::Write(0xBFFF, 0x55);
+	assert(0x55, Memory::ReadByte(0xBFFF), testName, 2);
+	// check if each bank kept its own data
+	Memory::Write(0x4000, 0x00);
+	assert(0x00, Memory::ReadByte(0xBFFF), testName, 2);
+	Memory::Write(0x4000, 0x02);
+	assert(0x55, Memory::ReadByte(0xBFFF), testName, 2);
+}
+
+// test mbc5 rom and ram bank switching
+void UnitTest::Test::Cartridge::Mbc5()
+{
+	// the test name
+	const char *testName = "Test::Cartridge::Mbc5()";
+	TestMachine machine;
+
+	// an 8MB rom with 128KB of ram
+	if (!LoadTestRom("mbc5", 0x1B, 0x08, 0x04, 512)) return;
+
+	// # PHASE 1 # //
+
+	// check if bank 0 can be selected
+	Memory::Write(0x2000, 0x00);
+	assert(0x00, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+	// select bank 0x1FF (the 9th bit is a register of its own)
+	Memory::Write(0x2000, 0xFF);
+	Memory::Write(0x3000, 0x01);
+	assert(0x1FF, ReadBankNumber(SWITCHABLE_ROM_ADDRESS), testName, 1);
+
+	// # PHASE 2 # //
+
+	// enable the ram, and write to each of the 16 banks
+	Memory::Write(0x0000, 0x0A);
+
+	for (int bank = 0; bank < 16; bank++)
+	{
+		Memory::Write(0x4000, bank);
+		Memory::Write(0xA000, bank + 1);
+	}
+
+	// check if each bank kept its own data
+	for (int bank = 0; bank < 16; bank++)
+	{
+		Memory::Write(0x4000, bank);
+		assert(bank + 1, Memory::ReadByte(0xA000), testName, 2);
+	}
+}
+
+// test loading a rom file that was rewritten while another machine runs the old one
+void UnitTest::Test::Cartridge::Reload()
+{
+	// the test name
+	const char *testName = "Test::Cartridge::Reload()";
+	TestMachine first, second;
+
+	first.gameBoy.Bind();
+	if (!LoadTestRom("reload", 0x00, 0x00, 0x00, 2, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM))) return;
+	second.gameBoy.Bind();
+	if (!LoadTestRom("reload", 0x00, 0x00, 0x00, 2, JOYPAD_PROGRAM, sizeof(JOYPAD_PROGRAM))) return;
+
+	// # PHASE 1 # //
+
+	// check if the second machine runs the new file (and the first still runs the old one)
+	assert(JOYPAD_PROGRAM[0], Memory::ReadByte(TEST_ROM_ENTRY_POINT), testName, 1);
+	first.gameBoy.Bind();
+	assert(COUNTING_PROGRAM[0], Memory::ReadByte(TEST_ROM_ENTRY_POINT), testName, 1);
+}
+
+// run the machine's clock for a number of seconds (with the lcd off, so only the events of the clock run)
+static void RunSeconds(int seconds)
+{
+	Memory::Write(LCDC_ADDRESS, 0x00);
+
+	for (int i = 0; i < seconds; i++)
+	{
+		Scheduler::Advance(GameBoy::Current()->SchedulerState, MBC3_CLOCK_CYCLES_PER_SECOND);
+	}
+}
+
+// read a latched mbc3 clock register
+static BYTE ReadClock(BYTE clockRegister)
+{
+	Memory::Write(0x4000, clockRegister);
+	return Memory::ReadByte(CARTRIDGE_RAM_ADDRESS);
+}
+
+// write an mbc3 clock register
+static void WriteClock(BYTE clockRegister, BYTE data)
+{
+	Memory::Write(0x4000, clockRegister);
+	Memory::Write(CARTRIDGE_RAM_ADDRESS, data);
+}
+
+// latch the mbc3 clock (writing 0 then 1)
+static void LatchClock()
+{
+	Memory::Write(0x6000, 0x00);
+	Memory::Write(0x6000, 0x01);
+}
+
+// test the mbc3 real time clock (which runs with the machine's clock)
+void UnitTest::Test::Cartridge::RealTimeClock()
+{
+	// the test name
+	const char *testName = "Test::Cartridge::RealTimeClock()";
+	TestMachine machine;
+
+	if (!LoadTestRom("rtc", 0x10, 0x06, 0x03, 128)) return;
+
+	// enable the clock
+	Memory::Write(0x0000, 0x0A);
+
+	// # PHASE 1 # //
+
+	// run 61 seconds
+	RunSeconds(61);
+	LatchClock();
+	// check if the seconds carried into the minutes
+	assert(0x01, ReadClock(0x08), testName, 1);
+	assert(0x01, ReadClock(0x09), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if the latched registers don't change until the next latch
+	RunSeconds(2);
+	assert(0x01, ReadClock(0x08), testName, 2);
+	LatchClock();
+	assert(0x03, ReadClock(0x08), testName, 2);
+
+	// # PHASE 3 # //
+
+	// halt the clock
+	WriteClock(0x0C, MBC3_CLOCK_HALT);
+	RunSeconds(5);
+	LatchClock();
+	// check if it stopped
+	assert(0x03, ReadClock(0x08), testName, 3);
+
+	// # PHASE 4 # //
+
+	// set the clock to day 511 23:59:59, and start it again
+	WriteClock(0x08, 59);
+	WriteClock(0x09, 59);
+	WriteClock(0x0A, 23);
+	WriteClock(0x0B, 0xFF);
+	WriteClock(0x0C, 0x01);
+	RunSeconds(2);
+	LatchClock();
+	// check if the day counter overflowed (setting the carry)
+	assert(0x01, ReadClock(0x08), testName, 4);
+	assert(0x00, ReadClock(0x0A), testName, 4);
+	assert(0x00, ReadClock(0x0B), testName, 4);
+	assert(MBC3_CLOCK_DAY_CARRY, ReadClock(0x0C), testName, 4);
+}
+
+
+// # Timing Tests # //
+
+// run the machine's clock for a number of cycles (the lcd should be off, so only the timer's events run)
+static void AdvanceClock(int cycles)
+{
+	Scheduler::Advance(GameBoy::Current()->SchedulerState, cycles);
+}
+
+// test reading and resetting DIV (worked out from the machine's clock)
+void UnitTest::Test::Timing::Divider()
+{
+	// the test name
+	const char *testName = "Test::Timing::Divider()";
+	TestMachine machine;
+
+	machine.gameBoy.Init(false);
+	Memory::Write(LCDC_ADDRESS, 0x00);
+
+	// # PHASE 1 # //
+
+	// reset DIV
+	Memory::Write(DIVIDER_ADDRESS, 0x5A);
+	assert(0x00, Memory::ReadByte(DIVIDER_ADDRESS), testName, 1);
+	// check if it counts once every 256 cycles
+	AdvanceClock(256 * 5);
+	assert(0x05, Memory::ReadByte(DIVIDER_ADDRESS), testName, 1);
+	AdvanceClock(255);
+	assert(0x05, Memory::ReadByte(DIVIDER_ADDRESS), testName, 1);
+	AdvanceClock(1);
+	assert(0x06, Memory::ReadByte(DIVIDER_ADDRESS), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if it wraps
+	AdvanceClock(256 * 250);
+	assert(0x00, Memory::ReadByte(DIVIDER_ADDRESS), testName, 2);
+	// check if any write resets it
+	AdvanceClock(256 * 3 + 128);
+	Memory::Write(DIVIDER_ADDRESS, 0xFF);
+	assert(0x00, Memory::ReadByte(DIVIDER_ADDRESS), testName, 2);
+	AdvanceClock(256);
+	assert(0x01, Memory::ReadByte(DIVIDER_ADDRESS), testName, 2);
+}
+
+// test reading and writing TIMA (worked out from the machine's clock), and its overflow
+void UnitTest::Test::Timing::Counter()
+{
+	// the test name
+	const char *testName = "Test::Timing::Counter()";
+	TestMachine machine;
+
+	machine.gameBoy.Init(false);
+	Memory::Write(LCDC_ADDRESS, 0x00);
+
+	// # PHASE 1 # //
+
+	// start the timer at 16 cycles per increment (from a reset divider)
+	Memory::Write(TAC_ADDRESS, 0x05);
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	Memory::Write(TIMA_ADDRESS, 0x00);
+	AdvanceClock(16 * 10);
+	assert(0x0A, Memory::ReadByte(TIMA_ADDRESS), testName, 1);
+	// check if a stopped timer doesn't count
+	Memory::Write(TAC_ADDRESS, 0x01);
+	AdvanceClock(16 * 10);
+	assert(0x0A, Memory::ReadByte(TIMA_ADDRESS), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if changing the frequency counts on from the current value (1024 cycles per increment)
+	Memory::Write(TAC_ADDRESS, 0x04);
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	AdvanceClock(1024 * 3);
+	assert(0x0D, Memory::ReadByte(TIMA_ADDRESS), testName, 2);
+	// check if a write to TIMA counts on from the value written
+	Memory::Write(TIMA_ADDRESS, 0x80);
+	AdvanceClock(1024);
+	assert(0x81, Memory::ReadByte(TIMA_ADDRESS), testName, 2);
+
+	// # PHASE 3 # //
+
+	// overflow TIMA at 16 cycles per increment
+	Memory::Write(TMA_ADDRESS, 0xAB);
+	Memory::Write(TAC_ADDRESS, 0x05);
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	Memory::Write(TIMA_ADDRESS, 0xFE);
+	Memory::Write(INT_REQUEST_ADDRESS, 0x00);
+	AdvanceClock(16);
+	assert(0xFF, Memory::ReadByte(TIMA_ADDRESS), testName, 3);
+	assert(0x00, (Memory::ReadByte(INT_REQUEST_ADDRESS) & 0x04), testName, 3);
+	// check if it reloads from TMA and requests the timer interrupt
+	AdvanceClock(16);
+	assert(0xAB, Memory::ReadByte(TIMA_ADDRESS), testName, 3);
+	assert(0x04, (Memory::ReadByte(INT_REQUEST_ADDRESS) & 0x04), testName, 3);
+
+	// # PHASE 4 # //
+
+	// check if resetting DIV while the bit TIMA counts on is set counts once more
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	Memory::Write(TIMA_ADDRESS, 0x00);
+	AdvanceClock(8);
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	assert(0x01, Memory::ReadByte(TIMA_ADDRESS), testName, 4);
+	// (and not while it's clear)
+	AdvanceClock(4);
+	Memory::Write(DIVIDER_ADDRESS, 0x00);
+	assert(0x01, Memory::ReadByte(TIMA_ADDRESS), testName, 4);
+}
+
+
+// # Machine Tests # //
+
+// test saving a state and loading it into another machine, and rejecting bad states
+void UnitTest::Test::Machine::SaveStates()
+{
+	// the test name
+	const char *testName = "Test::Machine::SaveStates()";
+	TestMachine source, target, other;
+	std::vector<BYTE> state, targetState, sourceState;
+
+	// the same program on two machines, a frame apart
+	source.gameBoy.Bind();
+	if (!LoadTestRom("state", 0x00, 0x00, 0x00, 2, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM))) return;
+	for (int i = 0; i < 3; i++) source.gameBoy.RunFrame();
+	for (int i = 0; i < 1234; i++) source.gameBoy.Step();
+	SaveState::Save(state);
+
+	target.gameBoy.Bind();
+	if (!LoadTestRom("state", 0x00, 0x00, 0x00, 2, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM))) return;
+	target.gameBoy.RunFrame();
+	SaveState::Save(targetState);
+
+	// # PHASE 1 # //
+
+	std::vector<BYTE> bad = state;
+
+	// check if a truncated state is rejected
+	assert(false, SaveState::Load(&state[0], state.size() - 1), testName, 1);
+	// check if a state of another version is rejected
+	bad[4] ^= 0xFF;
+	assert(false, SaveState::Load(&bad[0], bad.size()), testName, 1);
+	// check if a state without the magic is rejected
+	bad = state;
+	bad[0] = 'X';
+	assert(false, SaveState::Load(&bad[0], bad.size()), testName, 1);
+	// check if the machine was left untouched
+	SaveState::Save(bad);
+	assert(true, (bad == targetState), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if a state of another rom is rejected
+	other.gameBoy.Bind();
+	if (!LoadTestRom("state-other", 0x00, 0x00, 0x00, 4, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM))) return;
+	assert(false, SaveState::Load(&state[0], state.size()), testName, 2);
+
+	// # PHASE 3 # //
+
+	// load the state
+	target.gameBoy.Bind();
+	assert(true, SaveState::Load(&state[0], state.size()), testName, 3);
+	// check if saving it again gives the same state
+	SaveState::Save(targetState);
+	assert(true, (targetState == state), testName, 3);
+
+	// # PHASE 4 # //
+
+	// check if both machines stay the same as they run on
+	for (int i = 0; i < 2; i++)
+	{
+		source.gameBoy.RunFrame();
+		target.gameBoy.RunFrame();
+	}
+
+	source.gameBoy.Bind();
+	SaveState::Save(sourceState);
+	target.gameBoy.Bind();
+	SaveState::Save(targetState);
+	assert(true, (targetState == sourceState), testName, 4);
+	assert(true, (targetState != state), testName, 4);
+}
+
+// pop the rewind buffer back through the states that were pushed to it, returns the number popped that didn't match
+static int PopStates(Rewind &rewind, std::vector<std::vector<BYTE>> &states, int count)
+{
+	int mismatches = 0;
+	std::vector<BYTE> state;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (!rewind.Pop() || states.empty()) return (mismatches + count - i);
+
+		SaveState::Save(state);
+		if (state != states.back()) mismatches++;
+		states.pop_back();
+	}
+
+	return mismatches;
+}
+
+// test pushing states to the rewind buffer (as keyframes and deltas) and popping them back
+void UnitTest::Test::Machine::RewindStates()
+{
+	// the test name
+	const char *testName = "Test::Machine::RewindStates()";
+	TestMachine machine;
+	std::vector<std::vector<BYTE>> states;
+	std::vector<BYTE> state;
+	// a keyframe every 4 states
+	Rewind rewind(REWIND_DEFAULT_BUDGET, 4);
+
+	if (!LoadTestRom("rewind", 0x00, 0x00, 0x00, 2, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM))) return;
+
+	// # PHASE 1 # //
+
+	// push 10 frames
+	for (int i = 0; i < 10; i++)
+	{
+		machine.gameBoy.RunFrame();
+		SaveState::Save(state);
+		states.push_back(state);
+		rewind.Push();
+	}
+
+	assert(10, rewind.GetCount(), testName, 1);
+	// check if the buffer is smaller than the states it holds
+	assert(true, (rewind.GetSize() < (state.size() * 10)), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if popping half of them gives the states back (deltas, then their keyframe)
+	assert(0, PopStates(rewind, states, 5), testName, 2);
+
+	// # PHASE 3 # //
+
+	// check if running on from there and pushing keeps working
+	for (int i = 0; i < 3; i++)
+	{
+		machine.gameBoy.RunFrame();
+		SaveState::Save(state);
+		states.push_back(state);
+		rewind.Push();
+	}
+
+	assert(8, rewind.GetCount(), testName, 3);
+	assert(0, PopStates(rewind, states, 8), testName, 3);
+	// check if it's empty
+	assert(false, rewind.Pop(), testName, 3);
+
+	// # PHASE 4 # //
+
+	Rewind small(1, 4);
+
+	// push 10 frames over the budget
+	for (int i = 0; i < 10; i++)
+	{
+		machine.gameBoy.RunFrame();
+		SaveState::Save(state);
+		states.push_back(state);
+		small.Push();
+	}
+
+	// check if only the newest keyframe (the 9th state) and its delta were kept
+	assert(2, small.GetCount(), testName, 4);
+	assert(0, PopStates(small, states, 2), testName, 4);
+	assert(false, small.Pop(), testName, 4);
+}
+
+// play a movie back to its end, returns true if it stayed in sync (a button that wasn't recorded can be pressed as it starts)
+static bool PlayMovie(GameBoy &gameBoy, const char *fileName, int extraButton)
+{
+	Movie movie;
+
+	if (!movie.StartPlayback(fileName)) return false;
+
+	if (extraButton >= 0)
+	{
+		Joypad::Input input = {Scheduler::Now(), extraButton, true};
+		Joypad::Queue(input);
+	}
+
+	for (int cycles = movie.Play(FRAME_CYCLES / 4); cycles > 0; cycles = movie.Play(FRAME_CYCLES / 4))
+	{
+		gameBoy.RunCycles(cycles);
+	}
+
+	return movie.StopPlayback();
+}
+
+// test recording a movie and playing it back in sync
+void UnitTest::Test::Machine::MovieSync()
+{
+	// the test name
+	const char *testName = "Test::Machine::MovieSync()";
+	TestMachine machine;
+	std::vector<BYTE> start;
+	char fileName[FILENAME_MAX];
+	Movie movie;
+
+	if (!LoadTestRom("movie", 0x00, 0x00, 0x00, 2, JOYPAD_PROGRAM, sizeof(JOYPAD_PROGRAM))) return;
+
+	// record pressing and releasing the buttons, from the state 2 frames in
+	machine.gameBoy.RunFrame();
+	machine.gameBoy.RunFrame();
+	SaveState::Save(start);
+	movie.StartRecording();
+
+	for (int i = 0; i < 8; i++)
+	{
+		Joypad::Input input = {Scheduler::Now(), Joypad::A + (i % 4), (i < 4)};
+		if (Joypad::Queue(input)) movie.Record(input);
+		machine.gameBoy.RunCycles(10000 + (i * 777));
+	}
+
+	snprintf(fileName, sizeof(fileName), "%s/cboy-test-movie.bin", P_tmpdir);
+	unsigned long long endHash = Movie::Hash();
+
+	// # PHASE 1 # //
+
+	// stop recording, and write the movie
+	assert(true, movie.StopRecording(fileName), testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if playing it back from the start state ends in the state it was recorded to
+	SaveState::Load(&start[0], start.size());
+	assert(true, PlayMovie(machine.gameBoy, fileName, -1), testName, 2);
+	assert(true, (Movie::Hash() == endHash), testName, 2);
+
+	// # PHASE 3 # //
+
+	// check if it goes out of sync when a button is pressed that wasn't recorded
+	SaveState::Load(&start[0], start.size());
+	assert(false, PlayMovie(machine.gameBoy, fileName, Joypad::START), testName, 3);
+
+	// # PHASE 4 # //
+
+	// check if it doesn't play from another state (a frame on from the start state)
+	SaveState::Load(&start[0], start.size());
+	machine.gameBoy.RunFrame();
+	assert(false, PlayMovie(machine.gameBoy, fileName, -1), testName, 4);
+
+	remove(fileName);
+}
+
+// save the state of the bound machine to compare (the interpreter and compiled code may leave the flags pending at different
+// times, and compiled code only fills in the immediate data of the instructions it runs through the handlers)
+static void SaveComparableState(std::vector<BYTE> &state)
+{
+	Cpu::Get::AF();
+	GameBoy::Current()->CpuState.Operand = 0;
+	SaveState::Save(state);
+}
+
+// run a program compiled and interpreted side by side, returns the number of frames the machines differed after (or -1 if nothing was compiled)
+static int CompareRecompiler(const char *name, BYTE cartridgeType, BYTE romSize, int banks, const BYTE *program, size_t programSize, int frames)
+{
+	TestMachine compiled, interpreted;
+	std::vector<BYTE> compiledState, interpretedState;
+	int differences = 0;
+
+	compiled.gameBoy.Bind();
+	if (!LoadTestRom(name, cartridgeType, romSize, 0x00, banks, program, programSize)) return frames;
+	interpreted.gameBoy.Bind();
+	if (!LoadTestRom(name, cartridgeType, romSize, 0x00, banks, program, programSize)) return frames;
+	Dynarec::Enable(false);
+
+	for (int i = 0; i < frames; i++)
+	{
+		compiled.gameBoy.RunFrame();
+		interpreted.gameBoy.RunFrame();
+
+		// the registers, memory and clock (and the rest of the machine) have to match
+		compiled.gameBoy.Bind();
+		SaveComparableState(compiledState);
+		interpreted.gameBoy.Bind();
+		SaveComparableState(interpretedState);
+
+		if (compiledState != interpretedState) differences++;
+	}
+
+	// (only a machine that compiled something tested the recompiler)
+	if (compiled.gameBoy.DynarecState.Blocks.size() <= 1) return -1;
+
+	return differences;
+}
+
+// test the recompiler against the interpreter
+void UnitTest::Test::Machine::Recompiler()
+{
+	// the test name
+	const char *testName = "Test::Machine::Recompiler()";
+
+	// the recompiler isn't supported on this host, the interpreter runs everything
+	if (!Dynarec::IsSupported())
+	{
+		Log::Normal("%s skipped, the recompiler isn't supported here", testName);
+		return;
+	}
+
+	// # PHASE 1 # //
+
+	// check if a loop of memory writes and the alu runs the same
+	int differences = CompareRecompiler("recompiler-counting", 0x00, 0x00, 2, COUNTING_PROGRAM, sizeof(COUNTING_PROGRAM), 20);
+	assert(0, differences, testName, 1);
+
+	// # PHASE 2 # //
+
+	// check if the same bank mapped at both windows runs the same (calls push the address of the window they're called through)
+	differences = CompareRecompiler("recompiler-windows", 0x19, 0x01, 4, WINDOWS_PROGRAM, sizeof(WINDOWS_PROGRAM), 20);
+	assert(0, differences, testName, 2);
+}
+
+// compare a conversion of scanlines with the scalar one for every palette and colour number pattern, returns the number of lines that differ (-1 if the host doesn't support it)
+static int CompareConversion(int conversion)
+{
+	// the patterns: every colour number at every position (read from an offset, as scrolled lines are), and a pseudo-random line
+	const int patterns = 5;
+	BYTE colourNumbers[patterns][168];
+	unsigned int seed = 0x2A;
+
+	for (int x = 0; x < 168; x++)
+	{
+		for (int k = 0; k < 4; k++) colourNumbers[k][x] = (x + k) & 3;
+		seed = (seed * 1103515245) + 12345;
+		colourNumbers[4][x] = (seed >> 16) & 3;
+	}
+
+	int differences = 0;
+
+	for (int palette = 0; palette < 256; palette++)
+	{
+		// the colours of the palette, as a scanline is drawn with them
+		unsigned int colours[4];
+
+		for (int i = 0; i < 4; i++) colours[i] = TEST_SHADES[(palette >> (i * 2)) & 3];
+
+		for (int pattern = 0; pattern < patterns; pattern++)
+		{
+			const BYTE *line = &colourNumbers[pattern][palette % 8];
+			BYTE expected[160 * 4], got[160 * 4];
+
+			Lcd::ConvertLine(line, colours, expected, Lcd::CONVERT_SCALAR);
+			if (!Lcd::ConvertLine(line, colours, got, conversion)) return -1;
+
+			if (memcmp(expected, got, sizeof(expected)) != 0) differences++;
+		}
+	}
+
+	return differences;
+}
+
+// test the simd scanline conversions against the scalar one
+void UnitTest::Test::Screen::ConvertLine()
+{
+	// the test name
+	const char *testName = "Test::Screen::ConvertLine()";
+	const char *names[Lcd::CONVERSION_COUNT] = {"scalar", "sse2", "avx2"};
+
+	for (int conversion = Lcd::CONVERT_SSE2; conversion < Lcd::CONVERSION_COUNT; conversion++)
+	{
+		// # PHASE conversion # //
+
+		// check if the conversion draws the same lines as the scalar one
+		int differences = CompareConversion(conversion);
+
+		// the conversion isn't supported on this host
+		if (differences < 0)
+		{
+			Log::Normal("%s phase %d skipped, the %s conversion isn't supported here", testName, conversion, names[conversion]);
+			continue;
+		}
+
+		assert(0, differences, testName, conversion);
+	}
+}